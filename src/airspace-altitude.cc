@@ -0,0 +1,84 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "exception.hh"
+#include "airspace.hh"
+#include "airspace-io.hh"
+#include "airspace-geometry.hh"
+#include "airspace-index.hh"
+#include "earth-parser.hh"
+#include "io-match.hh"
+
+#include <string>
+
+#include <string.h>
+
+class AirspaceMatchAltitude {
+    AltitudeBand band;
+    GeoBounds area;
+
+public:
+    AirspaceMatchAltitude(const AltitudeBand &_band, const GeoBounds &_area)
+        :band(_band), area(_area) {}
+
+public:
+    bool operator ()(const Airspace &airspace) {
+        return AltitudeBand(airspace.getBottom(), airspace.getTop())
+            .overlaps(band) &&
+            (!area.defined() || area.overlaps(airspace_bounds(airspace)));
+    }
+};
+
+/** parses the altitude up to the next colon */
+static const Altitude
+parse_altitude_arg(const char *&p)
+{
+    const char *colon = strchr(p, ':');
+    const std::string value = colon != NULL
+        ? std::string(p, colon - p)
+        : std::string(p);
+
+    p = colon != NULL ? colon + 1 : p + value.length();
+
+    return parseAltitude(value.c_str());
+}
+
+AirspaceReader *
+AltitudeAirspaceFilter::createFilter(AirspaceReader *reader,
+                                     const char *args) const
+{
+    if (args == NULL || strchr(args, ':') == NULL)
+        throw malformed_input("Bottom and top altitude expected");
+
+    const Altitude bottom = parse_altitude_arg(args);
+    const Altitude top = parse_altitude_arg(args);
+    const AltitudeBand band(bottom, top);
+    if (band.bottom >= band.top)
+        throw malformed_input("The top must be above the bottom");
+
+    GeoBounds area;
+    if (*args != 0) {
+        area = parseArea(args);
+        if (*args != 0)
+            throw malformed_input("Garbage after the area");
+    }
+
+    return new MatchReader<Airspace, AirspaceMatchAltitude>
+        (reader, AirspaceMatchAltitude(band, area));
+}
@@ -22,25 +22,80 @@
 #include "airspace-io.hh"
 #include "cenfis-airspace.h"
 #include "cenfis-buffer.hh"
+#include "thread-pool.hh"
 
 #include <ostream>
+#include <iostream>
 #include <iomanip>
+#include <deque>
+#include <vector>
+#include <exception>
+#include <utility>
+#include <atomic>
 
 #include <netinet/in.h>
 #include <ctype.h>
 #include <string.h>
+#include <stdint.h>
+
+/** the Cenfis airspace memory */
+static const size_t CENFIS_CAPACITY = 0x10000;
+
+/** the size of the configuration table, without padding */
+static const size_t CONFIG_SIZE = 0xe2;
+
+/** an airspace which is being compiled into a Cenfis record */
+struct CenfisAirspaceJob {
+    const Airspace airspace;
+    const bool first;
+
+    /** the blank context for compiling independently, or the real
+        context if the record was compiled sequentially */
+    CenfisCompileContext context;
+    CenfisBuffer record;
+
+    /** was this record compiled in the real context? */
+    bool sequential;
+
+    std::exception_ptr error;
+
+    CenfisAirspaceJob(const Airspace &_airspace, bool _first)
+        :airspace(_airspace), first(_first), record(context),
+         sequential(false) {}
+
+    CenfisAirspaceJob(const CenfisAirspaceJob &) = delete;
+};
 
 class CenfisAirspaceWriter : public AirspaceWriter {
 public:
     std::ostream *stream;
     bool first;
+
+    /** compiles the records, or NULL if that is done in the calling
+        thread */
+    ThreadPool *pool;
+
+    /** the airspace records, in input order */
+    std::deque<CenfisAirspaceJob> jobs;
+
+    /** the state after the last record */
+    CenfisCompileContext context;
+
+    /** the bytes beyond the fixed record header of all records whose
+        size is final; updated by the worker threads */
+    std::atomic<size_t> extra_bytes;
+
     CenfisBuffer airspace_buffer, index_buffer, config_buffer;
 
 public:
     CenfisAirspaceWriter(std::ostream *stream);
+    virtual ~CenfisAirspaceWriter();
 
 private:
-    void write(const CenfisBuffer &src);
+    void compile(CenfisAirspaceJob &job) throw();
+    void check_size() const;
+    void finish_jobs();
+    void layout();
 
 public:
     virtual void write(const Airspace &as);
@@ -48,24 +103,116 @@ public:
 };
 
 CenfisAirspaceWriter::CenfisAirspaceWriter(std::ostream *_stream)
-    :stream(_stream), first(true),
+    :stream(_stream), first(true), pool(NULL), extra_bytes(0),
      airspace_buffer(sizeof(struct cenfis_airspace_file_header)),
      index_buffer() {
+    if (airspace_writer_options.jobs > 1)
+        pool = new ThreadPool(airspace_writer_options.jobs);
 }
 
-void
-CenfisAirspaceWriter::write(const CenfisBuffer &src)
+CenfisAirspaceWriter::~CenfisAirspaceWriter()
 {
-    std::ostream::pos_type length = (std::ostream::pos_type)src.tell();
-    std::ostream::pos_type pos = stream->tellp();
-    if (pos / 0x8000 != (pos + length) / 0x8000)
-        /* don't write across bank limit, insert 0xff padding
-           instead */
-        for (std::streamsize padding = ((pos + length) / 0x8000) * 0x8000 - pos;
-             padding > 0; --padding)
-            stream->put((std::ostream::char_type)0xff);
-
-    *stream << src;
+    if (pool != NULL)
+        delete pool;
+}
+
+/**
+ * Simulates the old layout which appends the records in input order,
+ * and returns the number of padding bytes it would insert.
+ */
+static size_t
+greedy_padding(const std::vector<size_t> &sizes, size_t base)
+{
+    size_t pos = base, padding = 0;
+
+    for (std::vector<size_t>::const_iterator it = sizes.begin();
+         it != sizes.end(); ++it) {
+        if (pos / 0x8000 != (pos + *it) / 0x8000) {
+            padding += ((pos + *it) / 0x8000) * 0x8000 - pos;
+            pos = ((pos + *it) / 0x8000) * 0x8000;
+        }
+
+        pos += *it;
+    }
+
+    return padding;
+}
+
+/**
+ * Chooses the records for the first bank, so that as little space as
+ * possible is wasted.  This is a subset sum problem, which is solved
+ * with dynamic programming over all possible bank fill levels.  The
+ * fill levels are a bit set, so one record is added to 64 of them
+ * with a shift and an OR.  The first record is always in the first
+ * bank, because it contains the file info.
+ *
+ * @return the number of bytes used in the first bank
+ */
+static size_t
+pack_first_bank(const std::vector<size_t> &sizes, size_t capacity,
+                std::vector<bool> &first_bank)
+{
+    first_bank.assign(sizes.size(), false);
+    if (sizes.empty())
+        return 0;
+
+    first_bank[0] = true;
+    if (sizes[0] > capacity)
+        return sizes[0];
+
+    capacity -= sizes[0];
+
+    /* from[n] is the record which made the fill level n reachable,
+       or -1 if it is not reachable */
+    std::vector<int> from(capacity + 1, -1);
+
+    /* bit n is set if the fill level n is reachable */
+    const size_t num_words = capacity / 64 + 1;
+    std::vector<uint64_t> reachable(num_words, 0);
+    reachable[0] = 1;
+
+    /* selects the fill levels up to the capacity in the last
+       word; the bits above it are cleared */
+    const uint64_t last_mask = ~(uint64_t)0 >> (63 - capacity % 64);
+
+    size_t best = 0;
+    for (size_t i = 1; i < sizes.size() && best < capacity; ++i) {
+        const size_t size = sizes[i];
+        if (size > capacity)
+            continue;
+
+        const size_t shift_words = size / 64;
+        const unsigned shift_bits = size % 64;
+
+        /* walk downwards, so the words read are not yet updated
+           with this record */
+        for (size_t w = num_words; w-- > shift_words;) {
+            uint64_t shifted = reachable[w - shift_words] << shift_bits;
+            if (shift_bits > 0 && w > shift_words)
+                shifted |= reachable[w - shift_words - 1] >> (64 - shift_bits);
+
+            uint64_t added = shifted & ~reachable[w];
+            if (w == num_words - 1)
+                added &= last_mask;
+            if (added == 0)
+                continue;
+
+            reachable[w] |= added;
+
+            do {
+                const size_t n = w * 64 + __builtin_ctzll(added);
+                from[n] = (int)i;
+                if (n > best)
+                    best = n;
+                added &= added - 1;
+            } while (added != 0);
+        }
+    }
+
+    for (size_t n = best; n > 0; n -= sizes[from[n]])
+        first_bank[from[n]] = true;
+
+    return sizes[0] + best;
 }
 
 static const char *
@@ -182,17 +329,25 @@ pipe_split(std::string &a, std::string &b)
     a = std::string(a, 0, pos);
 }
 
-void
-CenfisAirspaceWriter::write(const Airspace &as)
+/**
+ * Compiles one airspace into a Cenfis record.
+ *
+ * @param first true if this is the first record of the file
+ */
+static void
+compile_airspace(const Airspace &as, bool first,
+                 CenfisBuffer &current)
 {
-    /* ignore some airspace types */
-    if (as.getType() == Airspace::TYPE_UNKNOWN ||
-        as.getType() == Airspace::TYPE_ECHO_LOW ||
-        as.getType() == Airspace::TYPE_ECHO_HIGH ||
-        as.getType() == Airspace::TYPE_GLIDER)
-        return;
+    CenfisCompileContext &context = current.get_context();
+    const Airspace::EdgeList &edges = as.getEdges();
+
+    /* estimate the record size, to allocate it at once */
+    size_t estimate = sizeof(struct cenfis_airspace_header) + 128;
+    for (Airspace::EdgeList::const_iterator it = edges.begin();
+         it != edges.end(); ++it)
+        estimate += it->getType() == Edge::TYPE_ARC ? 38 * 4 : 12;
+    current.reserve(estimate);
 
-    CenfisBuffer current;
     current.make_header();
 
     std::string name = as.getName(), name2, name3, name4, type_string;
@@ -257,7 +412,6 @@ CenfisAirspaceWriter::write(const Airspace &as)
         // XXX
         current.header().file_info_ind = htons(current.tell());
         current.append("ASP_X304.BHF29-7-2007   ");
-        first = false;
     }
 
     /* AN = name */
@@ -316,13 +470,15 @@ CenfisAirspaceWriter::write(const Airspace &as)
 
     /* S, L = vertices */
 
-    const Airspace::EdgeList &edges = as.getEdges();
     /* bug reproduction: if an airspace has no first vertex, it
        inherits the first vertex of the previous one */
-    static SurfacePosition buffer;
+    SurfacePosition &buffer = context.first_vertex;
     const SurfacePosition *firstVertex = has_first ? NULL : &buffer;
     size_t l_size_offset = 0;
 
+    if (!has_first && !context.first_vertex_set)
+        context.depends = true;
+
     for (Airspace::EdgeList::const_iterator it = edges.begin();
          it != edges.end(); ++it) {
         const Edge &edge = *it;
@@ -334,6 +490,7 @@ CenfisAirspaceWriter::write(const Airspace &as)
         } else if (edge.getType() == Edge::TYPE_VERTEX) {
             current.header().s_rel_ind = htons(current.tell());
             buffer = edge.getEnd();
+            context.first_vertex_set = true;
             firstVertex = &buffer;
             current.append_first(*firstVertex);
             current.header().l_rel_ind = htons(current.tell());
@@ -358,9 +515,168 @@ CenfisAirspaceWriter::write(const Airspace &as)
     current.header().asp_rec_lengh = htons(current.tell());
 
     current.header().voice_ind = htons(as.getVoice());
+}
+
+void
+CenfisAirspaceWriter::compile(CenfisAirspaceJob &job) throw()
+{
+    try {
+        compile_airspace(job.airspace, job.first, job.record);
+
+        /* a record which depends on its predecessor will be compiled
+           again, and its size may change */
+        if (!job.context.depends)
+            extra_bytes += job.record.tell() -
+                sizeof(struct cenfis_airspace_header);
+    } catch (...) {
+        job.error = std::current_exception();
+    }
+}
+
+/**
+ * Fails as soon as it is certain that the records will not fit, so
+ * a large input is not buffered completely.  Records which have not
+ * been compiled yet are counted with their header size.
+ */
+void
+CenfisAirspaceWriter::check_size() const
+{
+    const size_t minimum = sizeof(struct cenfis_airspace_file_header) +
+        jobs.size() * (sizeof(struct cenfis_airspace_header) + 2) +
+        extra_bytes + CONFIG_SIZE;
+
+    if (minimum > CENFIS_CAPACITY)
+        throw container_full("the Cenfis has only 0x10000 bytes airspace buffer");
+}
+
+void
+CenfisAirspaceWriter::write(const Airspace &as)
+{
+    /* ignore some airspace types */
+    if (as.getType() == Airspace::TYPE_UNKNOWN ||
+        as.getType() == Airspace::TYPE_ECHO_LOW ||
+        as.getType() == Airspace::TYPE_ECHO_HIGH ||
+        as.getType() == Airspace::TYPE_GLIDER)
+        return;
+
+    jobs.emplace_back(as, first);
+    CenfisAirspaceJob &job = jobs.back();
+    first = false;
+
+    if (pool == NULL) {
+        /* no threads: compile right away in the real context */
+        job.context = context;
+        compile_airspace(job.airspace, job.first, job.record);
+        context = job.context;
+        job.sequential = true;
+        extra_bytes += job.record.tell() -
+            sizeof(struct cenfis_airspace_header);
+    } else
+        pool->push(std::bind(&CenfisAirspaceWriter::compile, this,
+                             std::ref(job)));
+
+    check_size();
+}
+
+/**
+ * Waits for the worker threads, and then walks the records in input
+ * order to apply the state carried from one record to the next.  The
+ * few records which depend on it are compiled again.
+ */
+void
+CenfisAirspaceWriter::finish_jobs()
+{
+    if (pool != NULL) {
+        pool->wait();
+        delete pool;
+        pool = NULL;
+    }
+
+    for (std::deque<CenfisAirspaceJob>::iterator it = jobs.begin();
+         it != jobs.end(); ++it) {
+        CenfisAirspaceJob &job = *it;
+
+        if (job.error)
+            std::rethrow_exception(job.error);
+
+        if (job.sequential)
+            continue;
+
+        if (job.context.depends) {
+            CenfisBuffer record(job.context);
+            job.record.swap(record);
+            job.context = context;
+            compile_airspace(job.airspace, job.first, job.record);
+            context = job.context;
+        } else
+            context.merge(job.context);
+    }
+}
+
+/**
+ * Arranges all records in the airspace buffer, and builds the index.
+ * No record may cross a bank limit.  If the records don't fit into
+ * the first bank, it is filled as well as possible, and the others
+ * go to the second bank.  The index still lists the records in input
+ * order.
+ */
+void
+CenfisAirspaceWriter::layout()
+{
+    const size_t base = sizeof(struct cenfis_airspace_file_header);
+
+    std::vector<size_t> sizes;
+    size_t total = 0;
+    for (std::deque<CenfisAirspaceJob>::const_iterator it = jobs.begin();
+         it != jobs.end(); ++it) {
+        sizes.push_back(it->record.tell());
+        total += it->record.tell();
+    }
+
+    /* a record must fit into one bank, and the first one (with the
+       file info) into the first bank after the header */
+    for (size_t i = 0; i < sizes.size(); ++i)
+        if (sizes[i] > (i == 0 ? 0x8000 - base : 0x8000))
+            throw container_full("an airspace is too large for a 32 kB bank");
+
+    std::vector<bool> first_bank(sizes.size(), true);
+    size_t padding = 0;
+    if (base + total > 0x8000) {
+        const size_t used = pack_first_bank(sizes, 0x8000 - base, first_bank);
+        if (used > 0x8000 - base)
+            throw container_full("the Cenfis has only 0x10000 bytes airspace buffer");
+
+        padding = 0x8000 - base - used;
+    }
+
+    std::vector<size_t> offsets(sizes.size());
+    for (unsigned bank = 0; bank < 2; ++bank) {
+        if (bank == 1)
+            airspace_buffer.fill(0xff, padding);
 
-    index_buffer.append_short(sizeof(struct cenfis_airspace_file_header) + airspace_buffer.tell());
-    airspace_buffer << current;
+        size_t i = 0;
+        for (std::deque<CenfisAirspaceJob>::iterator it = jobs.begin();
+             it != jobs.end(); ++it, ++i) {
+            if (first_bank[i] != (bank == 0))
+                continue;
+
+            airspace_buffer << std::move(it->record);
+            offsets[i] = base + airspace_buffer.tell() - sizes[i];
+        }
+    }
+
+    for (size_t i = 0; i < offsets.size(); ++i)
+        index_buffer.append_short(offsets[i]);
+
+    if (airspace_writer_options.verbose)
+        std::cerr << "cenfis: " << jobs.size() << " airspaces, "
+                  << total << " bytes, "
+                  << (airspace_buffer.tell() - total)
+                  << " bytes bank padding (input order: "
+                  << greedy_padding(sizes, base) << " bytes)"
+                  << std::endl;
+
+    jobs.clear();
 }
 
 void
@@ -369,9 +685,12 @@ CenfisAirspaceWriter::flush()
     if (stream == NULL)
         throw already_flushed();
 
+    finish_jobs();
+    layout();
+
     config_buffer.append_byte(0x00);
-    config_buffer.fill(0x01, 0xe1);
-    config_buffer.encrypt(0xe2);
+    config_buffer.fill(0x01, CONFIG_SIZE - 1);
+    config_buffer.encrypt(CONFIG_SIZE);
 
     struct cenfis_airspace_file_header header;
     size_t offset = sizeof(header);
@@ -399,7 +718,7 @@ CenfisAirspaceWriter::flush()
     /* pad to next 0x10 */
     config_buffer.fill(0x00, (-(offset + config_buffer.tell())) & 0xf);
 
-    if (offset + config_buffer.tell() > 0x10000)
+    if (offset + config_buffer.tell() > CENFIS_CAPACITY)
         throw container_full("the Cenfis has only 0x10000 bytes airspace buffer");
 
     stream->write((const std::ostream::char_type*)&header, sizeof(header));
@@ -19,10 +19,12 @@
 
 #include "airspace.hh"
 #include "airspace-io.hh"
+#include "earth-parser.hh"
 #include "exception.hh"
 
 #include <fstream>
 #include <iostream>
+#include <list>
 
 #include <stdlib.h>
 #include <string.h>
@@ -39,6 +41,16 @@ static void usage(const char *argv0) {
         "options:\n"
         " -o outfile   write output to this file\n"
         " -f outformat write output to stdout with this format\n"
+        " -F filter    use a filter\n"
+        " -j jobs      number of threads parsing and compiling airspaces\n"
+        " -m           merge: drop duplicate airspaces\n"
+        " -n distance  merge, and report airspaces which differ by less\n"
+        "              than this distance\n"
+        " -w width     SVG image width in pixels\n"
+        " -a area      SVG area: south west and north east corner,\n"
+        "              separated by a colon\n"
+        " -t tiles     split the SVG image into tiles x tiles files\n"
+        " -v           print statistics\n"
         " -h           help (this text)\n";
 }
 
@@ -53,6 +65,19 @@ arg_error(const char *argv0, const char *msg)
     exit(1);
 }
 
+static const GeoBounds
+parse_area(const char *argv0, const char *p)
+{
+    try {
+        const GeoBounds area = parseArea(p);
+        if (*p != 0)
+            arg_error(argv0, "Garbage after the second corner");
+        return area;
+    } catch (const malformed_input &e) {
+        arg_error(argv0, e.what());
+    }
+}
+
 const AirspaceFormat *getFormatFromFilename(const char *filename) {
     const char *dot;
     const AirspaceFormat *format;
@@ -74,6 +99,10 @@ const AirspaceFormat *getFormatFromFilename(const char *filename) {
 
 int main(int argc, char **argv) {
     const char *out_filename = NULL, *stdout_format = NULL;
+    std::list<const char*> filters;
+    bool verbose = false, merge = false;
+    Distance merge_tolerance(Distance::UNIT_UNKNOWN, 0);
+    unsigned long num_airspaces = 0;
     const AirspaceFormat *out_format;
     std::ostream *out;
     AirspaceWriter *writer;
@@ -82,7 +111,7 @@ int main(int argc, char **argv) {
     while (1) {
         int c;
 
-        c = getopt(argc, argv, "ho:f:");
+        c = getopt(argc, argv, "ho:f:F:j:mn:w:a:t:v");
         if (c == -1)
             break;
 
@@ -101,6 +130,54 @@ int main(int argc, char **argv) {
             out_filename = NULL;
             break;
 
+        case 'F':
+            filters.push_back(optarg);
+            break;
+
+        case 'j':
+            airspace_writer_options.jobs = (unsigned)strtoul(optarg, NULL, 10);
+            if (airspace_writer_options.jobs == 0)
+                arg_error(argv[0], "Invalid number of jobs");
+            airspace_reader_options.jobs = airspace_writer_options.jobs;
+            break;
+
+        case 'm':
+            merge = true;
+            break;
+
+        case 'n':
+            merge = true;
+            try {
+                merge_tolerance = parseDistance(optarg);
+            } catch (const malformed_input &e) {
+                arg_error(argv[0], e.what());
+            }
+
+            if (merge_tolerance.getMeters() <= 0)
+                arg_error(argv[0], "The distance must be positive");
+            break;
+
+        case 'w':
+            airspace_writer_options.svg_width = (unsigned)strtoul(optarg, NULL, 10);
+            if (airspace_writer_options.svg_width == 0)
+                arg_error(argv[0], "Invalid image width");
+            break;
+
+        case 'a':
+            airspace_writer_options.svg_area = parse_area(argv[0], optarg);
+            break;
+
+        case 't':
+            airspace_writer_options.svg_tiles = (unsigned)strtoul(optarg, NULL, 10);
+            if (airspace_writer_options.svg_tiles == 0)
+                arg_error(argv[0], "Invalid number of tiles");
+            break;
+
+        case 'v':
+            verbose = true;
+            airspace_writer_options.verbose = true;
+            break;
+
         case '?':
             arg_error(argv[0], NULL);
 
@@ -139,6 +216,7 @@ int main(int argc, char **argv) {
 
     out->exceptions(std::ios_base::badbit | std::ios_base::failbit);
 
+    airspace_writer_options.filename = out_filename;
     writer = out_format->createWriter(out);
     if (writer == NULL) {
         unlink(out_filename);
@@ -146,6 +224,9 @@ int main(int argc, char **argv) {
         exit(1);
     }
 
+    if (merge)
+        writer = createMergeAirspaceWriter(writer, merge_tolerance);
+
     /* read all input files */
 
     while (optind < argc) {
@@ -167,6 +248,35 @@ int main(int argc, char **argv) {
             exit(1);
         }
 
+        for (std::list<const char*>::const_iterator it = filters.begin();
+             it != filters.end(); ++it) {
+            const char *colon = strchr(*it, ':');
+            const std::string filter_name = colon != NULL
+                ? std::string(*it, colon - *it)
+                : std::string(*it);
+            const char *args = colon != NULL ? colon + 1 : NULL;
+            const AirspaceFilter *filter
+                = getAirspaceFilter(filter_name.c_str());
+            if (filter == NULL) {
+                delete writer;
+                delete reader;
+                unlink(out_filename);
+                cerr << "No such filter: '" << filter_name << "'" << endl;
+                exit(1);
+            }
+
+            try {
+                reader = filter->createFilter(reader, args);
+            } catch (const std::exception &e) {
+                delete writer;
+                delete reader;
+                unlink(out_filename);
+                cerr << "Failed to initialize filter '" << filter_name
+                     << "': " << e.what() << endl;
+                exit(2);
+            }
+        }
+
         /* transfer data */
         try {
             const Airspace *as;
@@ -174,6 +284,7 @@ int main(int argc, char **argv) {
             while ((as = reader->read()) != NULL) {
                 writer->write(*as);
                 delete as;
+                ++num_airspaces;
             }
         } catch (const malformed_input &e) {
             delete writer;
@@ -194,9 +305,25 @@ int main(int argc, char **argv) {
         delete reader;
     }
 
-    writer->flush();
+    try {
+        writer->flush();
+    } catch (const std::exception &e) {
+        delete writer;
+        unlink(out_filename);
+        cerr << e.what() << endl;
+        exit(2);
+    }
+
     delete writer;
 
+    if (verbose) {
+        cerr << num_airspaces << " airspaces";
+        if (out != &cout)
+            cerr << ", " << out->tellp() << " bytes written to "
+                 << out_filename;
+        cerr << endl;
+    }
+
     if (out == &cout)
         out->flush();
     else
@@ -0,0 +1,418 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "exception.hh"
+#include "airspace.hh"
+#include "airspace-io.hh"
+#include "airspace-geometry.hh"
+#include "airspace-index.hh"
+#include "earth-parser.hh"
+#include "tp.hh"
+#include "tp-io.hh"
+#include "lxn-task.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <string>
+#include <algorithm>
+
+#include <math.h>
+#include <string.h>
+#include <strings.h>
+
+struct RoutePoint {
+    std::string name;
+    SurfacePosition position;
+
+    RoutePoint(const std::string &_name, const SurfacePosition &_position)
+        :name(_name), position(_position) {}
+};
+
+typedef std::vector<RoutePoint> Route;
+
+static void
+load_lxn_route(const char *path, Route &route)
+{
+    std::ifstream stream(path, std::ios::binary);
+    if (stream.fail())
+        throw std::runtime_error(std::string("Failed to open ") + path);
+
+    const std::vector<unsigned char>
+        data((std::istreambuf_iterator<char>(stream)),
+             std::istreambuf_iterator<char>());
+
+    struct lxn_task_point points[LXN_TASK_MAX_POINTS];
+    const int num_points = lxn_find_task(&data[0], data.size(), points);
+    if (num_points < 0)
+        throw malformed_input(std::string("Malformed LXN file: ") + path);
+
+    for (int i = 0; i < num_points; ++i)
+        route.push_back(RoutePoint(points[i].name,
+                                   SurfacePosition(Latitude(points[i].latitude),
+                                                   Longitude(points[i].longitude))));
+}
+
+static void
+load_turn_point_route(const char *path, const TurnPointFormat *format,
+                      Route &route)
+{
+    std::ifstream stream(path);
+    if (stream.fail())
+        throw std::runtime_error(std::string("Failed to open ") + path);
+
+    TurnPointReader *reader = format->createReader(&stream);
+
+    try {
+        const TurnPoint *tp;
+        while ((tp = reader->read()) != NULL) {
+            if (tp->getPosition().defined())
+                route.push_back(RoutePoint(tp->getAnyName(),
+                                           tp->getPosition()));
+            delete tp;
+        }
+    } catch (...) {
+        delete reader;
+        throw;
+    }
+
+    delete reader;
+}
+
+/**
+ * Loads the route from a turn point file (in the order of the file),
+ * or from the task declared in an LXN file.
+ */
+static void
+load_route(const char *path, Route &route)
+{
+    const char *dot = strrchr(path, '.');
+    if (dot == NULL || dot[1] == 0)
+        throw malformed_input("No route file extension");
+
+    if (strcasecmp(dot + 1, "lxn") == 0 || strcasecmp(dot + 1, "fil") == 0) {
+        load_lxn_route(path, route);
+    } else {
+        const TurnPointFormat *format = getTurnPointFormat(dot + 1);
+        if (format == NULL)
+            throw malformed_input(std::string("Unknown route format: ") +
+                                  (dot + 1));
+
+        load_turn_point_route(path, format, route);
+    }
+
+    if (route.size() < 2)
+        throw malformed_input("The route needs at least two turn points");
+}
+
+/** where the route crosses an airspace, in meters from the start */
+struct CorridorHit {
+    AirspaceIndex::id_t id;
+    double entry, exit;
+
+    bool operator <(const CorridorHit &other) const {
+        return entry < other.entry ||
+            (!(other.entry < entry) && id < other.id);
+    }
+};
+
+static bool
+hit_id_less(const CorridorHit &a, const CorridorHit &b)
+{
+    return a.id < b.id;
+}
+
+/**
+ * Tests the line segment a-b against the polygon.  If they are
+ * closer than the specified distance, the range of the segment
+ * parameter t (0 at a, 1 at b) where the segment is inside the
+ * polygon is stored, or the t of the closest approach if it stays
+ * outside.
+ */
+static bool
+segment_polygon_range(const PlanePoint &a, const PlanePoint &b,
+                      const PlanePointList &polygon, double distance,
+                      double &t_min, double &t_max)
+{
+    const PlanePointList::size_type n = polygon.size();
+    const double rx = b.x - a.x, ry = b.y - a.y;
+    const double length2 = rx * rx + ry * ry;
+    bool found = false;
+
+    t_min = 1;
+    t_max = 0;
+
+    if (plane_polygon_contains(polygon, a)) {
+        t_min = 0;
+        found = true;
+    }
+
+    if (plane_polygon_contains(polygon, b)) {
+        t_max = 1;
+        found = true;
+    }
+
+    for (PlanePointList::size_type i = 0; i < n; ++i) {
+        const PlanePoint &c = polygon[i], &d = polygon[(i + 1) % n];
+        const double sx = d.x - c.x, sy = d.y - c.y;
+        const double denominator = rx * sy - ry * sx;
+        if (fabs(denominator) <= 0)
+            /* parallel; touching is covered by the distance test */
+            continue;
+
+        const double qx = c.x - a.x, qy = c.y - a.y;
+        const double t = (qx * sy - qy * sx) / denominator;
+        const double u = (qx * ry - qy * rx) / denominator;
+        if (t < 0 || t > 1 || u < 0 || u > 1)
+            continue;
+
+        t_min = std::min(t_min, t);
+        t_max = std::max(t_max, t);
+        found = true;
+    }
+
+    if (found || distance <= 0)
+        return found;
+
+    /* no crossing: look for the closest approach, which is at a
+       vertex of either the segment or the polygon */
+    double best = HUGE_VAL, best_t = 0;
+
+    const double distance_a = plane_polygon_distance(polygon, a);
+    if (distance_a < best) {
+        best = distance_a;
+        best_t = 0;
+    }
+
+    const double distance_b = plane_polygon_distance(polygon, b);
+    if (distance_b < best) {
+        best = distance_b;
+        best_t = 1;
+    }
+
+    for (PlanePointList::const_iterator it = polygon.begin();
+         it != polygon.end(); ++it) {
+        const double d = plane_segment_distance(*it, a, b);
+        if (d < best) {
+            best = d;
+            best_t = length2 > 0
+                ? ((it->x - a.x) * rx + (it->y - a.y) * ry) / length2
+                : 0;
+            best_t = std::max(0., std::min(1., best_t));
+        }
+    }
+
+    if (best > distance)
+        return false;
+
+    t_min = t_max = best_t;
+    return true;
+}
+
+/**
+ * A reader which loads all airspaces into an AirspaceIndex, and then
+ * returns those within the corridor around the route, in the order
+ * of the input.  The crossings are reported on stderr, sorted by the
+ * entry distance.
+ */
+class CorridorAirspaceReader : public AirspaceReader {
+private:
+    AirspaceReader *reader;
+    Route route;
+
+    /** half the corridor width, in plane units */
+    double half_width;
+
+    AltitudeBand band;
+
+    AirspaceIndex index;
+    std::vector<CorridorHit> hits;
+    bool loaded;
+    std::vector<CorridorHit>::size_type position;
+
+public:
+    CorridorAirspaceReader(AirspaceReader *_reader, const Route &_route,
+                           double _half_width, const AltitudeBand &_band)
+        :reader(_reader), route(_route), half_width(_half_width),
+         band(_band), loaded(false), position(0) {}
+
+    virtual ~CorridorAirspaceReader() {
+        delete reader;
+    }
+
+public:
+    virtual const Airspace *read();
+
+private:
+    void load();
+    void queryLeg(const RoutePoint &from, const RoutePoint &to,
+                  double start, std::vector<CorridorHit> &found);
+};
+
+void
+CorridorAirspaceReader::queryLeg(const RoutePoint &from, const RoutePoint &to,
+                                 double start,
+                                 std::vector<CorridorHit> &found)
+{
+    GeoBounds area(from.position, to.position);
+    area.grow(half_width);
+
+    AirspaceIndex::IdList candidates;
+    index.query(area, band, candidates);
+    if (candidates.empty())
+        return;
+
+    const double length = (to.position - from.position).getMeters();
+    const LocalProjection projection(Latitude((from.position.getLatitude().getValue() +
+                                               to.position.getLatitude().getValue()) / 2));
+    const PlanePoint a = projection.project(from.position);
+    const PlanePoint b = projection.project(to.position);
+
+    PlanePointList polygon;
+
+    for (AirspaceIndex::IdList::const_iterator it = candidates.begin();
+         it != candidates.end(); ++it) {
+        polygon.clear();
+        airspace_tessellate(index.get(*it), projection, polygon);
+        if (polygon.size() < 3)
+            continue;
+
+        double t_min, t_max;
+        if (!segment_polygon_range(a, b, polygon, half_width, t_min, t_max))
+            continue;
+
+        CorridorHit hit;
+        hit.id = *it;
+        hit.entry = start + t_min * length;
+        hit.exit = start + t_max * length;
+        found.push_back(hit);
+    }
+}
+
+void
+CorridorAirspaceReader::load()
+{
+    const Airspace *airspace;
+    while ((airspace = reader->read()) != NULL) {
+        index.insert(*airspace);
+        delete airspace;
+    }
+
+    /* the first entry and the last exit of each airspace over all
+       legs */
+    std::vector<CorridorHit> found;
+    std::vector<int> slot(index.size(), -1);
+    double start = 0;
+
+    for (Route::size_type i = 0; i + 1 < route.size(); ++i) {
+        found.clear();
+        queryLeg(route[i], route[i + 1], start, found);
+
+        for (std::vector<CorridorHit>::const_iterator it = found.begin();
+             it != found.end(); ++it) {
+            if (slot[it->id] < 0) {
+                slot[it->id] = (int)hits.size();
+                hits.push_back(*it);
+            } else {
+                CorridorHit &hit = hits[slot[it->id]];
+                hit.entry = std::min(hit.entry, it->entry);
+                hit.exit = std::max(hit.exit, it->exit);
+            }
+        }
+
+        start += (route[i + 1].position - route[i].position).getMeters();
+    }
+
+    std::sort(hits.begin(), hits.end());
+
+    for (std::vector<CorridorHit>::const_iterator it = hits.begin();
+         it != hits.end(); ++it) {
+        const Airspace &as = index.get(it->id);
+        std::cerr << "corridor: " << (long)lround(it->entry / 100) / 10.
+                  << "km-" << (long)lround(it->exit / 100) / 10.
+                  << "km " << as.getName() << std::endl;
+    }
+
+    if (airspace_writer_options.verbose)
+        std::cerr << "corridor: " << hits.size() << " of " << index.size()
+                  << " airspaces along " << lround(start / 1000)
+                  << "km" << std::endl;
+
+    /* return the airspaces in the order of the input */
+    std::sort(hits.begin(), hits.end(), hit_id_less);
+}
+
+const Airspace *
+CorridorAirspaceReader::read()
+{
+    if (!loaded) {
+        load();
+        loaded = true;
+    }
+
+    if (position >= hits.size())
+        return NULL;
+
+    return new Airspace(index.get(hits[position++].id));
+}
+
+/** extracts the string up to the next colon */
+static const std::string
+next_arg(const char *&p)
+{
+    const char *colon = strchr(p, ':');
+    const std::string value = colon != NULL
+        ? std::string(p, colon - p)
+        : std::string(p);
+
+    p = colon != NULL ? colon + 1 : p + value.length();
+    return value;
+}
+
+AirspaceReader *
+CorridorAirspaceFilter::createFilter(AirspaceReader *reader,
+                                     const char *args) const
+{
+    if (args == NULL || strchr(args, ':') == NULL)
+        throw malformed_input("Route file and corridor width expected");
+
+    const std::string path = next_arg(args);
+    const Distance width = parseDistance(next_arg(args).c_str());
+    if (width.getMeters() < 0)
+        throw malformed_input("The corridor width must not be negative");
+
+    AltitudeBand band;
+    if (*args != 0) {
+        const Altitude bottom = parseAltitude(next_arg(args).c_str());
+        const Altitude top = parseAltitude(next_arg(args).c_str());
+        band = AltitudeBand(bottom, top);
+        if (band.bottom >= band.top)
+            throw malformed_input("The top must be above the bottom");
+        if (*args != 0)
+            throw malformed_input("Garbage after the altitude band");
+    }
+
+    Route route;
+    load_route(path.c_str(), route);
+
+    return new CorridorAirspaceReader(reader, route,
+                                      width.getMeters() / 2 / PLANE_UNIT_METERS,
+                                      band);
+}
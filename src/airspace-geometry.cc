@@ -0,0 +1,563 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "airspace-geometry.hh"
+#include "airspace.hh"
+#include "earth-parser.hh"
+#include "exception.hh"
+
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <iterator>
+
+#include <math.h>
+#include <stdlib.h>
+
+LocalProjection::LocalProjection(const Latitude &reference)
+    :cos_lat(cos((double)reference))
+{
+    if (cos_lat < 0.01)
+        cos_lat = 0.01;
+}
+
+const PlanePoint
+LocalProjection::project(const SurfacePosition &position) const
+{
+    return PlanePoint(position.getLongitude().getValue() * cos_lat,
+                      position.getLatitude().getValue());
+}
+
+const SurfacePosition
+LocalProjection::unproject(const PlanePoint &point) const
+{
+    return SurfacePosition(Latitude((int)lround(point.y)),
+                           Longitude((int)lround(point.x / cos_lat)));
+}
+
+double
+plane_signed_area2(const PlanePointList &polygon)
+{
+    double area = 0;
+
+    for (PlanePointList::size_type i = 0, n = polygon.size(); i < n; ++i) {
+        const PlanePoint &a = polygon[i], &b = polygon[(i + 1) % n];
+        area += a.x * b.y - b.x * a.y;
+    }
+
+    return area;
+}
+
+double
+plane_segment_distance(const PlanePoint &p,
+                       const PlanePoint &a, const PlanePoint &b)
+{
+    const double dx = b.x - a.x, dy = b.y - a.y;
+    const double length2 = dx * dx + dy * dy;
+    double t = 0;
+
+    if (length2 > 0) {
+        t = ((p.x - a.x) * dx + (p.y - a.y) * dy) / length2;
+        if (t < 0)
+            t = 0;
+        else if (t > 1)
+            t = 1;
+    }
+
+    return hypot(p.x - (a.x + t * dx), p.y - (a.y + t * dy));
+}
+
+static int
+sign(double x)
+{
+    return x > 0 ? 1 : (x < 0 ? -1 : 0);
+}
+
+static bool
+on_segment(const PlanePoint &p, const PlanePoint &a, const PlanePoint &b)
+{
+    return p.x >= (a.x < b.x ? a.x : b.x) && p.x <= (a.x > b.x ? a.x : b.x) &&
+        p.y >= (a.y < b.y ? a.y : b.y) && p.y <= (a.y > b.y ? a.y : b.y);
+}
+
+bool
+plane_segments_intersect(const PlanePoint &a, const PlanePoint &b,
+                         const PlanePoint &c, const PlanePoint &d)
+{
+    const int d1 = sign(plane_cross(c, d, a));
+    const int d2 = sign(plane_cross(c, d, b));
+    const int d3 = sign(plane_cross(a, b, c));
+    const int d4 = sign(plane_cross(a, b, d));
+
+    if (d1 * d2 < 0 && d3 * d4 < 0)
+        return true;
+
+    return (d1 == 0 && on_segment(a, c, d)) ||
+        (d2 == 0 && on_segment(b, c, d)) ||
+        (d3 == 0 && on_segment(c, a, b)) ||
+        (d4 == 0 && on_segment(d, a, b));
+}
+
+/** which side of the line o-p is q on?  0 if it is closer than
+    tolerance */
+static int
+side(const PlanePoint &o, const PlanePoint &p, const PlanePoint &q,
+     double tolerance)
+{
+    const double cross = plane_cross(o, p, q);
+    if (fabs(cross) <= tolerance * hypot(p.x - o.x, p.y - o.y))
+        return 0;
+    return sign(cross);
+}
+
+bool
+plane_segments_cross(const PlanePoint &a, const PlanePoint &b,
+                     const PlanePoint &c, const PlanePoint &d,
+                     double tolerance)
+{
+    return side(c, d, a, tolerance) * side(c, d, b, tolerance) < 0 &&
+        side(a, b, c, tolerance) * side(a, b, d, tolerance) < 0;
+}
+
+bool
+plane_polygon_contains(const PlanePointList &polygon, const PlanePoint &p)
+{
+    bool inside = false;
+
+    for (PlanePointList::size_type i = 0, n = polygon.size(),
+             j = n - 1; i < n; j = i++) {
+        const PlanePoint &a = polygon[i], &b = polygon[j];
+
+        if ((a.y > p.y) != (b.y > p.y) &&
+            p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+            inside = !inside;
+    }
+
+    return inside;
+}
+
+double
+plane_polygon_distance(const PlanePointList &polygon, const PlanePoint &p)
+{
+    double result = HUGE_VAL;
+
+    for (PlanePointList::size_type i = 0, n = polygon.size(); i < n; ++i) {
+        const double distance =
+            plane_segment_distance(p, polygon[i], polygon[(i + 1) % n]);
+        if (distance < result)
+            result = distance;
+    }
+
+    return result;
+}
+
+/** a polygon edge for the sweep, with the end points sorted by x */
+struct SweepSegment {
+    PlanePoint left, right;
+};
+
+/**
+ * The order of the segments on the sweep line, from bottom to top,
+ * at the current event position.
+ */
+class SweepOrder {
+    const std::vector<SweepSegment> *segments;
+    const PlanePoint *position;
+
+public:
+    SweepOrder(const std::vector<SweepSegment> &_segments,
+               const PlanePoint &_position)
+        :segments(&_segments), position(&_position) {}
+
+    bool operator ()(unsigned a, unsigned b) const {
+        if (a == b)
+            return false;
+
+        const double ya = y((*segments)[a]), yb = y((*segments)[b]);
+        if (ya < yb)
+            return true;
+        if (yb < ya)
+            return false;
+
+        /* both pass through the event position: the one which rises
+           slower is below on the right side */
+        const double sa = slope((*segments)[a]), sb = slope((*segments)[b]);
+        if (sa < sb)
+            return true;
+        if (sb < sa)
+            return false;
+
+        return a < b;
+    }
+
+private:
+    double y(const SweepSegment &s) const {
+        if (s.right.x > s.left.x)
+            return s.left.y + (position->x - s.left.x) *
+                (s.right.y - s.left.y) / (s.right.x - s.left.x);
+
+        /* vertical: the point closest to the event position */
+        return std::max(s.left.y, std::min(s.right.y, position->y));
+    }
+
+    static double slope(const SweepSegment &s) {
+        return s.right.x > s.left.x
+            ? (s.right.y - s.left.y) / (s.right.x - s.left.x)
+            : HUGE_VAL;
+    }
+};
+
+struct SweepEvent {
+    PlanePoint point;
+    unsigned segment;
+
+    /** insert events are processed before remove events at the same
+        point, so segments which only touch there are compared */
+    bool insert;
+
+    bool operator <(const SweepEvent &other) const {
+        if (point.x < other.point.x)
+            return true;
+        if (other.point.x < point.x)
+            return false;
+        if (point.y < other.point.y)
+            return true;
+        if (other.point.y < point.y)
+            return false;
+        if (insert != other.insert)
+            return insert;
+        return segment < other.segment;
+    }
+};
+
+typedef std::set<unsigned, SweepOrder> ActiveSet;
+
+static bool
+adjacent_edges(unsigned a, unsigned b, unsigned n)
+{
+    return a == (b + 1) % n || b == (a + 1) % n;
+}
+
+/**
+ * Checks the segment against its neighbor on the sweep line, starting
+ * at the specified position and walking in one direction.  Edges
+ * adjacent to the segment are skipped, because they share a vertex
+ * with it; without that, an adjacent edge through the same point
+ * would hide a touching edge behind it.
+ */
+static bool
+sweep_check(const PlanePointList &polygon, const ActiveSet &active,
+            unsigned segment, ActiveSet::const_iterator it, bool up,
+            unsigned &a_r, unsigned &b_r)
+{
+    const unsigned n = polygon.size();
+
+    while (it != active.end()) {
+        if (*it != segment && !adjacent_edges(segment, *it, n)) {
+            if (!plane_segments_intersect(polygon[segment],
+                                          polygon[(segment + 1) % n],
+                                          polygon[*it],
+                                          polygon[(*it + 1) % n]))
+                return false;
+
+            a_r = std::min(segment, *it);
+            b_r = std::max(segment, *it);
+            return true;
+        }
+
+        if (up)
+            ++it;
+        else if (it == active.begin())
+            break;
+        else
+            --it;
+    }
+
+    return false;
+}
+
+static bool
+point_less(const PlanePoint &a, const PlanePoint &b)
+{
+    return a.x < b.x || (!(b.x < a.x) && a.y < b.y);
+}
+
+bool
+plane_polygon_find_intersection(const PlanePointList &polygon,
+                                unsigned &a_r, unsigned &b_r)
+{
+    const unsigned n = polygon.size();
+    if (n < 4)
+        return false;
+
+    std::vector<SweepSegment> segments(n);
+    std::vector<SweepEvent> events;
+    events.reserve(2 * n);
+
+    for (unsigned i = 0; i < n; ++i) {
+        const PlanePoint &a = polygon[i], &b = polygon[(i + 1) % n];
+        SweepSegment &s = segments[i];
+        if (point_less(b, a)) {
+            s.left = b;
+            s.right = a;
+        } else {
+            s.left = a;
+            s.right = b;
+        }
+
+        SweepEvent event;
+        event.segment = i;
+        event.point = s.left;
+        event.insert = true;
+        events.push_back(event);
+        event.point = s.right;
+        event.insert = false;
+        events.push_back(event);
+    }
+
+    std::sort(events.begin(), events.end());
+
+    PlanePoint position;
+    ActiveSet active(SweepOrder(segments, position));
+    std::vector<ActiveSet::iterator> where(n);
+
+    for (std::vector<SweepEvent>::const_iterator e = events.begin();
+         e != events.end(); ++e) {
+        position = e->point;
+
+        if (e->insert) {
+            const ActiveSet::iterator it =
+                active.insert(e->segment).first;
+            where[e->segment] = it;
+
+            if ((it != active.begin() &&
+                 sweep_check(polygon, active, e->segment, std::prev(it),
+                             false, a_r, b_r)) ||
+                sweep_check(polygon, active, e->segment, std::next(it),
+                            true, a_r, b_r))
+                return true;
+        } else {
+            const ActiveSet::iterator it = where[e->segment];
+            if (it != active.begin() && std::next(it) != active.end()) {
+                const ActiveSet::iterator below = std::prev(it);
+                const ActiveSet::iterator above = std::next(it);
+                active.erase(it);
+
+                if (sweep_check(polygon, active, *below, above,
+                                true, a_r, b_r) ||
+                    sweep_check(polygon, active, *above, below,
+                                false, a_r, b_r))
+                    return true;
+            } else
+                active.erase(it);
+        }
+    }
+
+    return false;
+}
+
+bool
+plane_polygon_self_intersects(const PlanePointList &polygon)
+{
+    unsigned a, b;
+    return plane_polygon_find_intersection(polygon, a, b);
+}
+
+void
+GeoBounds::extend(const SurfacePosition &center, double radius)
+{
+    const int latitude = center.getLatitude().getValue();
+    const int longitude = center.getLongitude().getValue();
+    double cos_lat = cos((double)center.getLatitude());
+    if (cos_lat < 0.01)
+        cos_lat = 0.01;
+
+    const int d_latitude = (int)ceil(radius);
+    const int d_longitude = (int)ceil(radius / cos_lat);
+
+    extend(latitude - d_latitude, longitude - d_longitude);
+    extend(latitude + d_latitude, longitude + d_longitude);
+}
+
+void
+GeoBounds::grow(double distance)
+{
+    if (!defined())
+        return;
+
+    /* use the latitude closest to a pole, where a longitude arc
+       minute is shortest */
+    const int latitude = abs(latitude_min) > abs(latitude_max)
+        ? latitude_min : latitude_max;
+    double cos_lat = cos((double)Latitude(latitude));
+    if (cos_lat < 0.01)
+        cos_lat = 0.01;
+
+    const int d_latitude = (int)ceil(distance);
+    const int d_longitude = (int)ceil(distance / cos_lat);
+
+    latitude_min -= d_latitude;
+    latitude_max += d_latitude;
+    longitude_min -= d_longitude;
+    longitude_max += d_longitude;
+}
+
+const GeoBounds
+parseArea(const char *&p)
+{
+    const Position south_west = parsePosition(p);
+    if (*p != ':')
+        throw malformed_input("colon expected after the first corner");
+    ++p;
+
+    const Position north_east = parsePosition(p);
+
+    if (south_west.getLatitude().getValue() >=
+        north_east.getLatitude().getValue() ||
+        south_west.getLongitude().getValue() >=
+        north_east.getLongitude().getValue())
+        throw malformed_input("the area is empty");
+
+    return GeoBounds(south_west, north_east);
+}
+
+const GeoBounds
+airspace_bounds(const Airspace &airspace)
+{
+    GeoBounds bounds;
+
+    const Airspace::EdgeList &edges = airspace.getEdges();
+    for (Airspace::EdgeList::const_iterator it = edges.begin();
+         it != edges.end(); ++it) {
+        const Edge &edge = *it;
+
+        switch (edge.getType()) {
+        case Edge::TYPE_VERTEX:
+            bounds.extend(edge.getEnd());
+            break;
+
+        case Edge::TYPE_CIRCLE:
+            bounds.extend(edge.getCenter(),
+                          edge.getRadius().toUnit(Distance::UNIT_NAUTICAL_MILES).getValue() * 1000.);
+            break;
+
+        case Edge::TYPE_ARC:
+            /* the radius is the distance from the center to the end
+               point */
+            bounds.extend(edge.getCenter(),
+                          (edge.getEnd() - edge.getCenter()).toUnit(Distance::UNIT_NAUTICAL_MILES).getValue() * 1000.);
+            break;
+        }
+    }
+
+    return bounds;
+}
+
+static void
+append_arc(PlanePointList &polygon, const PlanePoint &center, double radius,
+           double start, double delta, double step)
+{
+    const unsigned n = (unsigned)ceil(fabs(delta) / step);
+
+    for (unsigned i = 1; i < n; ++i) {
+        const double angle = start + delta * i / n;
+        polygon.push_back(PlanePoint(center.x + radius * cos(angle),
+                                     center.y + radius * sin(angle)));
+    }
+}
+
+static void
+tessellate(const Airspace &airspace, const LocalProjection &projection,
+           PlanePointList &polygon, EdgeSourceList *sources, double step)
+{
+    step *= M_PI / 180.;
+
+    const Airspace::EdgeList &edges = airspace.getEdges();
+    for (Airspace::EdgeList::const_iterator it = edges.begin();
+         it != edges.end(); ++it) {
+        const Edge &edge = *it;
+
+        switch (edge.getType()) {
+        case Edge::TYPE_VERTEX:
+            polygon.push_back(projection.project(edge.getEnd()));
+            break;
+
+        case Edge::TYPE_CIRCLE:
+            {
+                const PlanePoint center = projection.project(edge.getCenter());
+                const double radius = edge.getRadius()
+                    .toUnit(Distance::UNIT_NAUTICAL_MILES).getValue() * 1000.;
+
+                polygon.push_back(PlanePoint(center.x + radius, center.y));
+                append_arc(polygon, center, radius, 0, 2 * M_PI, step);
+            }
+            break;
+
+        case Edge::TYPE_ARC:
+            {
+                const PlanePoint center = projection.project(edge.getCenter());
+                const PlanePoint end = projection.project(edge.getEnd());
+
+                if (!polygon.empty()) {
+                    /* the plane has y pointing north, so a positive
+                       (clockwise) arc has a decreasing angle */
+                    const PlanePoint &start = polygon.back();
+                    const double a = atan2(start.y - center.y,
+                                           start.x - center.x);
+                    double delta = atan2(end.y - center.y,
+                                         end.x - center.x) - a;
+                    if (edge.getSign() > 0) {
+                        if (delta >= 0)
+                            delta -= 2 * M_PI;
+                    } else {
+                        if (delta <= 0)
+                            delta += 2 * M_PI;
+                    }
+
+                    append_arc(polygon, center,
+                               hypot(end.x - center.x, end.y - center.y),
+                               a, delta, step);
+                }
+
+                polygon.push_back(end);
+            }
+            break;
+        }
+
+        if (sources != NULL)
+            sources->resize(polygon.size(), &edge);
+    }
+}
+
+void
+airspace_tessellate(const Airspace &airspace,
+                    const LocalProjection &projection,
+                    PlanePointList &polygon, double step)
+{
+    tessellate(airspace, projection, polygon, NULL, step);
+}
+
+void
+airspace_tessellate(const Airspace &airspace,
+                    const LocalProjection &projection,
+                    PlanePointList &polygon, EdgeSourceList &sources,
+                    double step)
+{
+    tessellate(airspace, projection, polygon, &sources, step);
+}
@@ -0,0 +1,237 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef __LOGGERTOOLS_AIRSPACE_GEOMETRY_HH
+#define __LOGGERTOOLS_AIRSPACE_GEOMETRY_HH
+
+#include "earth.hh"
+
+#include <vector>
+
+class Airspace;
+class Edge;
+
+/**
+ * A point in a local planar projection.  Both coordinates are in
+ * units of 1/1000 arc minute of latitude (about 1.852 meters), which
+ * is the resolution of the Angle class.
+ */
+struct PlanePoint {
+    double x, y;
+
+    PlanePoint():x(0), y(0) {}
+    PlanePoint(double _x, double _y):x(_x), y(_y) {}
+};
+
+typedef std::vector<PlanePoint> PlanePointList;
+
+/** length of one plane unit in meters */
+static const double PLANE_UNIT_METERS = 1.852;
+
+/**
+ * An equirectangular projection around a reference latitude.  This
+ * is precise enough for the extent of a single airspace.
+ */
+class LocalProjection {
+private:
+    double cos_lat;
+
+public:
+    LocalProjection(const Latitude &reference);
+
+public:
+    const PlanePoint project(const SurfacePosition &position) const;
+    const SurfacePosition unproject(const PlanePoint &point) const;
+};
+
+static inline double
+plane_cross(const PlanePoint &o, const PlanePoint &a, const PlanePoint &b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+/**
+ * Twice the signed area of the polygon; positive when the vertices
+ * are in counter-clockwise order.
+ */
+double
+plane_signed_area2(const PlanePointList &polygon);
+
+/** distance of the point to the line segment a-b */
+double
+plane_segment_distance(const PlanePoint &p,
+                       const PlanePoint &a, const PlanePoint &b);
+
+/** do the closed line segments a-b and c-d intersect? */
+bool
+plane_segments_intersect(const PlanePoint &a, const PlanePoint &b,
+                         const PlanePoint &c, const PlanePoint &d);
+
+/**
+ * Do the line segments a-b and c-d cross, i.e. are the end points of
+ * each one on both sides of the other one?  Touching and overlapping
+ * segments don't cross, and end points closer than tolerance to the
+ * other line count as touching.
+ */
+bool
+plane_segments_cross(const PlanePoint &a, const PlanePoint &b,
+                     const PlanePoint &c, const PlanePoint &d,
+                     double tolerance = 0);
+
+/**
+ * Is the point inside the closed polygon?  Points on the boundary
+ * may be reported either way.
+ */
+bool
+plane_polygon_contains(const PlanePointList &polygon, const PlanePoint &p);
+
+/** distance of the point to the boundary of the closed polygon */
+double
+plane_polygon_distance(const PlanePointList &polygon, const PlanePoint &p);
+
+/**
+ * Checks whether any two non-adjacent edges of the closed polygon
+ * intersect.
+ */
+bool
+plane_polygon_self_intersects(const PlanePointList &polygon);
+
+/**
+ * Like plane_polygon_self_intersects(), and returns the two
+ * intersecting edges (edge i goes from vertex i to vertex i+1).  This
+ * is a sweep line algorithm (Shamos-Hoey), it runs in O(n log n) and
+ * finds one intersection if there is any.
+ */
+bool
+plane_polygon_find_intersection(const PlanePointList &polygon,
+                                unsigned &a_r, unsigned &b_r);
+
+/**
+ * A latitude/longitude aligned bounding box, in the units of the
+ * Angle class.
+ */
+struct GeoBounds {
+    int latitude_min, latitude_max, longitude_min, longitude_max;
+
+    GeoBounds()
+        :latitude_min(1), latitude_max(0),
+         longitude_min(1), longitude_max(0) {}
+
+    GeoBounds(const SurfacePosition &a, const SurfacePosition &b)
+        :latitude_min(a.getLatitude().getValue()),
+         latitude_max(a.getLatitude().getValue()),
+         longitude_min(a.getLongitude().getValue()),
+         longitude_max(a.getLongitude().getValue()) {
+        extend(b);
+    }
+
+    bool defined() const {
+        return latitude_min <= latitude_max;
+    }
+
+    void extend(int latitude, int longitude) {
+        if (!defined()) {
+            latitude_min = latitude_max = latitude;
+            longitude_min = longitude_max = longitude;
+            return;
+        }
+
+        if (latitude < latitude_min)
+            latitude_min = latitude;
+        if (latitude > latitude_max)
+            latitude_max = latitude;
+        if (longitude < longitude_min)
+            longitude_min = longitude;
+        if (longitude > longitude_max)
+            longitude_max = longitude;
+    }
+
+    void extend(const SurfacePosition &position) {
+        extend(position.getLatitude().getValue(),
+               position.getLongitude().getValue());
+    }
+
+    void extend(const GeoBounds &other) {
+        if (other.defined()) {
+            extend(other.latitude_min, other.longitude_min);
+            extend(other.latitude_max, other.longitude_max);
+        }
+    }
+
+    /** add a circle; the radius is in 1/1000 arc minutes of
+        latitude, i.e. 1/1000 nautical miles */
+    void extend(const SurfacePosition &center, double radius);
+
+    /** enlarges the box on all sides; the distance is in 1/1000 arc
+        minutes of latitude */
+    void grow(double distance);
+
+    bool overlaps(const GeoBounds &other) const {
+        return defined() && other.defined() &&
+            latitude_min <= other.latitude_max &&
+            other.latitude_min <= latitude_max &&
+            longitude_min <= other.longitude_max &&
+            other.longitude_min <= longitude_max;
+    }
+
+    bool contains(const SurfacePosition &position) const {
+        const int latitude = position.getLatitude().getValue();
+        const int longitude = position.getLongitude().getValue();
+        return defined() &&
+            latitude >= latitude_min && latitude <= latitude_max &&
+            longitude >= longitude_min && longitude <= longitude_max;
+    }
+};
+
+/**
+ * Parses an area given by its south west and north east corner,
+ * separated by a colon.  Throws malformed_input on error.
+ */
+const GeoBounds
+parseArea(const char *&p);
+
+/**
+ * Calculates the bounding box of an airspace.  Arcs and circles are
+ * covered completely, and arcs may be overestimated.
+ */
+const GeoBounds
+airspace_bounds(const Airspace &airspace);
+
+/**
+ * Converts the outline of an airspace to a polygon.  Arcs and circles
+ * are approximated with one vertex every step degrees.
+ */
+void
+airspace_tessellate(const Airspace &airspace,
+                    const LocalProjection &projection,
+                    PlanePointList &polygon, double step = 5);
+
+typedef std::vector<const Edge *> EdgeSourceList;
+
+/**
+ * Like airspace_tessellate(), but also appends the edge which
+ * produced each polygon vertex to the sources list.
+ */
+void
+airspace_tessellate(const Airspace &airspace,
+                    const LocalProjection &projection,
+                    PlanePointList &polygon, EdgeSourceList &sources,
+                    double step = 5);
+
+#endif
@@ -0,0 +1,154 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "airspace-index.hh"
+
+#include <algorithm>
+
+GeoGridIndex::id_t
+GeoGridIndex::insert(const GeoBounds &b)
+{
+    const id_t id = size();
+    bounds.push_back(b);
+
+    if (!b.defined())
+        /* never found */
+        return id;
+
+    for (int y = cell(b.latitude_min); y <= cell(b.latitude_max); ++y)
+        for (int x = cell(b.longitude_min); x <= cell(b.longitude_max); ++x)
+            cells[key(y, x)].push_back(id);
+
+    return id;
+}
+
+void
+GeoGridIndex::query(const GeoBounds &area, IdList &result) const
+{
+    if (!area.defined())
+        return;
+
+    const IdList::size_type start = result.size();
+
+    const int y_min = cell(area.latitude_min), y_max = cell(area.latitude_max);
+    const int x_min = cell(area.longitude_min), x_max = cell(area.longitude_max);
+    if ((uint64_t)(y_max - y_min + 1) * (uint64_t)(x_max - x_min + 1) >
+        bounds.size()) {
+        /* the area is so large that a linear scan is cheaper */
+        for (id_t id = 0; id < size(); ++id)
+            if (bounds[id].overlaps(area))
+                result.push_back(id);
+        return;
+    }
+
+    for (int y = y_min; y <= y_max; ++y) {
+        for (int x = x_min; x <= x_max; ++x) {
+            const std::unordered_map<uint64_t, IdList>::const_iterator i =
+                cells.find(key(y, x));
+            if (i == cells.end())
+                continue;
+
+            for (IdList::const_iterator it = i->second.begin();
+                 it != i->second.end(); ++it)
+                if (bounds[*it].overlaps(area))
+                    result.push_back(*it);
+        }
+    }
+
+    /* an object which covers several cells was found more than
+       once */
+    std::sort(result.begin() + start, result.end());
+    result.erase(std::unique(result.begin() + start, result.end()),
+                 result.end());
+}
+
+void
+AltitudeBandIndex::build(const std::vector<AltitudeBand> &bands)
+{
+    entries.resize(bands.size());
+    for (id_t id = 0; id < bands.size(); ++id) {
+        entries[id].band = bands[id];
+        entries[id].id = id;
+    }
+
+    std::sort(entries.begin(), entries.end());
+
+    block_top.assign((entries.size() + BLOCK_SIZE - 1) / BLOCK_SIZE,
+                     LONG_MIN);
+    for (unsigned i = 0; i < entries.size(); ++i)
+        if (entries[i].band.top > block_top[i / BLOCK_SIZE])
+            block_top[i / BLOCK_SIZE] = entries[i].band.top;
+}
+
+void
+AltitudeBandIndex::query(const AltitudeBand &band, IdList &result) const
+{
+    /* all entries from here on start above the band */
+    Entry key;
+    key.band.bottom = band.top;
+    const unsigned end =
+        std::lower_bound(entries.begin(), entries.end(), key) - entries.begin();
+
+    for (unsigned block = 0; block * BLOCK_SIZE < end; ++block) {
+        if (block_top[block] <= band.bottom)
+            continue;
+
+        const unsigned block_end = std::min(end, (block + 1) * BLOCK_SIZE);
+        for (unsigned i = block * BLOCK_SIZE; i < block_end; ++i)
+            if (entries[i].band.top > band.bottom)
+                result.push_back(entries[i].id);
+    }
+}
+
+AirspaceIndex::id_t
+AirspaceIndex::insert(const Airspace &airspace)
+{
+    airspaces.push_back(airspace);
+    bands.push_back(AltitudeBand(airspace.getBottom(), airspace.getTop()));
+    dirty = true;
+
+    return grid.insert(airspace_bounds(airspace));
+}
+
+void
+AirspaceIndex::query(const GeoBounds &area, const AltitudeBand &band,
+                     IdList &result)
+{
+    if (!area.defined()) {
+        if (dirty) {
+            band_index.build(bands);
+            dirty = false;
+        }
+
+        band_index.query(band, result);
+        return;
+    }
+
+    /* the grid is usually more selective; check the cached bands of
+       its results */
+    const IdList::size_type start = result.size();
+    grid.query(area, result);
+
+    IdList::iterator out = result.begin() + start;
+    for (IdList::const_iterator it = out; it != result.end(); ++it)
+        if (bands[*it].overlaps(band))
+            *out++ = *it;
+
+    result.erase(out, result.end());
+}
@@ -0,0 +1,204 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef __LOGGERTOOLS_AIRSPACE_INDEX_HH
+#define __LOGGERTOOLS_AIRSPACE_INDEX_HH
+
+#include "airspace-geometry.hh"
+#include "airspace.hh"
+
+#include <vector>
+#include <unordered_map>
+
+#include <stdint.h>
+#include <limits.h>
+
+/**
+ * A uniform grid over latitude/longitude which finds the objects
+ * whose bounding box overlaps a given area.  Objects are identified
+ * by consecutive numbers, starting with zero.
+ */
+class GeoGridIndex {
+public:
+    typedef unsigned id_t;
+    typedef std::vector<id_t> IdList;
+
+    /** the default cell size: a quarter degree */
+    static const int DEFAULT_CELL_SIZE = 15000;
+
+private:
+    int cell_size;
+    std::vector<GeoBounds> bounds;
+    std::unordered_map<uint64_t, IdList> cells;
+
+public:
+    explicit GeoGridIndex(int _cell_size = DEFAULT_CELL_SIZE)
+        :cell_size(_cell_size) {}
+
+public:
+    id_t size() const {
+        return (id_t)bounds.size();
+    }
+
+    const GeoBounds &getBounds(id_t id) const {
+        return bounds[id];
+    }
+
+    /** adds an object and returns its id; objects with undefined
+        bounds are never found */
+    id_t insert(const GeoBounds &b);
+
+    /**
+     * Appends the ids of all objects overlapping the area to the
+     * list, in ascending order and without duplicates.
+     */
+    void query(const GeoBounds &area, IdList &result) const;
+
+private:
+    int cell(int value) const {
+        /* round towards negative infinity */
+        return value >= 0
+            ? value / cell_size
+            : -((-value - 1) / cell_size) - 1;
+    }
+
+    static uint64_t key(int latitude_cell, int longitude_cell) {
+        return ((uint64_t)(uint32_t)latitude_cell << 32) |
+            (uint32_t)longitude_cell;
+    }
+};
+
+/**
+ * The vertical extent of an airspace in feet.  The references (MSL,
+ * GND, flight level) are not converted, because that would need
+ * terrain and pressure data; the values are compared as if they were
+ * all MSL.  An undefined bottom is LONG_MIN, an undefined top is
+ * LONG_MAX.
+ */
+struct AltitudeBand {
+    long bottom, top;
+
+    AltitudeBand():bottom(LONG_MIN), top(LONG_MAX) {}
+
+    AltitudeBand(long _bottom, long _top)
+        :bottom(_bottom), top(_top) {}
+
+    AltitudeBand(const Altitude &_bottom, const Altitude &_top)
+        :bottom(_bottom.defined()
+                ? _bottom.toUnit(Altitude::UNIT_FEET).getValue()
+                : LONG_MIN),
+         top(_top.defined()
+             ? _top.toUnit(Altitude::UNIT_FEET).getValue()
+             : LONG_MAX) {}
+
+    /** do the bands overlap?  Touching bands do not. */
+    bool overlaps(const AltitudeBand &other) const {
+        return bottom < other.top && other.bottom < top;
+    }
+};
+
+/**
+ * A sorted band index: the bands are sorted by their bottom, and each
+ * block of entries knows its highest top.  A query finds the entries
+ * starting below the band with a binary search, and skips all blocks
+ * which end below it.
+ */
+class AltitudeBandIndex {
+public:
+    typedef GeoGridIndex::id_t id_t;
+    typedef GeoGridIndex::IdList IdList;
+
+private:
+    static const unsigned BLOCK_SIZE = 64;
+
+    struct Entry {
+        AltitudeBand band;
+        id_t id;
+
+        bool operator <(const Entry &other) const {
+            return band.bottom < other.band.bottom;
+        }
+    };
+
+    std::vector<Entry> entries;
+
+    /** the highest top of each block */
+    std::vector<long> block_top;
+
+public:
+    /** builds the index; the position in the vector is the id */
+    void build(const std::vector<AltitudeBand> &bands);
+
+    /**
+     * Appends the ids of all bands overlapping the specified one to
+     * the list, in no particular order.
+     */
+    void query(const AltitudeBand &band, IdList &result) const;
+};
+
+/**
+ * An index for three dimensional queries: a grid over the bounding
+ * boxes combined with an AltitudeBandIndex over the altitude bands.
+ * The bands are converted once when the airspace is added.
+ */
+class AirspaceIndex {
+public:
+    typedef GeoGridIndex::id_t id_t;
+    typedef GeoGridIndex::IdList IdList;
+
+private:
+    std::vector<Airspace> airspaces;
+    std::vector<AltitudeBand> bands;
+    GeoGridIndex grid;
+    AltitudeBandIndex band_index;
+    bool dirty;
+
+public:
+    AirspaceIndex():dirty(false) {}
+
+public:
+    id_t size() const {
+        return (id_t)airspaces.size();
+    }
+
+    const Airspace &get(id_t id) const {
+        return airspaces[id];
+    }
+
+    const GeoBounds &getBounds(id_t id) const {
+        return grid.getBounds(id);
+    }
+
+    const AltitudeBand &getBand(id_t id) const {
+        return bands[id];
+    }
+
+    /** adds an airspace and returns its id */
+    id_t insert(const Airspace &airspace);
+
+    /**
+     * Appends the ids of all airspaces which overlap the area and the
+     * altitude band, in no particular order.  An undefined area means
+     * no horizontal restriction.
+     */
+    void query(const GeoBounds &area, const AltitudeBand &band,
+               IdList &result);
+};
+
+#endif
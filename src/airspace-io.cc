@@ -21,6 +21,9 @@
 
 #include <string.h>
 
+AirspaceWriterOptions airspace_writer_options;
+AirspaceReaderOptions airspace_reader_options;
+
 static const OpenAirAirspaceFormat openAirFormat;
 static const CenfisAirspaceFormat cenfisFormat;
 static const CenfisHexAirspaceFormat cenfisHexFormat;
@@ -44,3 +47,21 @@ const AirspaceFormat *getAirspaceFormat(const char *ext) {
     else
         return NULL;
 }
+
+static const SimplifyAirspaceFilter simplifyFilter;
+static const AltitudeAirspaceFilter altitudeFilter;
+static const CorridorAirspaceFilter corridorFilter;
+static const ValidateAirspaceFilter validateFilter;
+
+const AirspaceFilter *getAirspaceFilter(const char *name) {
+    if (strcmp(name, "simplify") == 0)
+        return &simplifyFilter;
+    else if (strcmp(name, "altitude") == 0)
+        return &altitudeFilter;
+    else if (strcmp(name, "corridor") == 0)
+        return &corridorFilter;
+    else if (strcmp(name, "validate") == 0)
+        return &validateFilter;
+    else
+        return NULL;
+}
@@ -22,10 +22,12 @@
 
 #include "io.hh"
 #include "airspace.hh"
+#include "airspace-geometry.hh"
 
 typedef Reader<Airspace> AirspaceReader;
 typedef Writer<Airspace> AirspaceWriter;
 typedef Format<Airspace> AirspaceFormat;
+typedef Filter<Airspace> AirspaceFilter;
 
 class OpenAirAirspaceFormat : public AirspaceFormat {
 public:
@@ -65,4 +67,89 @@ public:
 
 const AirspaceFormat *getAirspaceFormat(const char *ext);
 
+/** settings for the airspace writers, configured by asconv */
+struct AirspaceWriterOptions {
+    /** print statistics to stderr */
+    bool verbose;
+
+    /** the number of threads compiling airspaces */
+    unsigned jobs;
+
+    /** the name of the output file, or NULL for stdout; writers
+        which create additional files derive their names from it */
+    const char *filename;
+
+    /** SVG: the image width in pixels (per tile in tiled mode) */
+    unsigned svg_width;
+
+    /** SVG: the visible area; undefined means the extent of all
+        airspaces */
+    GeoBounds svg_area;
+
+    /** SVG: split the image into this many tiles per row and column;
+        0 disables tiling */
+    unsigned svg_tiles;
+
+    AirspaceWriterOptions()
+        :verbose(false), jobs(1), filename(NULL),
+         svg_width(1000), svg_tiles(0) {}
+};
+
+extern AirspaceWriterOptions airspace_writer_options;
+
+/** settings for the airspace readers, configured by asconv */
+struct AirspaceReaderOptions {
+    /** the number of threads parsing the input */
+    unsigned jobs;
+
+    AirspaceReaderOptions():jobs(1) {}
+};
+
+extern AirspaceReaderOptions airspace_reader_options;
+
+
+/**
+ * Creates a writer which drops duplicate airspaces (equal type,
+ * altitudes and outline), and passes all others to the specified
+ * writer.  If the tolerance is defined, airspaces whose outlines
+ * differ by less than that are reported on stderr.
+ */
+AirspaceWriter *
+createMergeAirspaceWriter(AirspaceWriter *next, const Distance &tolerance);
+
+class SimplifyAirspaceFilter : public AirspaceFilter {
+public:
+    virtual AirspaceReader *createFilter(AirspaceReader *reader,
+                                         const char *args) const;
+};
+
+class AltitudeAirspaceFilter : public AirspaceFilter {
+public:
+    virtual AirspaceReader *createFilter(AirspaceReader *reader,
+                                         const char *args) const;
+};
+
+/**
+ * Passes only airspaces within a corridor around a route, which is
+ * read from a turn point file or from the task of an LXN file.
+ */
+class CorridorAirspaceFilter : public AirspaceFilter {
+public:
+    virtual AirspaceReader *createFilter(AirspaceReader *reader,
+                                         const char *args) const;
+};
+
+/**
+ * Reports defective airspaces (duplicate vertices, unclosed or
+ * self-intersecting outlines) on stderr.  With the argument "repair",
+ * duplicate vertices and closure gaps are fixed.
+ */
+class ValidateAirspaceFilter : public AirspaceFilter {
+public:
+    virtual AirspaceReader *createFilter(AirspaceReader *reader,
+                                         const char *args) const;
+};
+
+const AirspaceFilter *getAirspaceFilter(const char *name);
+
 #endif
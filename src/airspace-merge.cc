@@ -0,0 +1,369 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "airspace.hh"
+#include "airspace-io.hh"
+#include "airspace-geometry.hh"
+#include "airspace-index.hh"
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include <math.h>
+#include <stdint.h>
+
+/**
+ * The canonical form of an airspace: two airspaces are duplicates if
+ * their keys are equal.
+ */
+typedef std::vector<int> CanonicalKey;
+
+struct RingEdge {
+    int kind, sign;
+    SurfacePosition end, center;
+};
+
+static void
+append_altitude(CanonicalKey &key, const Altitude &altitude)
+{
+    const Altitude feet = altitude.toUnit(Altitude::UNIT_FEET);
+    key.push_back(feet.getUnit());
+    key.push_back(feet.getRef());
+    key.push_back((int)feet.getValue());
+}
+
+static void
+append_position(CanonicalKey &key, const SurfacePosition &position)
+{
+    key.push_back(position.getLatitude().getValue());
+    key.push_back(position.getLongitude().getValue());
+}
+
+static bool
+position_less(const SurfacePosition &a, const SurfacePosition &b)
+{
+    return a.getLatitude().getValue() < b.getLatitude().getValue() ||
+        (a.getLatitude().getValue() == b.getLatitude().getValue() &&
+         a.getLongitude().getValue() < b.getLongitude().getValue());
+}
+
+/**
+ * Appends the ring, starting with edge "first" and walking in the
+ * given direction.  An edge describes the way from the previous end
+ * point to its own end point; walking backwards, this becomes the
+ * way from its end point to the previous one, with the opposite arc
+ * direction.
+ */
+static void
+append_ring(CanonicalKey &key, const std::vector<RingEdge> &ring,
+            unsigned first, bool reverse)
+{
+    const unsigned n = ring.size();
+
+    for (unsigned i = 0; i < n; ++i) {
+        if (!reverse) {
+            const RingEdge &edge = ring[(first + i) % n];
+            key.push_back(edge.kind);
+            append_position(key, edge.end);
+            append_position(key, edge.center);
+            key.push_back(edge.sign);
+        } else {
+            /* "first" is the position of the end point, i.e. the
+               first edge walked is the next one in forward
+               order */
+            const RingEdge &edge = ring[(first + n + 1 - i) % n];
+            const RingEdge &previous = ring[(first + n - i) % n];
+            key.push_back(edge.kind);
+            append_position(key, previous.end);
+            append_position(key, edge.center);
+            key.push_back(-edge.sign);
+        }
+    }
+}
+
+/**
+ * Builds the canonical key of an airspace.  The ring of edges is
+ * rotated to start at its smallest vertex, and the orientation with
+ * the smaller key is chosen, so the same outline digitized with a
+ * different start vertex or orientation yields the same key.  The
+ * name is not part of the key.
+ */
+static void
+canonical_key(const Airspace &airspace, CanonicalKey &key)
+{
+    key.push_back(airspace.getType());
+    append_altitude(key, airspace.getBottom());
+    append_altitude(key, airspace.getTop());
+
+    std::vector<RingEdge> ring;
+    std::vector<CanonicalKey> circles;
+
+    const Airspace::EdgeList &edges = airspace.getEdges();
+    for (Airspace::EdgeList::const_iterator it = edges.begin();
+         it != edges.end(); ++it) {
+        const Edge &edge = *it;
+
+        if (edge.getType() == Edge::TYPE_CIRCLE) {
+            circles.push_back(CanonicalKey());
+            append_position(circles.back(), edge.getCenter());
+            circles.back().push_back((int)lround(edge.getRadius().getMeters()));
+            continue;
+        }
+
+        RingEdge r;
+        r.kind = edge.getType();
+        r.end = edge.getEnd();
+        if (edge.getType() == Edge::TYPE_ARC) {
+            r.center = edge.getCenter();
+            r.sign = edge.getSign();
+        } else {
+            r.center = SurfacePosition(Latitude(0), Longitude(0));
+            r.sign = 0;
+        }
+
+        /* drop zero-length lines, e.g. a repeated vertex */
+        if (r.kind == Edge::TYPE_VERTEX && !ring.empty() &&
+            ring.back().end == r.end)
+            continue;
+
+        ring.push_back(r);
+    }
+
+    /* the implicit closing line makes an explicit closing vertex
+       redundant */
+    if (ring.size() > 1 && ring.front().kind == Edge::TYPE_VERTEX &&
+        ring.front().end == ring.back().end)
+        ring.erase(ring.begin());
+
+    key.push_back((int)ring.size());
+
+    if (!ring.empty()) {
+        unsigned min = 0;
+        for (unsigned i = 1; i < ring.size(); ++i)
+            if (position_less(ring[i].end, ring[min].end))
+                min = i;
+
+        /* try all rotations starting at the smallest vertex (usually
+           there is only one), in both directions */
+        CanonicalKey best, candidate;
+        for (unsigned i = 0; i < ring.size(); ++i) {
+            if (!(ring[i].end == ring[min].end))
+                continue;
+
+            for (unsigned reverse = 0; reverse < 2; ++reverse) {
+                candidate.clear();
+                append_ring(candidate, ring, i, reverse != 0);
+                if (best.empty() || candidate < best)
+                    best.swap(candidate);
+            }
+        }
+
+        key.insert(key.end(), best.begin(), best.end());
+    }
+
+    /* circles are sorted, the order in the file does not matter */
+    std::sort(circles.begin(), circles.end());
+    for (std::vector<CanonicalKey>::const_iterator it = circles.begin();
+         it != circles.end(); ++it)
+        key.insert(key.end(), it->begin(), it->end());
+}
+
+/** FNV-1a */
+static uint64_t
+hash_key(const CanonicalKey &key)
+{
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (CanonicalKey::const_iterator it = key.begin();
+         it != key.end(); ++it) {
+        uint32_t value = (uint32_t)*it;
+        for (unsigned i = 0; i < 4; ++i) {
+            hash ^= value & 0xff;
+            hash *= 1099511628211ULL;
+            value >>= 8;
+        }
+    }
+
+    return hash;
+}
+
+/**
+ * The largest distance of a vertex of a to the boundary of b.
+ * Returns early as soon as the limit is exceeded.
+ */
+static double
+directed_hausdorff(const PlanePointList &a, const PlanePointList &b,
+                   double limit)
+{
+    double result = 0;
+
+    for (PlanePointList::const_iterator it = a.begin(); it != a.end(); ++it) {
+        const double distance = plane_polygon_distance(b, *it);
+        if (distance > result) {
+            result = distance;
+            if (result > limit)
+                break;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * A writer which drops exact duplicates, and passes all other
+ * airspaces to the next writer.  Optionally, it warns about
+ * airspaces of the same type whose outlines differ by less than a
+ * tolerance.
+ */
+class MergeAirspaceWriter : public AirspaceWriter {
+private:
+    AirspaceWriter *next;
+
+    /** in plane units; 0 disables the near-duplicate check */
+    double tolerance;
+
+    std::vector<CanonicalKey> keys;
+    std::unordered_multimap<uint64_t, unsigned> hashes;
+
+    /** the airspaces which were written, only for the near-duplicate
+        check */
+    std::vector<Airspace> written;
+    GeoGridIndex index;
+
+    unsigned long num_duplicates, num_near;
+
+public:
+    MergeAirspaceWriter(AirspaceWriter *_next, double _tolerance)
+        :next(_next), tolerance(_tolerance),
+         num_duplicates(0), num_near(0) {}
+
+    virtual ~MergeAirspaceWriter() {
+        delete next;
+    }
+
+public:
+    virtual void write(const Airspace &as);
+    virtual void flush();
+
+private:
+    bool isDuplicate(const Airspace &as);
+    void checkNear(const Airspace &as);
+};
+
+bool
+MergeAirspaceWriter::isDuplicate(const Airspace &as)
+{
+    CanonicalKey key;
+    canonical_key(as, key);
+
+    const uint64_t hash = hash_key(key);
+    typedef std::unordered_multimap<uint64_t, unsigned>::const_iterator iterator;
+    const std::pair<iterator, iterator> range = hashes.equal_range(hash);
+    for (iterator it = range.first; it != range.second; ++it)
+        if (keys[it->second] == key)
+            return true;
+
+    hashes.insert(std::make_pair(hash, (unsigned)keys.size()));
+    keys.push_back(CanonicalKey());
+    keys.back().swap(key);
+    return false;
+}
+
+void
+MergeAirspaceWriter::checkNear(const Airspace &as)
+{
+    GeoBounds bounds = airspace_bounds(as);
+    if (!bounds.defined())
+        return;
+
+    GeoBounds area = bounds;
+    area.grow(tolerance);
+
+    GeoGridIndex::IdList candidates;
+    index.query(area, candidates);
+
+    const LocalProjection projection(Latitude((bounds.latitude_min +
+                                               bounds.latitude_max) / 2));
+    PlanePointList polygon, other;
+
+    for (GeoGridIndex::IdList::const_iterator it = candidates.begin();
+         it != candidates.end(); ++it) {
+        const Airspace &candidate = written[*it];
+        if (candidate.getType() != as.getType())
+            continue;
+
+        if (polygon.empty())
+            airspace_tessellate(as, projection, polygon);
+
+        other.clear();
+        airspace_tessellate(candidate, projection, other);
+        if (polygon.empty() || other.empty())
+            continue;
+
+        double distance = directed_hausdorff(polygon, other, tolerance);
+        if (distance <= tolerance)
+            distance = std::max(distance,
+                                directed_hausdorff(other, polygon, tolerance));
+        if (distance > tolerance)
+            continue;
+
+        ++num_near;
+        std::cerr << "merge: '" << as.getName()
+                  << "' is similar to '" << candidate.getName()
+                  << "' (" << (long)(distance * PLANE_UNIT_METERS)
+                  << "m)" << std::endl;
+    }
+
+    index.insert(bounds);
+    written.push_back(as);
+}
+
+void
+MergeAirspaceWriter::write(const Airspace &as)
+{
+    if (isDuplicate(as)) {
+        ++num_duplicates;
+        return;
+    }
+
+    if (tolerance > 0)
+        checkNear(as);
+
+    next->write(as);
+}
+
+void
+MergeAirspaceWriter::flush()
+{
+    next->flush();
+
+    if (airspace_writer_options.verbose)
+        std::cerr << "merge: " << num_duplicates << " duplicates dropped, "
+                  << num_near << " similar airspaces" << std::endl;
+}
+
+AirspaceWriter *
+createMergeAirspaceWriter(AirspaceWriter *next, const Distance &tolerance)
+{
+    return new MergeAirspaceWriter(next, tolerance.defined()
+                                   ? tolerance.getMeters() / PLANE_UNIT_METERS
+                                   : 0);
+}
@@ -20,61 +20,221 @@
 #include "exception.hh"
 #include "airspace.hh"
 #include "airspace-io.hh"
+#include "thread-pool.hh"
 
 #include <istream>
+#include <streambuf>
+#include <vector>
+#include <list>
+#include <iterator>
+#include <exception>
 
 #include <assert.h>
 #include <stdlib.h>
-#include <stdio.h>
 #include <string.h>
-
+#include <math.h>
+
+/**
+ * Reads lines from a stream buffer in large blocks, or from a memory
+ * range.  The lines are returned in place, null-terminated, with
+ * leading spaces and trailing whitespace removed.  The byte which was
+ * overwritten by the null terminator is restored when the next line
+ * is read, so the memory range is unmodified afterwards.
+ */
 class LineInputStream {
 private:
-    std::istream *stream;
+    static const size_t BUFFER_SIZE = 0x10000;
+
+    /** the stream buffer, or NULL if reading from memory */
+    std::streambuf *buf;
     unsigned line_number;
-    std::string buffer;
+
+    char *data;
+    size_t size, start, end;
+    bool eof;
+
+    /** the last line, which is returned again after unread() */
+    char *last;
+    bool unread_flag;
+
+    /** the null terminator of the last line, and the byte it
+        replaced */
+    char *terminator, saved;
 
 public:
-    LineInputStream(std::istream *_stream)
-        :stream(_stream), line_number(0) {}
+    LineInputStream(std::istream *stream)
+        :buf(stream->rdbuf()), line_number(0),
+         data(new char[BUFFER_SIZE]), size(BUFFER_SIZE),
+         start(0), end(0), eof(false),
+         last(NULL), unread_flag(false), terminator(NULL) {}
+
+    /**
+     * Reads lines from memory.  There must be one writable byte
+     * after the range, unless it ends with a newline character.
+     *
+     * @param first_line the line number of the first line
+     */
+    LineInputStream(char *begin, char *_end, unsigned first_line)
+        :buf(NULL), line_number(first_line - 1),
+         data(begin), size(_end - begin),
+         start(0), end(size), eof(true),
+         last(NULL), unread_flag(false), terminator(NULL) {}
+
+    ~LineInputStream() {
+        restore();
+
+        if (buf != NULL)
+            delete[] data;
+    }
+
+    LineInputStream(const LineInputStream &) = delete;
+    LineInputStream &operator =(const LineInputStream &) = delete;
+
+private:
+    void restore() {
+        if (terminator != NULL) {
+            *terminator = saved;
+            terminator = NULL;
+        }
+    }
+
+    /** returns the next raw line, without the newline character */
+    char *next_raw(size_t &length_r) {
+        while (true) {
+            char *p = data + start;
+            char *newline = (char*)memchr(p, '\n', end - start);
+            if (newline != NULL) {
+                length_r = newline - p;
+                start = newline + 1 - data;
+                return p;
+            }
+
+            if (eof) {
+                if (start == end)
+                    return NULL;
+
+                /* the last line has no newline character */
+                length_r = end - start;
+                start = end;
+                return p;
+            }
+
+            memmove(data, p, end - start);
+            end -= start;
+            start = 0;
+
+            /* reserve one byte for the null terminator */
+            if (end >= size - 1)
+                throw malformed_input("line too long");
+
+            std::streamsize nbytes = buf->sgetn(data + end, size - 1 - end);
+            if (nbytes <= 0)
+                eof = true;
+            else
+                end += (size_t)nbytes;
+        }
+    }
 
 public:
-    void getline(char *p, size_t max_size) {
-        if (!buffer.empty()) {
-            size_t length = buffer.length();
-            if (length >= max_size)
-                length = max_size - 1;
-            memcpy(p, buffer.data(), length);
-            p[length] = 0;
-            buffer.clear();
-            return;
+    /**
+     * Returns the next line, or NULL on end of file.
+     */
+    char *getline(size_t &length_r) {
+        if (unread_flag) {
+            unread_flag = false;
+            length_r = terminator - last;
+            return last;
         }
 
-        stream->getline(p, max_size);
+        restore();
+
+        size_t length;
+        char *p = next_raw(length);
+        if (p == NULL)
+            return NULL;
+
         ++line_number;
-    }
 
-    void putline(const char *p) {
-        assert(buffer.empty());
-        buffer = p;
+        while (length > 0 && *p == ' ') {
+            ++p;
+            --length;
+        }
+
+        while (length > 0 && (unsigned char)p[length - 1] <= 0x20 &&
+               p[length - 1] != 0)
+            --length;
+
+        /* this overwrites the newline character, trailing
+           whitespace, or the spare byte after the data */
+        terminator = p + length;
+        saved = *terminator;
+        *terminator = 0;
+
+        length_r = length;
+        return last = p;
     }
 
-    bool eof() const {
-        return stream->eof();
+    /**
+     * Return the last line again with the next getline() call.
+     */
+    void unread() {
+        assert(last != NULL);
+        assert(!unread_flag);
+        unread_flag = true;
     }
 
     const input_location get_location() const {
         return input_location(line_number);
     }
+
+    /**
+     * Returns the position of the next line in memory, and its line
+     * number.
+     */
+    char *tell(unsigned &line_r) const {
+        if (unread_flag) {
+            line_r = line_number;
+            return last;
+        }
+
+        line_r = line_number + 1;
+        return data + start;
+    }
 };
 
 class OpenAirAirspaceReader : public AirspaceReader {
 private:
     LineInputStream stream;
 
+    /** have there been commands since the last airspace which was
+        finished by an empty line or the next "AC"? */
+    bool dirty;
+
 public:
     OpenAirAirspaceReader(std::istream *stream);
 
+    /**
+     * Reads airspaces from a memory range, see LineInputStream.
+     */
+    OpenAirAirspaceReader(char *begin, char *end, unsigned first_line);
+
+    /**
+     * Is the reader in its initial state?  If this is true at the
+     * end of the input, a following block may be parsed by another
+     * reader with the same result.
+     */
+    bool is_clean() const {
+        return !dirty;
+    }
+
+    /**
+     * Returns the position of the next line, when reading from
+     * memory.
+     */
+    char *tell(unsigned &line_r) const {
+        return stream.tell(line_r);
+    }
+
 private:
     /**
      * Skip the current airspace, discard all lines.
@@ -88,44 +248,59 @@ public:
 };
 
 OpenAirAirspaceReader::OpenAirAirspaceReader(std::istream *_stream)
-    :stream(_stream) {}
-
-static void chomp(char *p) {
-    size_t length = strlen(p);
+    :stream(_stream), dirty(false) {}
 
-    while (length > 0 && p[length - 1] > 0 && p[length - 1] <= 0x20)
-        --length;
+OpenAirAirspaceReader::OpenAirAirspaceReader(char *begin, char *end,
+                                             unsigned first_line)
+    :stream(begin, end, first_line), dirty(false) {}
 
-    p[length] = 0;
-}
+static Airspace::type_t
+parse_type(const char *p, size_t length)
+{
+    switch (length) {
+    case 1:
+        switch (p[0]) {
+        case 'A':
+            return Airspace::TYPE_ALPHA;
+        case 'B':
+            return Airspace::TYPE_BRAVO;
+        case 'C':
+            return Airspace::TYPE_CHARLY;
+        case 'D':
+            return Airspace::TYPE_DELTA;
+        case 'E':
+            return Airspace::TYPE_ECHO_LOW;
+        case 'W':
+            return Airspace::TYPE_ECHO_HIGH;
+        case 'F':
+            return Airspace::TYPE_FOX;
+        case 'R':
+            return Airspace::TYPE_RESTRICTED;
+        case 'Q':
+            return Airspace::TYPE_DANGER;
+        }
+        break;
+
+    case 2:
+        if (p[0] == 'G' && p[1] == 'P')
+            return Airspace::TYPE_RESTRICTED;
+        break;
+
+    case 3:
+        if (memcmp(p, "CTR", 3) == 0)
+            return Airspace::TYPE_CTR;
+        if (memcmp(p, "TMZ", 3) == 0)
+            return Airspace::TYPE_TMZ;
+        if (memcmp(p, "TRA", 3) == 0)
+            return Airspace::TYPE_RESTRICTED;
+        break;
+
+    case 4:
+        if (memcmp(p, "GSEC", 4) == 0)
+            return Airspace::TYPE_GLIDER;
+        break;
+    }
 
-static Airspace::type_t parse_type(const char *p) {
-    if (strcmp(p, "A") == 0)
-        return Airspace::TYPE_ALPHA;
-    if (strcmp(p, "B") == 0)
-        return Airspace::TYPE_BRAVO;
-    if (strcmp(p, "C") == 0)
-        return Airspace::TYPE_CHARLY;
-    if (strcmp(p, "D") == 0)
-        return Airspace::TYPE_DELTA;
-    if (strcmp(p, "E") == 0)
-        return Airspace::TYPE_ECHO_LOW;
-    if (strcmp(p, "W") == 0)
-        return Airspace::TYPE_ECHO_HIGH;
-    if (strcmp(p, "F") == 0)
-        return Airspace::TYPE_FOX;
-    if (strcmp(p, "CTR") == 0)
-        return Airspace::TYPE_CTR;
-    if (strcmp(p, "TMZ") == 0)
-        return Airspace::TYPE_TMZ;
-    if (strcmp(p, "R") == 0 ||
-        strcmp(p, "TRA") == 0 ||
-        strcmp(p, "GP") == 0)
-        return Airspace::TYPE_RESTRICTED;
-    if (strcmp(p, "Q") == 0)
-        return Airspace::TYPE_DANGER;
-    if (strcmp(p, "GSEC") == 0)
-        return Airspace::TYPE_GLIDER;
     return Airspace::TYPE_UNKNOWN;
 }
 
@@ -154,31 +329,113 @@ static const Altitude parse_altitude(const char *p) {
     return Altitude(value, Altitude::UNIT_FEET, ref);
 }
 
-static const SurfacePosition
-parse_surface_position(const char *p)
+static void
+skip_spaces(const char *&p)
 {
-    int lat1, lat2, lat3, lon1, lon2, lon3;
-    char latSN[4], lonWE[4]; /* on AMD64, this must be 32 bits wide? wtf? */
-    int ret;
+    while (*p == ' ' || *p == '\t')
+        ++p;
+}
 
-    ret = sscanf(p, "%2d:%2d:%2d %[SNsn] %3d:%2d:%2d %[WEwe]",
-                 &lat1, &lat2, &lat3, latSN,
-                 &lon1, &lon2, &lon3, lonWE);
-    if (ret != 8)
-        throw malformed_input();
+static bool
+is_digit(char ch)
+{
+    return ch >= '0' && ch <= '9';
+}
 
-    int latitude = ((lat1 * 60) + lat2) * 1000 + (lat3 * 1000 + 499) / 60;
-    int longitude = ((lon1 * 60) + lon2) * 1000 + (lon3 * 1000 + 499) / 60;
+/**
+ * Parses an unsigned integer with at most max_digits digits.
+ */
+static unsigned
+parse_digits(const char *&p, unsigned max_digits)
+{
+    if (!is_digit(*p))
+        throw malformed_input("malformed coordinate");
 
-    if (*latSN == 'S' || *latSN == 's')
+    unsigned value = 0;
+    for (unsigned i = 0; i < max_digits && is_digit(*p); ++i)
+        value = value * 10 + (*p++ - '0');
+
+    return value;
+}
+
+/**
+ * Parses the digits after a decimal point, and returns them in
+ * thousandths, rounded with the fourth digit.
+ */
+static unsigned
+parse_fraction_milli(const char *&p)
+{
+    unsigned value = 0, n = 0;
+    bool round_up = false;
+
+    for (; is_digit(*p); ++p, ++n) {
+        if (n < 3)
+            value = value * 10 + (*p - '0');
+        else if (n == 3)
+            round_up = *p >= '5';
+    }
+
+    for (; n < 3; ++n)
+        value *= 10;
+
+    return round_up ? value + 1 : value;
+}
+
+/**
+ * Parses "D:M:S", "D:M:S.s" or "D:M.m", and returns the angle in
+ * 1/1000 arc minutes.
+ */
+static int
+parse_angle(const char *&p, unsigned max_degree_digits)
+{
+    skip_spaces(p);
+
+    const unsigned degrees = parse_digits(p, max_degree_digits);
+    if (*p++ != ':')
+        throw malformed_input("malformed coordinate");
+
+    const unsigned minutes = parse_digits(p, 2);
+    int value = (degrees * 60 + minutes) * 1000;
+
+    if (*p == '.') {
+        /* decimal minutes */
+        ++p;
+        value += parse_fraction_milli(p);
+    } else if (*p == ':') {
+        ++p;
+        unsigned seconds_milli = parse_digits(p, 2) * 1000;
+        if (*p == '.') {
+            ++p;
+            seconds_milli += parse_fraction_milli(p);
+        }
+
+        value += (seconds_milli + 499) / 60;
+    } else
+        throw malformed_input("malformed coordinate");
+
+    return value;
+}
+
+static const SurfacePosition
+parse_surface_position(const char *&p)
+{
+    int latitude = parse_angle(p, 2);
+
+    skip_spaces(p);
+    if (*p == 'S' || *p == 's')
         latitude = -latitude;
-    else if (*latSN != 'N' && *latSN != 'n')
-        throw malformed_input();
+    else if (*p != 'N' && *p != 'n')
+        throw malformed_input("expected 'N' or 'S'");
+    ++p;
+
+    int longitude = parse_angle(p, 3);
 
-    if (*lonWE == 'W' || *lonWE == 'w')
+    skip_spaces(p);
+    if (*p == 'W' || *p == 'w')
         longitude = -longitude;
-    else if (*lonWE != 'E' && *lonWE != 'e')
+    else if (*p != 'E' && *p != 'e')
         throw malformed_input("expected 'W' or 'E'");
+    ++p;
 
     return SurfacePosition(Latitude(latitude), Longitude(longitude));
 }
@@ -216,29 +473,85 @@ last_edge_equals(const Airspace::EdgeList &edges, const SurfacePosition &sp)
     return last.getType() == Edge::TYPE_VERTEX && last.getEnd() == sp;
 }
 
-void
-OpenAirAirspaceReader::skip()
+/**
+ * Parses a decimal number, followed by optional spaces and an
+ * optional comma.
+ */
+static double
+parse_number(const char *&p)
 {
-    char buffer[512], *line;
+    char *endptr;
+    double value = strtod(p, &endptr);
+    if (endptr == p)
+        throw malformed_input("number expected");
+
+    p = endptr;
+    skip_spaces(p);
+    if (*p == ',') {
+        ++p;
+        skip_spaces(p);
+    }
 
-    while (!stream.eof()) {
-        try {
-            stream.getline(buffer, sizeof(buffer));
-        } catch (const std::ios_base::failure &e) {
-            if (stream.eof())
-                break;
-            else
-                throw;
-        }
+    return value;
+}
 
-        line = buffer;
-        while (*line == ' ')
-            ++line;
+/**
+ * Calculates the point at the specified bearing (degrees clockwise
+ * from north) and distance (nautical miles, i.e. arc minutes of
+ * latitude) from the center, in the same plane approximation as the
+ * Cenfis arc code.
+ */
+static const SurfacePosition
+arc_point(const SurfacePosition &center, double bearing, double radius)
+{
+    const double angle = bearing * M_PI / 180.;
+    const double d_latitude = cos(angle) * radius * 1000.;
+    const double d_longitude = sin(angle) * radius * 1000. /
+        cos((double)center.getLatitude());
+
+    return SurfacePosition(Latitude(center.getLatitude().getValue() +
+                                    (int)lround(d_latitude)),
+                           Longitude(center.getLongitude().getValue() +
+                                     (int)lround(d_longitude)));
+}
 
+/**
+ * Appends an arc from start to end around the center.
+ */
+static void
+append_arc(Airspace::EdgeList &edges, int direction,
+           const SurfacePosition &start, const SurfacePosition &end,
+           const SurfacePosition &center)
+{
+    if (!last_edge_equals(edges, start))
+        /* add a new vertex when the last vertex isn't equal to the
+           arc start */
+        edges.push_back(Edge(start));
+
+    edges.push_back(Edge(direction, end, center));
+}
+
+/** sets the location of all edges after the first n */
+static void
+set_location(Airspace::EdgeList &edges, Airspace::EdgeList::size_type n,
+             const input_location &location)
+{
+    Airspace::EdgeList::iterator it = edges.begin();
+    std::advance(it, n);
+    for (; it != edges.end(); ++it)
+        it->setLocation(location);
+}
+
+void
+OpenAirAirspaceReader::skip()
+{
+    char *line;
+    size_t length;
+
+    while ((line = stream.getline(length)) != NULL) {
         if (line[0] == '*') /* comment */
             continue;
 
-        chomp(line);
         if (line[0] == 0 ||
             (line[0] == 'A' && line[1] == 'C'))
             break;
@@ -248,39 +561,38 @@ OpenAirAirspaceReader::skip()
 const Airspace *
 OpenAirAirspaceReader::read_internal()
 {
-    char buffer[512], *line;
+    char *line;
+    size_t length;
     Airspace::type_t type = Airspace::TYPE_UNKNOWN;
     std::string name;
     Altitude bottom, top;
     Airspace::EdgeList edges;
     SurfacePosition x;
     int direction = 1;
+    input_location location;
 
-    while (!stream.eof()) {
-        try {
-            stream.getline(buffer, sizeof(buffer));
-        } catch (const std::ios_base::failure &e) {
-            if (stream.eof())
-                break;
-            else
-                throw;
-        }
-
-        line = buffer;
-        while (*line == ' ')
-            ++line;
-
+    while ((line = stream.getline(length)) != NULL) {
         if (line[0] == '*') /* comment */
             continue;
 
-        chomp(line);
-        if (line[0] == 0) {
+        if (length == 0) {
             if (edges.empty())
                 continue;
-            else
-                break;
+
+            dirty = false;
+            break;
         }
 
+        dirty = true;
+
+        if (!location.defined())
+            location = stream.get_location();
+
+        /* all commands have at least three characters, e.g. "DP "
+           or "V X", so line[1] and line[2] may be accessed */
+        if (length < 3)
+            throw malformed_input("invalid command");
+
         if (line[0] == 'A') {
             if (line[2] != ' ')
                 throw malformed_input();
@@ -289,17 +601,18 @@ OpenAirAirspaceReader::read_internal()
                 !edges.empty()) {
                 /* empty line to finish the airspace is missing -
                    unread the current line and finish the airspace */
-                stream.putline(line);
+                stream.unread();
+                dirty = false;
                 break;
             }
 
             switch (line[1]) {
             case 'C':
-                type = parse_type(line + 3);
+                type = parse_type(line + 3, length - 3);
                 break;
 
             case 'N':
-                name = line + 3;
+                name.assign(line + 3, length - 3);
                 break;
 
             case 'L':
@@ -318,68 +631,118 @@ OpenAirAirspaceReader::read_internal()
             default:
                 throw malformed_input("invalid command");
             }
-        } else if (line[0] == 'D' && line[1] == 'P' && line[2] == ' ') {
-            SurfacePosition position = parse_surface_position(line + 3);
-            edges.push_back(Edge(position));
-        } else if (line[0] == 'V' && line[1] == ' ') {
-            if (line[2] == 'X' && line[3] == '=')
-                x = parse_surface_position(line + 4);
-            else if (line[2] == 'D' && line[3] == '=')
+
+            continue;
+        }
+
+        const char *p = line + 3;
+        const Airspace::EdgeList::size_type num_edges = edges.size();
+
+        switch (line[0]) {
+        case 'D':
+            if (line[2] != ' ')
+                break;
+
+            switch (line[1]) {
+            case 'P':
+                edges.push_back(Edge(parse_surface_position(p)));
+                edges.back().setLocation(stream.get_location());
+                continue;
+
+            case 'C':
+                if (!x.defined())
+                    throw malformed_input("DC without X");
+
+                edges.push_back(Edge(x, parse_distance(p)));
+                edges.back().setLocation(stream.get_location());
+                continue;
+
+            case 'A':
+                /* arc with radius and two angles */
+                if (!x.defined())
+                    throw malformed_input("DA without X");
+
+                {
+                    const double radius = parse_number(p);
+                    const double start_angle = parse_number(p);
+                    const double end_angle = parse_number(p);
+                    if (*p != 0)
+                        throw malformed_input("malformed DA");
+
+                    append_arc(edges, direction,
+                               arc_point(x, start_angle, radius),
+                               arc_point(x, end_angle, radius), x);
+                    set_location(edges, num_edges, stream.get_location());
+                }
+
+                /* reset direction */
+                direction = 1;
+                continue;
+
+            case 'B':
+                /* arc with three points */
+                if (!x.defined())
+                    throw malformed_input("DB without X");
+
+                {
+                    const SurfacePosition start = parse_surface_position(p);
+
+                    skip_spaces(p);
+                    if (*p++ != ',')
+                        throw malformed_input("comma expected");
+
+                    const SurfacePosition end = parse_surface_position(p);
+
+                    append_arc(edges, direction, start, end, x);
+                    set_location(edges, num_edges, stream.get_location());
+                }
+
+                /* reset direction */
+                direction = 1;
+                continue;
+            }
+            break;
+
+        case 'V':
+            if (line[1] != ' ')
+                break;
+
+            if (line[2] == 'X' && line[3] == '=') {
+                p = line + 4;
+                x = parse_surface_position(p);
+            } else if (line[2] == 'D' && line[3] == '=')
                 direction = parse_direction(line + 4);
             else
                 throw malformed_input("unknown variable");
-        } else if (line[0] == 'D' && line[1] == 'C' && line[2] == ' ') {
-            if (!x.defined())
-                throw malformed_input("DC without X");
-
-            edges.push_back(Edge(x, parse_distance(line + 3)));
-        } else if (line[0] == 'D' && line[1] == 'A' && line[2] == ' ') {
-            // arc with center, radius and two angles
-
-            if (!x.defined())
-                throw malformed_input("DA without X");
-
-            /* XXX implement this */
-        } else if (line[0] == 'D' && line[1] == 'B' && line[2] == ' ') {
-            // arc with three points
-            SurfacePosition start, end;
-
-            if (!x.defined())
-                throw malformed_input("DB without X");
-
-            start = parse_surface_position(line + 3);
-            const char *comma = strchr(line + 3, ',');
-            if (comma == NULL)
-                throw malformed_input("comma expected");
-            end = parse_surface_position(comma + 1);
-
-            if (!last_edge_equals(edges, start))
-                /* add a new vertex when the last vertex isn't equal
-                   to the arc start */
-                edges.push_back(Edge(start));
-
-            edges.push_back(Edge(direction, end, x));
-
-            /* reset direction */
-            direction = 1;
-        } else if (line[0] == 'S' && line[1] == 'B' && line[2] == ' ') {
-            /* background color? */
-            skip();
-        } else if (line[0] == 'S' && line[1] == 'P' && line[2] == ' ') {
-            /* ??? */
-            skip();
-        } else if (line[0] == 'T' && line[1] == 'C' && line[2] == ' ') {
-            /* ??? */
-            skip();
-        } else {
-            throw malformed_input("invalid command");
+            continue;
+
+        case 'S':
+            if ((line[1] == 'B' || line[1] == 'P') && line[2] == ' ') {
+                /* colors */
+                skip();
+                continue;
+            }
+            break;
+
+        case 'T':
+            if (line[1] == 'C' && line[2] == ' ') {
+                /* ??? */
+                skip();
+                continue;
+            }
+            break;
         }
+
+        throw malformed_input("invalid command");
     }
 
-    if (edges.size() > 0)
-        return new Airspace(name, type,
-                            bottom, top,
-                            edges);
+    if (edges.size() > 0) {
+        Airspace *airspace = new Airspace(name, type,
+                                          bottom, top,
+                                          edges);
+        airspace->setLocation(location);
+        return airspace;
+    }
 
     return NULL;
 }
@@ -394,6 +757,352 @@ OpenAirAirspaceReader::read()
     }
 }
 
+/** a range of the input which is parsed by one thread */
+struct OpenAirBlock {
+    char *begin, *end;
+    unsigned first_line;
+
+    std::vector<const Airspace*> airspaces;
+
+    /** the last position where the reader was clean, the number of
+        airspaces before it, and its line number */
+    char *clean_position;
+    size_t clean_count;
+    unsigned clean_line;
+
+    /** is the reader clean at the end of the block? */
+    bool clean;
+
+    /** has parse() been called? */
+    bool parsed;
+
+    std::exception_ptr error;
+
+    OpenAirBlock(char *_begin, char *_end, unsigned _first_line)
+        :begin(_begin), end(_end), first_line(_first_line),
+         clean_position(_begin), clean_count(0), clean_line(_first_line),
+         clean(true), parsed(false) {}
+
+    /** delete the airspaces starting at the specified index */
+    void truncate(size_t n) {
+        for (size_t i = n; i < airspaces.size(); ++i)
+            delete airspaces[i];
+        airspaces.resize(n);
+    }
+
+    void parse() throw() {
+        parsed = true;
+
+        try {
+            OpenAirAirspaceReader reader(begin, end, first_line);
+            const Airspace *airspace;
+
+            while ((airspace = reader.read()) != NULL) {
+                airspaces.push_back(airspace);
+
+                if (reader.is_clean()) {
+                    clean_position = reader.tell(clean_line);
+                    clean_count = airspaces.size();
+                }
+            }
+
+            clean = reader.is_clean();
+        } catch (...) {
+            error = std::current_exception();
+            clean = false;
+        }
+    }
+};
+
+/**
+ * Reads the whole file into memory, splits it into blocks which
+ * begin with an "AC" line after an empty line, and parses the blocks
+ * in parallel.  Each block is parsed with a fresh reader, which is
+ * only correct if the reader of the previous block ended in a clean
+ * state.  If it did not, the input is parsed sequentially from the
+ * last clean position until the reader is clean at the beginning of
+ * a block again, so the result is always the same as with
+ * OpenAirAirspaceReader.
+ *
+ * The blocks are parsed in waves of a few blocks per thread, and the
+ * next wave is only parsed when the caller has consumed the previous
+ * one.  This way, only a bounded part of a huge file is held as
+ * Airspace objects.
+ */
+class ParallelOpenAirAirspaceReader : public AirspaceReader {
+private:
+    std::istream *stream;
+    unsigned jobs;
+
+    std::vector<char> data;
+    std::list<OpenAirBlock> blocks;
+    bool loaded;
+
+    /** parses the blocks, or NULL if there is only one */
+    ThreadPool *pool;
+
+    /** the first block which is not known to be parsed correctly;
+        all blocks before it are final */
+    std::list<OpenAirBlock>::iterator checked;
+
+    /** the next airspace of the first block to be returned */
+    size_t position;
+
+public:
+    ParallelOpenAirAirspaceReader(std::istream *_stream, unsigned _jobs)
+        :stream(_stream), jobs(_jobs), loaded(false), pool(NULL),
+         position(0) {}
+
+    virtual ~ParallelOpenAirAirspaceReader() {
+        if (pool != NULL)
+            delete pool;
+
+        for (std::list<OpenAirBlock>::iterator it = blocks.begin();
+             it != blocks.end(); ++it) {
+            if (it == blocks.begin())
+                /* the first "position" airspaces have been returned
+                   already */
+                it->airspaces.erase(it->airspaces.begin(),
+                                    it->airspaces.begin() + position);
+            it->truncate(0);
+        }
+    }
+
+private:
+    void load_file();
+    void split();
+    std::list<OpenAirBlock>::iterator
+    resync(std::list<OpenAirBlock>::iterator block);
+    void load();
+    void parse_wave();
+
+public:
+    virtual const Airspace *read();
+};
+
+void
+ParallelOpenAirAirspaceReader::load_file()
+{
+    std::streambuf *buf = stream->rdbuf();
+    size_t size = 0;
+
+    /* if the file size is known, allocate the buffer at once instead
+       of growing it */
+    const std::streampos start = buf->pubseekoff(0, std::ios::cur,
+                                                 std::ios::in);
+    const std::streampos end = buf->pubseekoff(0, std::ios::end,
+                                               std::ios::in);
+    if (start != std::streampos(-1) && end != std::streampos(-1) &&
+        buf->pubseekpos(start, std::ios::in) == start && end > start)
+        data.reserve((size_t)(end - start) + 0x100000);
+
+    while (true) {
+        data.resize(size + 0x100000);
+        std::streamsize nbytes = buf->sgetn(&data[size], data.size() - size);
+        if (nbytes <= 0)
+            break;
+        size += (size_t)nbytes;
+    }
+
+    /* one spare byte for the null terminator of the last line */
+    data.resize(size + 1);
+}
+
+static bool
+is_blank_line(const char *p, const char *end)
+{
+    for (; p < end; ++p)
+        if ((unsigned char)*p > 0x20 || *p == 0)
+            return false;
+    return true;
+}
+
+void
+ParallelOpenAirAirspaceReader::split()
+{
+    char *const begin = &data[0], *const end = begin + data.size() - 1;
+    const size_t min_block_size = 0x10000, max_block_size = 0x40000;
+    size_t block_size = (end - begin) / (jobs * 4);
+    if (block_size < min_block_size)
+        block_size = min_block_size;
+    else if (block_size > max_block_size)
+        block_size = max_block_size;
+
+    char *block_begin = begin, *p = begin;
+    unsigned line = 1, block_line = 1;
+    bool previous_blank = false;
+
+    while (p < end) {
+        char *newline = (char*)memchr(p, '\n', end - p);
+        char *line_end = newline != NULL ? newline : end;
+
+        if (previous_blank && (size_t)(p - block_begin) >= block_size) {
+            const char *q = p;
+            while (q < line_end && *q == ' ')
+                ++q;
+
+            if (line_end - q >= 3 && q[0] == 'A' && q[1] == 'C' &&
+                q[2] == ' ') {
+                blocks.push_back(OpenAirBlock(block_begin, p, block_line));
+                block_begin = p;
+                block_line = line;
+            }
+        }
+
+        previous_blank = is_blank_line(p, line_end);
+
+        if (newline == NULL)
+            break;
+
+        p = newline + 1;
+        ++line;
+    }
+
+    blocks.push_back(OpenAirBlock(block_begin, end, block_line));
+}
+
+/**
+ * The specified block did not end clean.  Parse sequentially from
+ * its last clean position, until the reader is clean at the
+ * beginning of another block.  The blocks in between are replaced.
+ *
+ * @return the next block which is known to be parsed correctly
+ */
+std::list<OpenAirBlock>::iterator
+ParallelOpenAirAirspaceReader::resync(std::list<OpenAirBlock>::iterator block)
+{
+    char *const file_end = &data[0] + data.size() - 1;
+    std::list<OpenAirBlock>::iterator next = std::next(block);
+
+    block->truncate(block->clean_count);
+    block->error = std::exception_ptr();
+
+    try {
+        OpenAirAirspaceReader reader(block->clean_position, file_end,
+                                     block->clean_line);
+        const Airspace *airspace;
+
+        while ((airspace = reader.read()) != NULL) {
+            block->airspaces.push_back(airspace);
+
+            if (!reader.is_clean())
+                continue;
+
+            unsigned line;
+            char *p = reader.tell(line);
+
+            /* drop the blocks which have been parsed sequentially
+               now */
+            while (next != blocks.end() && next->begin < p) {
+                next->truncate(0);
+                next = blocks.erase(next);
+            }
+
+            if (next != blocks.end() && next->begin == p) {
+                block->end = p;
+                block->clean = true;
+                return next;
+            }
+        }
+    } catch (...) {
+        block->error = std::current_exception();
+    }
+
+    /* parsed until the end of the file, or until an error */
+    while (next != blocks.end()) {
+        next->truncate(0);
+        next = blocks.erase(next);
+    }
+
+    block->end = file_end;
+    return next;
+}
+
+void
+ParallelOpenAirAirspaceReader::load()
+{
+    load_file();
+    split();
+
+    if (blocks.size() > 1)
+        pool = new ThreadPool(jobs);
+
+    checked = blocks.begin();
+}
+
+/**
+ * Parses the next wave of blocks, starting at the first block which
+ * is not final.  The first block of a wave is always correct,
+ * because its predecessor was checked.
+ */
+void
+ParallelOpenAirAirspaceReader::parse_wave()
+{
+    std::list<OpenAirBlock>::iterator it = checked;
+    for (unsigned n = 0; n < jobs * 2 && it != blocks.end(); ++n, ++it) {
+        if (it->parsed)
+            continue;
+
+        if (pool != NULL)
+            pool->push(std::bind(&OpenAirBlock::parse, std::ref(*it)));
+        else
+            it->parse();
+    }
+
+    if (pool != NULL)
+        pool->wait();
+
+    /* walk the blocks of this wave in order, and repair them if
+       their predecessor did not end clean; resync() may parse into
+       the next wave */
+    it = checked;
+    while (it != blocks.end() && it->parsed) {
+        if (it->error) {
+            /* parsing stops here */
+            for (std::list<OpenAirBlock>::iterator i = std::next(it);
+                 i != blocks.end(); ++i)
+                i->truncate(0);
+            blocks.erase(std::next(it), blocks.end());
+            it = blocks.end();
+        } else if (it->clean || std::next(it) == blocks.end())
+            ++it;
+        else
+            it = resync(it);
+    }
+
+    checked = it;
+}
+
+const Airspace *
+ParallelOpenAirAirspaceReader::read()
+{
+    if (!loaded) {
+        load();
+        loaded = true;
+    }
+
+    while (!blocks.empty()) {
+        if (checked == blocks.begin())
+            parse_wave();
+
+        OpenAirBlock &block = blocks.front();
+        if (position < block.airspaces.size())
+            return block.airspaces[position++];
+
+        if (block.error)
+            std::rethrow_exception(block.error);
+
+        blocks.pop_front();
+        position = 0;
+    }
+
+    return NULL;
+}
+
 AirspaceReader *OpenAirAirspaceFormat::createReader(std::istream *stream) const {
+    if (airspace_reader_options.jobs > 1)
+        return new ParallelOpenAirAirspaceReader(stream,
+                                                 airspace_reader_options.jobs);
+
     return new OpenAirAirspaceReader(stream);
 }
@@ -0,0 +1,523 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "exception.hh"
+#include "airspace.hh"
+#include "airspace-io.hh"
+#include "airspace-geometry.hh"
+#include "earth-parser.hh"
+
+#include <iostream>
+#include <vector>
+
+#include <math.h>
+
+/**
+ * Reduces the number of vertices with the Douglas-Peucker algorithm.
+ * Unlike the textbook algorithm, the simplified polygon always
+ * contains the original one: chords which cut off a part of the
+ * airspace are moved outwards.
+ */
+class SimplifyAirspaceReader : public AirspaceReader {
+private:
+    AirspaceReader *reader;
+
+    /** the tolerance in plane units */
+    double tolerance;
+
+    unsigned long vertices_in, vertices_out;
+
+public:
+    SimplifyAirspaceReader(AirspaceReader *_reader, double _tolerance)
+        :reader(_reader), tolerance(_tolerance),
+         vertices_in(0), vertices_out(0) {}
+    virtual ~SimplifyAirspaceReader();
+
+public:
+    virtual const Airspace *read();
+};
+
+AirspaceReader *
+SimplifyAirspaceFilter::createFilter(AirspaceReader *reader,
+                                     const char *args) const
+{
+    if (args == NULL || *args == 0)
+        throw malformed_input("No tolerance provided");
+
+    const Distance tolerance = parseDistance(args);
+    if (tolerance.getMeters() <= 0)
+        throw malformed_input("Tolerance must be positive");
+
+    return new SimplifyAirspaceReader(reader,
+                                      tolerance.getMeters() /
+                                      PLANE_UNIT_METERS);
+}
+
+SimplifyAirspaceReader::~SimplifyAirspaceReader()
+{
+    if (vertices_in > 0)
+        std::cerr << "simplify: " << vertices_in << " -> "
+                  << vertices_out << " vertices ("
+                  << (vertices_in - vertices_out) * 100 / vertices_in
+                  << "% removed)" << std::endl;
+
+    delete reader;
+}
+
+/** an additional outward shift which absorbs coordinate rounding */
+static const double ROUNDING_MARGIN = 1.0;
+
+/** points closer than this to a chord are regarded as on it */
+static const double EPSILON = 1e-6;
+
+class Simplifier {
+private:
+    const PlanePointList &points;
+    const std::vector<bool> &pinned;
+
+    /** +1 if the polygon is counter-clockwise, -1 otherwise */
+    int orientation;
+
+    double tolerance;
+
+    std::vector<bool> keep;
+
+public:
+    Simplifier(const PlanePointList &_points,
+               const std::vector<bool> &_pinned)
+        :points(_points), pinned(_pinned),
+         orientation(plane_signed_area2(_points) >= 0 ? 1 : -1),
+         tolerance(0) {}
+
+private:
+    const PlanePoint &at(size_t i) const {
+        return points[i % points.size()];
+    }
+
+    bool is_pinned(size_t i) const {
+        return pinned[i % points.size()];
+    }
+
+    /** distance of the point on the outer side of the chord a-b */
+    double outward(const PlanePoint &p,
+                   const PlanePoint &a, const PlanePoint &b) const {
+        const double length = hypot(b.x - a.x, b.y - a.y);
+        if (length <= 0)
+            return 0;
+        return -orientation * plane_cross(a, b, p) / length;
+    }
+
+    double max_outward(size_t first, size_t last) const;
+
+    void douglas_peucker(size_t first, size_t last);
+
+    void offset_line(size_t first, size_t last, double offset,
+                     PlanePoint &a, PlanePoint &b) const;
+
+public:
+    bool run(double tolerance, PlanePointList &result,
+             std::vector<size_t> &origin);
+};
+
+double
+Simplifier::max_outward(size_t first, size_t last) const
+{
+    double result = 0;
+
+    for (size_t i = first + 1; i < last; ++i) {
+        double d = outward(at(i), at(first), at(last));
+        if (d > result)
+            result = d;
+    }
+
+    return result;
+}
+
+void
+Simplifier::douglas_peucker(size_t first, size_t last)
+{
+    std::vector<std::pair<size_t, size_t> > stack;
+    stack.push_back(std::make_pair(first, last));
+
+    while (!stack.empty()) {
+        first = stack.back().first;
+        last = stack.back().second;
+        stack.pop_back();
+
+        if (last <= first + 1)
+            continue;
+
+        const bool pinned_chord = is_pinned(first) || is_pinned(last);
+        size_t farthest = first, outermost = first;
+        double max_distance = 0, max_out = 0;
+
+        for (size_t i = first + 1; i < last; ++i) {
+            double d = plane_segment_distance(at(i), at(first), at(last));
+            if (d > max_distance) {
+                max_distance = d;
+                farthest = i;
+            }
+
+            d = outward(at(i), at(first), at(last));
+            if (d > max_out) {
+                max_out = d;
+                outermost = i;
+            }
+        }
+
+        size_t split;
+        if (max_distance > tolerance)
+            split = farthest;
+        else if (pinned_chord && max_out > EPSILON)
+            /* a chord ending at a pinned point cannot be moved
+               outwards, so it must not cut anything off */
+            split = outermost;
+        else
+            continue;
+
+        keep[split % points.size()] = true;
+        stack.push_back(std::make_pair(first, split));
+        stack.push_back(std::make_pair(split, last));
+    }
+}
+
+/**
+ * Intersects two lines given by two points each.  Returns false if
+ * they are (almost) parallel.
+ */
+static bool
+line_intersection(const PlanePoint &a1, const PlanePoint &a2,
+                  const PlanePoint &b1, const PlanePoint &b2,
+                  PlanePoint &result)
+{
+    const double dax = a2.x - a1.x, day = a2.y - a1.y;
+    const double dbx = b2.x - b1.x, dby = b2.y - b1.y;
+    const double denominator = dax * dby - day * dbx;
+    const double la = hypot(dax, day), lb = hypot(dbx, dby);
+
+    if (fabs(denominator) <= 1e-3 * la * lb)
+        return false;
+
+    const double t = ((b1.x - a1.x) * dby - (b1.y - a1.y) * dbx) / denominator;
+    result = PlanePoint(a1.x + t * dax, a1.y + t * day);
+    return true;
+}
+
+void
+Simplifier::offset_line(size_t first, size_t last, double offset,
+                        PlanePoint &a, PlanePoint &b) const
+{
+    a = at(first);
+    b = at(last);
+
+    const double length = hypot(b.x - a.x, b.y - a.y);
+    if (length > 0 && offset > 0) {
+        /* the outer normal is on the right side of a counter-clockwise
+           polygon */
+        const double nx = orientation * (b.y - a.y) / length;
+        const double ny = -orientation * (b.x - a.x) / length;
+
+        a = PlanePoint(a.x + nx * offset, a.y + ny * offset);
+        b = PlanePoint(b.x + nx * offset, b.y + ny * offset);
+    }
+}
+
+bool
+Simplifier::run(double _tolerance, PlanePointList &result,
+                std::vector<size_t> &origin)
+{
+    const size_t n = points.size();
+
+    tolerance = _tolerance;
+    keep.assign(n, false);
+
+    /* anchors: all pinned points; if there are none, the first point
+       and the one farthest away from it */
+    std::vector<size_t> anchors;
+    for (size_t i = 0; i < n; ++i)
+        if (pinned[i])
+            anchors.push_back(i);
+
+    if (anchors.empty()) {
+        size_t farthest = 0;
+        double max_distance = 0;
+        for (size_t i = 1; i < n; ++i) {
+            const double d = hypot(points[i].x - points[0].x,
+                                   points[i].y - points[0].y);
+            if (d > max_distance) {
+                max_distance = d;
+                farthest = i;
+            }
+        }
+
+        anchors.push_back(0);
+        if (farthest > 0)
+            anchors.push_back(farthest);
+    }
+
+    for (size_t i = 0; i < anchors.size(); ++i) {
+        const size_t first = anchors[i];
+        const size_t last = i + 1 < anchors.size()
+            ? anchors[i + 1] : anchors[0] + n;
+
+        keep[first] = true;
+        douglas_peucker(first, last);
+    }
+
+    std::vector<size_t> kept;
+    for (size_t i = 0; i < n; ++i)
+        if (keep[i])
+            kept.push_back(i);
+
+    const size_t m = kept.size();
+    if (m < 3)
+        return false;
+
+    /* how far must each chord be moved outwards? */
+
+    std::vector<double> offsets(m);
+    for (size_t i = 0; i < m; ++i) {
+        const size_t first = kept[i];
+        const size_t last = i + 1 < m ? kept[i + 1] : kept[0] + n;
+
+        if (is_pinned(first) || is_pinned(last)) {
+            offsets[i] = 0;
+            continue;
+        }
+
+        const double d = max_outward(first, last);
+        offsets[i] = d > EPSILON ? d + ROUNDING_MARGIN : 0;
+    }
+
+    /* build the new polygon from the intersections of the moved
+       chords */
+
+    result.clear();
+    origin.clear();
+
+    for (size_t i = 0; i < m; ++i) {
+        const size_t prev = i > 0 ? i - 1 : m - 1;
+        const size_t vertex = kept[i];
+
+        if (offsets[prev] <= 0 && offsets[i] <= 0) {
+            result.push_back(points[vertex]);
+            origin.push_back(vertex);
+            continue;
+        }
+
+        PlanePoint a1, a2, b1, b2, p;
+        offset_line(kept[prev], kept[prev] < vertex ? vertex : vertex + n,
+                    offsets[prev], a1, a2);
+        offset_line(vertex, i + 1 < m ? kept[i + 1] : kept[0] + n,
+                    offsets[i], b1, b2);
+
+        const double max_offset = offsets[prev] > offsets[i]
+            ? offsets[prev] : offsets[i];
+
+        if (line_intersection(a1, a2, b1, b2, p) &&
+            hypot(p.x - points[vertex].x,
+                  p.y - points[vertex].y) <= 4 * max_offset) {
+            result.push_back(p);
+            origin.push_back(vertex);
+        } else {
+            /* the miter would be too long: bevel instead */
+            result.push_back(a2);
+            origin.push_back(vertex);
+            result.push_back(b1);
+            origin.push_back(vertex);
+        }
+    }
+
+    return true;
+}
+
+/** does the segment a-b cross an edge of the closed polygon? */
+static bool
+edge_crosses(const PlanePointList &polygon,
+             const PlanePoint &a, const PlanePoint &b)
+{
+    const size_t n = polygon.size();
+
+    for (size_t i = 0; i < n; ++i) {
+        const PlanePoint &c = polygon[i], &d = polygon[(i + 1) % n];
+
+        /* cheap bounding box test first */
+        if ((a.x < c.x && a.x < d.x && b.x < c.x && b.x < d.x) ||
+            (a.x > c.x && a.x > d.x && b.x > c.x && b.x > d.x) ||
+            (a.y < c.y && a.y < d.y && b.y < c.y && b.y < d.y) ||
+            (a.y > c.y && a.y > d.y && b.y > c.y && b.y > d.y))
+            continue;
+
+        /* rounding moves the vertices by up to one unit; crossings
+           shallower than that are noise */
+        if (plane_segments_cross(a, b, c, d, 1))
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Rounds the polygon to Angle resolution and checks that it is
+ * still usable: no duplicate vertices, no self intersections, and
+ * it contains all original points and edges.
+ */
+static bool
+validate(const LocalProjection &projection, const PlanePointList &original,
+         PlanePointList &result, std::vector<size_t> &origin)
+{
+    PlanePointList rounded;
+    std::vector<size_t> rounded_origin;
+
+    for (size_t i = 0; i < result.size(); ++i) {
+        const PlanePoint p =
+            projection.project(projection.unproject(result[i]));
+        if (!rounded.empty() &&
+            fabs(p.x - rounded.back().x) < EPSILON &&
+            fabs(p.y - rounded.back().y) < EPSILON)
+            continue;
+
+        rounded.push_back(p);
+        rounded_origin.push_back(origin[i]);
+    }
+
+    if (rounded.size() < 3 || plane_polygon_self_intersects(rounded))
+        return false;
+
+    for (size_t i = 0; i < original.size(); ++i)
+        if (!plane_polygon_contains(rounded, original[i]) &&
+            plane_polygon_distance(rounded, original[i]) > 0.5)
+            return false;
+
+    /* a concave result may contain all original points while an
+       original edge still cuts through its boundary */
+    for (size_t i = 0; i < original.size(); ++i)
+        if (edge_crosses(rounded, original[i],
+                         original[(i + 1) % original.size()]))
+            return false;
+
+    result.swap(rounded);
+    origin.swap(rounded_origin);
+    return true;
+}
+
+const Airspace *
+SimplifyAirspaceReader::read()
+{
+    const Airspace *as = reader->read();
+    if (as == NULL)
+        return NULL;
+
+    const Airspace::EdgeList &edges = as->getEdges();
+
+    /* collect the points of the polygon; the ends of arcs (and their
+       start points) must not be modified */
+
+    std::vector<const Edge *> point_edges;
+    std::vector<bool> pinned;
+    bool has_circle = false;
+
+    for (Airspace::EdgeList::const_iterator it = edges.begin();
+         it != edges.end(); ++it) {
+        switch (it->getType()) {
+        case Edge::TYPE_VERTEX:
+            point_edges.push_back(&*it);
+            pinned.push_back(false);
+            break;
+
+        case Edge::TYPE_ARC:
+            if (!pinned.empty())
+                pinned.back() = true;
+            point_edges.push_back(&*it);
+            pinned.push_back(true);
+            break;
+
+        case Edge::TYPE_CIRCLE:
+            has_circle = true;
+            break;
+        }
+    }
+
+    /* an explicitly closed polygon: the last vertex repeats the first
+       one */
+    const bool closed = point_edges.size() > 1 &&
+        point_edges.back()->getType() == Edge::TYPE_VERTEX &&
+        point_edges.back()->getEnd() == point_edges.front()->getEnd();
+    if (closed) {
+        point_edges.pop_back();
+        pinned.pop_back();
+    }
+
+    const size_t n = point_edges.size();
+    vertices_in += n;
+
+    if (has_circle || n < 4) {
+        vertices_out += n;
+        return as;
+    }
+
+    if (point_edges.front()->getType() != Edge::TYPE_VERTEX ||
+        pinned.back())
+        /* keep the first vertex where it is, it defines the start of
+           the polygon for the arc following it */
+        pinned.front() = true;
+
+    LocalProjection projection(point_edges.front()->getEnd().getLatitude());
+    PlanePointList points;
+    for (size_t i = 0; i < n; ++i)
+        points.push_back(projection.project(point_edges[i]->getEnd()));
+
+    Simplifier simplifier(points, pinned);
+    PlanePointList result;
+    std::vector<size_t> origin;
+    bool success = false;
+
+    for (double t = tolerance; !success && t >= tolerance / 8; t /= 2)
+        success = simplifier.run(t, result, origin) &&
+            validate(projection, points, result, origin);
+
+    if (!success || result.size() >= n) {
+        vertices_out += n;
+        return as;
+    }
+
+    Airspace::EdgeList new_edges;
+    for (size_t i = 0; i < result.size(); ++i) {
+        const Edge &edge = *point_edges[origin[i]];
+        if (edge.getType() == Edge::TYPE_ARC)
+            new_edges.push_back(edge);
+        else {
+            new_edges.push_back(Edge(projection.unproject(result[i])));
+            new_edges.back().setLocation(edge.getLocation());
+        }
+    }
+
+    if (closed)
+        new_edges.push_back(new_edges.front());
+
+    vertices_out += result.size();
+
+    Airspace *simplified =
+        new Airspace(as->getName(), as->getType(),
+                     as->getBottom(), as->getTop(), as->getTop2(),
+                     new_edges, as->getFrequency(), as->getVoice());
+    simplified->setLocation(as->getLocation());
+    delete as;
+    return simplified;
+}
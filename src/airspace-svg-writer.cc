@@ -20,151 +20,564 @@
 #include "exception.hh"
 #include "airspace.hh"
 #include "airspace-io.hh"
+#include "airspace-geometry.hh"
 
 #include <ostream>
-#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include <string>
 
 #include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <errno.h>
+
+/** airspaces smaller than this (in pixels) are not drawn */
+static const double MIN_PIXEL_SIZE = 1.0;
+
+/** the maximum deviation (in pixels) of a dropped vertex from the
+    line which replaces it */
+static const double PIXEL_TOLERANCE = 1.0;
+
+/** a point on the pixel grid */
+struct Pixel {
+    long x, y;
+
+    Pixel():x(0), y(0) {}
+    Pixel(long _x, long _y):x(_x), y(_y) {}
+
+    bool operator ==(const Pixel &other) const {
+        return x == other.x && y == other.y;
+    }
+
+    bool operator !=(const Pixel &other) const {
+        return !(*this == other);
+    }
+};
+
+/**
+ * An equirectangular projection of the visible area to pixels, with
+ * north up.
+ */
+class SVGProjection {
+private:
+    int latitude_max, longitude_min;
+    double cos_lat, scale;
+    double width, height;
+
+public:
+    SVGProjection(const GeoBounds &area, double width);
+
+public:
+    double getWidth() const {
+        return width;
+    }
+
+    double getHeight() const {
+        return height;
+    }
+
+    double getScale() const {
+        return scale;
+    }
+
+    double x(int longitude) const {
+        return (longitude - longitude_min) * cos_lat * scale;
+    }
+
+    double y(int latitude) const {
+        return (latitude_max - latitude) * scale;
+    }
+
+    /** projects the position and snaps it to the pixel grid */
+    const Pixel project(const SurfacePosition &position) const {
+        return Pixel(lround(x(position.getLongitude().getValue())),
+                     lround(y(position.getLatitude().getValue())));
+    }
+};
+
+SVGProjection::SVGProjection(const GeoBounds &area, double _width)
+    :latitude_max(area.latitude_max), longitude_min(area.longitude_min),
+     width(_width)
+{
+    cos_lat = cos((area.latitude_min + area.latitude_max) / 2.
+                  / 60000. * M_PI / 180.);
+    if (cos_lat < 0.01)
+        cos_lat = 0.01;
+
+    const double extent_x = (area.longitude_max - area.longitude_min) * cos_lat;
+    const double extent_y = area.latitude_max - area.latitude_min;
+
+    if (extent_x > 0)
+        scale = width / extent_x;
+    else if (extent_y > 0)
+        scale = width / extent_y;
+    else
+        scale = 1;
+
+    height = ceil(extent_y * scale);
+}
+
+/** a pixel rectangle */
+struct PixelBounds {
+    double x_min, y_min, x_max, y_max;
+
+    bool overlaps(double x0, double y0, double x1, double y1) const {
+        return x_min <= x1 && x0 <= x_max && y_min <= y1 && y0 <= y_max;
+    }
+};
 
 class SVGAirspaceWriter : public AirspaceWriter {
+private:
+    struct Item {
+        Airspace airspace;
+        GeoBounds bounds;
+
+        Item(const Airspace &_airspace, const GeoBounds &_bounds)
+            :airspace(_airspace), bounds(_bounds) {}
+    };
+
+    struct Shape {
+        std::string svg;
+        PixelBounds bounds;
+    };
+
 public:
     std::ostream &stream;
 
+private:
+    std::vector<Item> items;
+    unsigned long num_culled;
+
 public:
     SVGAirspaceWriter(std::ostream *stream);
 
 public:
     virtual void write(const Airspace &as);
     virtual void flush();
+
+private:
+    void render(std::vector<Shape> &shapes, const SVGProjection &projection,
+                const GeoBounds &area);
+    void writeTiles(const std::vector<Shape> &shapes,
+                    const SVGProjection &projection, unsigned tiles);
 };
 
 SVGAirspaceWriter::SVGAirspaceWriter(std::ostream *_stream)
-    :stream(*_stream) {
-    stream << "<?xml version=\"1.0\" standalone=\"no\"?>\n"
-        "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\"\n"
-        "    \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n"
-        "\n"
-        "<svg version=\"1.1\"\n"
-        "    xmlns=\"http://www.w3.org/2000/svg\">\n";
-}
+    :stream(*_stream), num_culled(0) {}
 
+/** the CSS class of an airspace, see write_header() */
 static const char *
-airspace_style(const Airspace &airspace)
+airspace_class(const Airspace &airspace)
 {
     switch (airspace.getType()) {
     case Airspace::TYPE_CHARLY:
     case Airspace::TYPE_DELTA:
-        return "fill:#00d000; fill-opacity:0.2; stroke:#008000; stroke-width:1";
+        return "cd";
 
     case Airspace::TYPE_CTR:
-        return "fill:#d00000; fill-opacity:0.3; stroke:#800000; stroke-width:1";
+        return "ctr";
 
     case Airspace::TYPE_FOX:
-        return "fill:#00d0a0; fill-opacity:0.3; stroke:#008060; stroke-width:1";
+        return "fox";
 
     default:
-        return "fill:#cccccc; fill-opacity:0.3; stroke:#000000; stroke-width:1";
+        return "other";
     }
 }
 
-static int
-transform(const Latitude &latitude)
+static void
+write_header(std::ostream &stream, double x, double y,
+             double width, double height,
+             double view_width, double view_height)
 {
-    return (latitude.getValue() - 2800000) / 500;
+    stream << "<?xml version=\"1.0\" standalone=\"no\"?>\n"
+        "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\"\n"
+        "    \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n"
+        "\n"
+        "<svg version=\"1.1\"\n"
+        "    xmlns=\"http://www.w3.org/2000/svg\"\n"
+        "    xmlns:xlink=\"http://www.w3.org/1999/xlink\"\n"
+        "    width=\"" << width << "\" height=\"" << height << "\"\n"
+        "    viewBox=\"" << x << " " << y << " "
+           << view_width << " " << view_height << "\">\n"
+        "<style type=\"text/css\">\n"
+        "  path, circle { fill-opacity:0.3; stroke-width:1 }\n"
+        "  .cd { fill:#00d000; fill-opacity:0.2; stroke:#008000 }\n"
+        "  .ctr { fill:#d00000; stroke:#800000 }\n"
+        "  .fox { fill:#00d0a0; stroke:#008060 }\n"
+        "  .other { fill:#cccccc; stroke:#000000 }\n"
+        "</style>\n";
 }
 
-static int
-transform(const Longitude &longitude)
+static std::ostream &
+operator <<(std::ostream &os, const Pixel &pixel)
 {
-    return (longitude.getValue() - 360008) / 500;
+    return os << pixel.x << "," << pixel.y;
 }
 
-static int
-transform(const Distance &distance)
-{
-    return (int)(distance.toUnit(Distance::UNIT_NAUTICAL_MILES).getValue() * 1000 / 500);
-}
+/**
+ * Builds the "d" attribute of a path on the pixel grid.  Points on
+ * the pixel of their predecessor are dropped, and runs of points
+ * which deviate less than PIXEL_TOLERANCE from a straight line are
+ * merged into one line.  All coordinates after the first one are
+ * relative, which keeps the numbers short.
+ */
+class SVGPathBuilder {
+private:
+    std::ostream &os;
 
-static std::ostream &
-operator <<(std::ostream &os, const Latitude &latitude)
-{
-    return os << transform(latitude);
-}
+    bool empty;
 
-static std::ostream &
-operator <<(std::ostream &os, const Longitude &longitude)
-{
-    return os << transform(longitude);
-}
+    /** the last point which has been written */
+    Pixel current;
 
-static std::ostream &
-operator <<(std::ostream &os, const SurfacePosition &position)
-{
-    return os << position.getLongitude() << ","
-              << position.getLatitude();
-}
+    /** a line end which has not been written yet, because the next
+        point may extend it */
+    bool have_pending;
+    Pixel pending;
 
-static std::ostream &
-operator <<(std::ostream &os, const Distance &distance)
-{
-    return os << transform(distance);
-}
+    /** the points which were merged into the pending line */
+    std::vector<Pixel> merged;
 
-void
-SVGAirspaceWriter::write(const Airspace &as)
+public:
+    SVGPathBuilder(std::ostream &_os)
+        :os(_os), empty(true), have_pending(false) {}
+
+    bool isEmpty() const {
+        return empty;
+    }
+
+    void lineTo(const Pixel &p) {
+        if (empty) {
+            os << "M" << p;
+            empty = false;
+            current = p;
+            return;
+        }
+
+        const Pixel &last = have_pending ? pending : current;
+        if (p == last)
+            return;
+
+        if (have_pending) {
+            if (canExtend(p)) {
+                merged.push_back(pending);
+                pending = p;
+                return;
+            }
+
+            flushPending();
+        }
+
+        pending = p;
+        have_pending = true;
+    }
+
+    void arcTo(int sign, const Pixel &end, const Pixel &center, long radius) {
+        flushPending();
+
+        if (end == current)
+            return;
+
+        /* on the screen (y pointing down), a positive angle is
+           clockwise, just like a positive arc sign */
+        double delta =
+            atan2((double)(end.y - center.y), (double)(end.x - center.x)) -
+            atan2((double)(current.y - center.y),
+                  (double)(current.x - center.x));
+        if (sign < 0)
+            delta = -delta;
+        if (delta < 0)
+            delta += 2 * M_PI;
+
+        os << "a" << radius << "," << radius << " 0 "
+           << (delta > M_PI ? 1 : 0) << "," << (sign > 0 ? 1 : 0) << " "
+           << Pixel(end.x - current.x, end.y - current.y);
+        current = end;
+    }
+
+    void close() {
+        flushPending();
+        os << "z";
+    }
+
+private:
+    /** can the pending line be replaced with a line to p? */
+    bool canExtend(const Pixel &p) const {
+        const PlanePoint a(current.x, current.y), b(p.x, p.y);
+
+        /* don't fold back onto the line */
+        if ((pending.x - current.x) * (p.x - pending.x) +
+            (pending.y - current.y) * (p.y - pending.y) < 0)
+            return false;
+
+        if (plane_segment_distance(PlanePoint(pending.x, pending.y),
+                                   a, b) > PIXEL_TOLERANCE)
+            return false;
+
+        for (std::vector<Pixel>::const_iterator it = merged.begin();
+             it != merged.end(); ++it)
+            if (plane_segment_distance(PlanePoint(it->x, it->y),
+                                       a, b) > PIXEL_TOLERANCE)
+                return false;
+
+        return true;
+    }
+
+    void flushPending() {
+        if (!have_pending)
+            return;
+
+        os << "l" << Pixel(pending.x - current.x, pending.y - current.y);
+        current = pending;
+        have_pending = false;
+        merged.clear();
+    }
+};
+
+/**
+ * Writes the outline of an airspace.  All coordinates are snapped to
+ * the pixel grid, so the output size depends on the image size
+ * rather than on the input.
+ */
+static void
+write_shape(std::ostream &os, const Airspace &airspace,
+            const SVGProjection &projection)
 {
-    stream << "  <g>\n";
-    stream << "  <path d=\"";
+    const char *css_class = airspace_class(airspace);
+    const Airspace::EdgeList &edges = airspace.getEdges();
+    bool have_circles = false;
 
-    Airspace::EdgeList circles;
+    std::ostringstream d;
+    SVGPathBuilder path(d);
 
-    const Airspace::EdgeList &edges = as.getEdges();
     for (Airspace::EdgeList::const_iterator it = edges.begin();
          it != edges.end(); ++it) {
         const Edge &edge = *it;
 
         switch (edge.getType()) {
         case Edge::TYPE_VERTEX:
-            if (it == edges.begin())
-                stream << "M";
-            else
-                stream << "L";
-
-            stream << edge.getEnd() << " ";
+            path.lineTo(projection.project(edge.getEnd()));
             break;
 
         case Edge::TYPE_CIRCLE:
-            circles.push_back(edge);
+            have_circles = true;
             break;
 
         case Edge::TYPE_ARC:
-            const Distance radius = edge.getEnd() - edge.getCenter();
-
-            stream << "A" << radius << "," << radius
-                   << " 0 0,0 " << edge.getEnd() << " ";
+            {
+                const Pixel end = projection.project(edge.getEnd());
+                const Pixel center = projection.project(edge.getCenter());
+                const long radius = lround(hypot((double)(end.x - center.x),
+                                                 (double)(end.y - center.y)));
+
+                if (path.isEmpty() || radius == 0)
+                    path.lineTo(end);
+                else
+                    path.arcTo(edge.getSign(), end, center, radius);
+            }
             break;
         }
     }
 
-    stream << "Z\" style=\"" << airspace_style(as) << "\"/>\n";
+    if (!path.isEmpty()) {
+        path.close();
+        os << "<path class=\"" << css_class
+           << "\" d=\"" << d.str() << "\"/>\n";
+    }
+
+    if (!have_circles)
+        return;
 
-    for (Airspace::EdgeList::const_iterator it = circles.begin();
-         it != circles.end(); ++it) {
+    for (Airspace::EdgeList::const_iterator it = edges.begin();
+         it != edges.end(); ++it) {
         const Edge &edge = *it;
-        assert(edge.getType() == Edge::TYPE_CIRCLE);
+        if (edge.getType() != Edge::TYPE_CIRCLE)
+            continue;
+
+        const Pixel center = projection.project(edge.getCenter());
+        const long radius = lround(edge.getRadius()
+                                   .toUnit(Distance::UNIT_NAUTICAL_MILES)
+                                   .getValue() * 1000.
+                                   * projection.getScale());
+
+        os << "<circle class=\"" << css_class
+           << "\" cx=\"" << center.x << "\" cy=\"" << center.y
+           << "\" r=\"" << radius << "\"/>\n";
+    }
+}
 
-        stream << "<circle cx=\"" << edge.getCenter().getLongitude()
-               << "\" cy=\"" << edge.getCenter().getLatitude()
-               << "\" r=\"" << transform(edge.getRadius())
-               << "\" style=\"" << airspace_style(as) << "\"/>\n";
+void
+SVGAirspaceWriter::write(const Airspace &as)
+{
+    const GeoBounds bounds = airspace_bounds(as);
+    const GeoBounds &area = airspace_writer_options.svg_area;
+
+    if (!bounds.defined() ||
+        (area.defined() && !area.overlaps(bounds))) {
+        /* not visible: don't even keep it in memory */
+        ++num_culled;
+        return;
+    }
+
+    items.push_back(Item(as, bounds));
+}
+
+void
+SVGAirspaceWriter::render(std::vector<Shape> &shapes,
+                          const SVGProjection &projection,
+                          const GeoBounds &area)
+{
+    std::ostringstream os;
+
+    for (std::vector<Item>::const_iterator it = items.begin();
+         it != items.end(); ++it) {
+        if (!area.overlaps(it->bounds)) {
+            ++num_culled;
+            continue;
+        }
+
+        Shape shape;
+        shape.bounds.x_min = projection.x(it->bounds.longitude_min);
+        shape.bounds.x_max = projection.x(it->bounds.longitude_max);
+        shape.bounds.y_min = projection.y(it->bounds.latitude_max);
+        shape.bounds.y_max = projection.y(it->bounds.latitude_min);
+
+        if (shape.bounds.x_max - shape.bounds.x_min < MIN_PIXEL_SIZE &&
+            shape.bounds.y_max - shape.bounds.y_min < MIN_PIXEL_SIZE) {
+            ++num_culled;
+            continue;
+        }
+
+        os.str(std::string());
+        write_shape(os, it->airspace, projection);
+        shape.svg = os.str();
+
+        shapes.push_back(shape);
+    }
+
+    items.clear();
+}
+
+/** returns the file name without the ".svg" suffix */
+static std::string
+tile_base(const char *filename)
+{
+    if (filename == NULL)
+        throw std::runtime_error("Tiled SVG output needs an output file name");
+
+    std::string base(filename);
+    const std::string::size_type dot = base.rfind('.');
+    if (dot != std::string::npos && base.find('/', dot) == std::string::npos)
+        base.erase(dot);
+
+    return base;
+}
+
+static std::string
+tile_name(const std::string &base, unsigned x, unsigned y)
+{
+    std::ostringstream os;
+    os << base << "-" << x << "-" << y << ".svg";
+    return os.str();
+}
+
+/**
+ * Writes one SVG file per tile, and an index to the main output
+ * stream which shows all tiles.  Each tile uses the global pixel
+ * coordinates, and selects its part with the viewBox.
+ */
+void
+SVGAirspaceWriter::writeTiles(const std::vector<Shape> &shapes,
+                              const SVGProjection &projection,
+                              unsigned tiles)
+{
+    const std::string base = tile_base(airspace_writer_options.filename);
+    const std::string::size_type slash = base.rfind('/');
+    const std::string link_base = slash == std::string::npos
+        ? base : base.substr(slash + 1);
+
+    const double tile_width = projection.getWidth() / tiles;
+    const double tile_height = ceil(projection.getHeight() / tiles);
+
+    write_header(stream, 0, 0,
+                 tile_width, tile_height,
+                 projection.getWidth(), tile_height * tiles);
+
+    for (unsigned y = 0; y < tiles; ++y) {
+        for (unsigned x = 0; x < tiles; ++x) {
+            const double x0 = x * tile_width, y0 = y * tile_height;
+            const std::string name = tile_name(base, x, y);
+
+            std::ofstream tile(name.c_str());
+            if (tile.fail())
+                throw std::runtime_error("Failed to create " + name +
+                                         ": " + strerror(errno));
+
+            tile.exceptions(std::ios_base::badbit | std::ios_base::failbit);
+
+            write_header(tile, x0, y0, tile_width, tile_height,
+                         tile_width, tile_height);
+
+            for (std::vector<Shape>::const_iterator it = shapes.begin();
+                 it != shapes.end(); ++it)
+                if (it->bounds.overlaps(x0, y0, x0 + tile_width,
+                                        y0 + tile_height))
+                    tile << it->svg;
+
+            tile << "</svg>\n";
+
+            stream << "<image x=\"" << x0 << "\" y=\"" << y0
+                   << "\" width=\"" << tile_width
+                   << "\" height=\"" << tile_height
+                   << "\" xlink:href=\"" << tile_name(link_base, x, y)
+                   << "\"/>\n";
+        }
     }
-    stream << "  </g>\n";
 }
 
 void
 SVGAirspaceWriter::flush()
 {
+    GeoBounds area = airspace_writer_options.svg_area;
+    if (!area.defined()) {
+        /* automatic projection: show all airspaces */
+        for (std::vector<Item>::const_iterator it = items.begin();
+             it != items.end(); ++it)
+            area.extend(it->bounds);
+
+        if (!area.defined())
+            area.extend(0, 0);
+    }
+
+    const unsigned tiles = airspace_writer_options.svg_tiles;
+    const SVGProjection projection(area, (double)airspace_writer_options.svg_width *
+                                   (tiles > 0 ? tiles : 1));
+
+    std::vector<Shape> shapes;
+    render(shapes, projection, area);
+
+    if (tiles > 0) {
+        writeTiles(shapes, projection, tiles);
+    } else {
+        write_header(stream, 0, 0,
+                     projection.getWidth(), projection.getHeight(),
+                     projection.getWidth(), projection.getHeight());
+
+        for (std::vector<Shape>::const_iterator it = shapes.begin();
+             it != shapes.end(); ++it)
+            stream << it->svg;
+    }
+
     stream << "</svg>\n";
+
+    if (airspace_writer_options.verbose)
+        std::cerr << "svg: " << shapes.size() << " airspaces drawn, "
+                  << num_culled << " culled" << std::endl;
 }
 
 AirspaceReader *
@@ -0,0 +1,289 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "exception.hh"
+#include "airspace.hh"
+#include "airspace-io.hh"
+#include "airspace-geometry.hh"
+
+#include <iostream>
+#include <vector>
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+/** a polygon whose closing line is shorter than this is considered
+    accidentally unclosed */
+static const double CLOSURE_TOLERANCE_METERS = 50;
+
+/** are the points closer than one plane unit (about 2 meters)? */
+static bool
+same_point(const PlanePoint &a, const PlanePoint &b)
+{
+    return fabs(a.x - b.x) < 1 && fabs(a.y - b.y) < 1;
+}
+
+/**
+ * A reader which checks each airspace for defects which upset
+ * devices: duplicate vertices, polygons which are almost but not
+ * exactly closed, degenerate outlines, circles mixed with other
+ * edges, and self-intersections.  Defects are reported on stderr
+ * with the line numbers of the input file.  Optionally, duplicate
+ * vertices and closure gaps are repaired.
+ */
+class ValidateAirspaceReader : public AirspaceReader {
+private:
+    AirspaceReader *reader;
+    bool repair;
+
+    unsigned long num_airspaces, num_defective, num_repaired;
+    unsigned long num_clockwise, num_counter_clockwise;
+
+    /** the number of defects of the current airspace */
+    unsigned num_defects;
+
+public:
+    ValidateAirspaceReader(AirspaceReader *_reader, bool _repair)
+        :reader(_reader), repair(_repair),
+         num_airspaces(0), num_defective(0), num_repaired(0),
+         num_clockwise(0), num_counter_clockwise(0) {}
+
+    virtual ~ValidateAirspaceReader() {
+        delete reader;
+    }
+
+public:
+    virtual const Airspace *read();
+
+private:
+    void report(const Airspace &airspace, const input_location &location,
+                const char *message, const char *detail = NULL);
+
+    bool checkEdges(const Airspace &airspace, Airspace::EdgeList &edges);
+    void checkOutline(const Airspace &airspace);
+};
+
+void
+ValidateAirspaceReader::report(const Airspace &airspace,
+                               const input_location &location,
+                               const char *message, const char *detail)
+{
+    ++num_defects;
+
+    const input_location &where = location.defined()
+        ? location : airspace.getLocation();
+    if (where.defined())
+        std::cerr << "line " << where.line << ": ";
+
+    std::cerr << "'" << airspace.getName() << "': " << message;
+    if (detail != NULL)
+        std::cerr << " " << detail;
+    std::cerr << std::endl;
+}
+
+/**
+ * Checks the edge list for duplicate vertices and closure gaps.
+ * Returns true if the repaired list in "edges" differs from the
+ * original.
+ */
+bool
+ValidateAirspaceReader::checkEdges(const Airspace &airspace,
+                                   Airspace::EdgeList &edges)
+{
+    const Airspace::EdgeList &original = airspace.getEdges();
+    unsigned num_circles = 0;
+    bool modified = false;
+
+    for (Airspace::EdgeList::const_iterator it = original.begin();
+         it != original.end(); ++it) {
+        const Edge &edge = *it;
+
+        if (edge.getType() == Edge::TYPE_CIRCLE) {
+            ++num_circles;
+            edges.push_back(edge);
+            continue;
+        }
+
+        if (edge.getType() == Edge::TYPE_VERTEX && !edges.empty() &&
+            edges.back().getType() != Edge::TYPE_CIRCLE &&
+            edges.back().getEnd() == edge.getEnd()) {
+            report(airspace, edge.getLocation(), "duplicate vertex");
+            if (repair) {
+                modified = true;
+                continue;
+            }
+        }
+
+        edges.push_back(edge);
+    }
+
+    if (num_circles > 0 && num_circles < original.size()) {
+        report(airspace, input_location(), "circle mixed with other edges");
+        return modified;
+    }
+
+    if (num_circles > 0 || edges.size() < 2)
+        return modified;
+
+    const Edge &first = edges.front();
+    Edge &last = edges.back();
+    if (first.getType() == Edge::TYPE_VERTEX &&
+        last.getType() == Edge::TYPE_VERTEX &&
+        !(first.getEnd() == last.getEnd())) {
+        const double gap = (last.getEnd() - first.getEnd()).getMeters();
+        if (gap < CLOSURE_TOLERANCE_METERS) {
+            char detail[32];
+            snprintf(detail, sizeof(detail), "(%.0fm gap)", gap);
+            report(airspace, last.getLocation(), "polygon is not closed",
+                   detail);
+
+            if (repair) {
+                const input_location location = last.getLocation();
+                last = Edge(first.getEnd());
+                last.setLocation(location);
+                modified = true;
+            }
+        }
+    }
+
+    return modified;
+}
+
+void
+ValidateAirspaceReader::checkOutline(const Airspace &airspace)
+{
+    const Airspace::EdgeList &edges = airspace.getEdges();
+    if (edges.empty() || edges.front().getType() == Edge::TYPE_CIRCLE)
+        return;
+
+    const LocalProjection projection(edges.front().getEnd().getLatitude());
+    PlanePointList raw;
+    EdgeSourceList raw_sources;
+    airspace_tessellate(airspace, projection, raw, raw_sources);
+
+    /* drop repeated points, including the explicit closing vertex;
+       they are not self-intersections */
+    PlanePointList polygon;
+    EdgeSourceList sources;
+    for (PlanePointList::size_type i = 0; i < raw.size(); ++i) {
+        if (!polygon.empty() && same_point(raw[i], polygon.back()))
+            continue;
+
+        polygon.push_back(raw[i]);
+        sources.push_back(raw_sources[i]);
+    }
+
+    while (polygon.size() > 1 && same_point(polygon.back(), polygon.front())) {
+        polygon.pop_back();
+        sources.pop_back();
+    }
+
+    if (polygon.size() < 3) {
+        report(airspace, input_location(), "degenerate outline");
+        return;
+    }
+
+    unsigned a, b;
+    if (plane_polygon_find_intersection(polygon, a, b)) {
+        /* edge i ends at vertex i+1, which was produced by the
+           command defining it */
+        const input_location &location_a =
+            sources[(a + 1) % polygon.size()]->getLocation();
+        const input_location &location_b =
+            sources[(b + 1) % polygon.size()]->getLocation();
+
+        char detail[64];
+        if (location_b.defined() && location_b.line != location_a.line)
+            snprintf(detail, sizeof(detail), "with line %u", location_b.line);
+        else
+            *detail = 0;
+
+        report(airspace, location_a, "self-intersection",
+               *detail != 0 ? detail : NULL);
+        return;
+    }
+
+    /* the orientation is only meaningful for simple polygons */
+    const double area2 = plane_signed_area2(polygon);
+    if (fabs(area2) < 1)
+        report(airspace, input_location(), "degenerate outline");
+    else if (area2 < 0)
+        ++num_clockwise;
+    else
+        ++num_counter_clockwise;
+}
+
+const Airspace *
+ValidateAirspaceReader::read()
+{
+    const Airspace *airspace = reader->read();
+    if (airspace == NULL) {
+        if (airspace_writer_options.verbose && num_airspaces > 0) {
+            std::cerr << "validate: " << num_defective << " of "
+                      << num_airspaces << " airspaces defective";
+            if (repair)
+                std::cerr << ", " << num_repaired << " repaired";
+            std::cerr << "; " << num_clockwise << " clockwise, "
+                      << num_counter_clockwise << " counter-clockwise"
+                      << std::endl;
+            num_airspaces = 0;
+        }
+
+        return NULL;
+    }
+
+    ++num_airspaces;
+    num_defects = 0;
+
+    Airspace::EdgeList edges;
+    if (checkEdges(*airspace, edges)) {
+        Airspace *repaired =
+            new Airspace(airspace->getName(), airspace->getType(),
+                         airspace->getBottom(), airspace->getTop(),
+                         airspace->getTop2(), edges,
+                         airspace->getFrequency(), airspace->getVoice());
+        repaired->setLocation(airspace->getLocation());
+        delete airspace;
+        airspace = repaired;
+        ++num_repaired;
+    }
+
+    checkOutline(*airspace);
+
+    if (num_defects > 0)
+        ++num_defective;
+
+    return airspace;
+}
+
+AirspaceReader *
+ValidateAirspaceFilter::createFilter(AirspaceReader *reader,
+                                     const char *args) const
+{
+    bool repair = false;
+
+    if (args != NULL && *args != 0) {
+        if (strcmp(args, "repair") != 0)
+            throw malformed_input("Unknown argument, only \"repair\" is allowed");
+        repair = true;
+    }
+
+    return new ValidateAirspaceReader(reader, repair);
+}
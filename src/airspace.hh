@@ -22,6 +22,7 @@
 
 #include "earth.hh"
 #include "aviation.hh"
+#include "exception.hh"
 
 #include <string>
 #include <list>
@@ -40,6 +41,9 @@ private:
     SurfacePosition end, center;
     Distance radius;
 
+    /** where this edge was defined in the input file */
+    input_location location;
+
 public:
     Edge(const SurfacePosition &_end)
         :type(TYPE_VERTEX), end(_end),
@@ -66,6 +70,12 @@ public:
     const Distance &getRadius() const {
         return radius;
     }
+    const input_location &getLocation() const {
+        return location;
+    }
+    void setLocation(const input_location &_location) {
+        location = _location;
+    }
 };
 
 static inline bool operator ==(const Edge &a, const Edge &b)
@@ -131,6 +141,9 @@ private:
     /** cenfis specific */
     unsigned voice;
 
+    /** where this airspace was defined in the input file */
+    input_location location;
+
 public:
     Airspace(const std::string &name, type_t type,
              const Altitude &bottom, const Altitude &top,
@@ -172,6 +185,13 @@ public:
     unsigned getVoice() const {
         return voice;
     }
+
+    const input_location &getLocation() const {
+        return location;
+    }
+    void setLocation(const input_location &_location) {
+        location = _location;
+    }
 };
 
 #endif
@@ -25,23 +25,122 @@
 #include <assert.h>
 #include <stdlib.h>
 
-Latitude::value_t CenfisBuffer::latitude_sum = 0;
-Longitude::value_t CenfisBuffer::longitude_sum = 0;
+/** the minimum size of a newly allocated chunk */
+static const size_t MIN_CHUNK_SIZE = 256;
 
 void
-CenfisBuffer::fill(uint8_t ch, size_t length)
+CenfisBuffer::clear()
 {
-    need_buffer(buffer_pos + length);
-    memset((char*)buffer + buffer_pos, ch, length);
-    buffer_pos += length;
+    for (std::vector<Chunk>::iterator it = chunks.begin();
+         it != chunks.end(); ++it)
+        delete[] it->data;
+
+    chunks.clear();
+    buffer_pos = 0;
 }
 
 void
-CenfisBuffer::append(const void *p, size_t length)
+CenfisBuffer::reserve(size_t length)
+{
+    if (!chunks.empty() &&
+        chunks.back().capacity - chunks.back().size >= length)
+        return;
+
+    /* grow geometrically, so the number of chunks stays
+       logarithmic */
+    Chunk chunk;
+    chunk.capacity = std::max(std::max(length, buffer_pos), MIN_CHUNK_SIZE);
+    chunk.data = new char[chunk.capacity];
+    chunk.size = 0;
+    chunks.push_back(chunk);
+}
+
+char *
+CenfisBuffer::write_area(size_t &length)
 {
-    need_buffer(buffer_pos + length);
-    memcpy((char*)buffer + buffer_pos, p, length);
+    assert(length > 0);
+
+    if (chunks.empty() || chunks.back().size == chunks.back().capacity)
+        reserve(length);
+
+    Chunk &chunk = chunks.back();
+    if (length > chunk.capacity - chunk.size)
+        length = chunk.capacity - chunk.size;
+
+    char *p = chunk.data + chunk.size;
+    chunk.size += length;
     buffer_pos += length;
+    return p;
+}
+
+void
+CenfisBuffer::fill(uint8_t ch, size_t length)
+{
+    while (length > 0) {
+        size_t nbytes = length;
+        char *p = write_area(nbytes);
+        memset(p, ch, nbytes);
+        length -= nbytes;
+    }
+}
+
+void
+CenfisBuffer::append(const void *p0, size_t length)
+{
+    const char *p = (const char*)p0;
+
+    while (length > 0) {
+        size_t nbytes = length;
+        memcpy(write_area(nbytes), p, nbytes);
+        p += nbytes;
+        length -= nbytes;
+    }
+}
+
+unsigned char &
+CenfisBuffer::operator [](size_t offset)
+{
+    assert(offset < buffer_pos);
+
+    std::vector<Chunk>::iterator it = chunks.begin();
+    while (offset >= it->size) {
+        offset -= it->size;
+        ++it;
+    }
+
+    return (unsigned char&)it->data[offset];
+}
+
+CenfisBuffer &
+CenfisBuffer::operator <<(const CenfisBuffer &src)
+{
+    auto_bank_switch(src.tell());
+    reserve(src.tell());
+
+    for (std::vector<Chunk>::const_iterator it = src.chunks.begin();
+         it != src.chunks.end(); ++it)
+        append(it->data, it->size);
+
+    return *this;
+}
+
+CenfisBuffer &
+CenfisBuffer::operator <<(CenfisBuffer &&src)
+{
+    auto_bank_switch(src.tell());
+
+    for (std::vector<Chunk>::const_iterator it = src.chunks.begin();
+         it != src.chunks.end(); ++it) {
+        if (it->size > 0)
+            chunks.push_back(*it);
+        else
+            delete[] it->data;
+    }
+
+    buffer_pos += src.buffer_pos;
+    src.chunks.clear();
+    src.buffer_pos = 0;
+    return *this;
 }
 
 void
@@ -92,11 +191,13 @@ CenfisBuffer::append(const Altitude &alt)
 void
 CenfisBuffer::append(const SurfacePosition &pos)
 {
+    assert(context != NULL);
+
     append_long(pos.getLatitude().refactor(60));
     append_long(pos.getLongitude().refactor(60));
 
-    latitude_sum += pos.getLatitude().refactor(60);
-    longitude_sum += pos.getLongitude().refactor(60);
+    context->latitude_sum += pos.getLatitude().refactor(60);
+    context->longitude_sum += pos.getLongitude().refactor(60);
     ++num_vertices;
 
     arc_start = &pos;
@@ -106,9 +207,11 @@ void
 CenfisBuffer::append_first(const SurfacePosition &pos)
 {
     assert(num_vertices == 0);
+    assert(context != NULL);
 
-    latitude_sum = 0;
-    longitude_sum = 0;
+    context->latitude_sum = 0;
+    context->longitude_sum = 0;
+    context->sums_reset = true;
 
     append_byte(8);
     append(pos);
@@ -122,14 +225,23 @@ CenfisBuffer::append(const SurfacePosition &pos, const SurfacePosition &rel)
     append_short(pos.getLongitude().refactor(60) -
                  rel.getLongitude().refactor(60));
 
-    latitude_sum += pos.getLatitude().refactor(60);
-    longitude_sum += pos.getLongitude().refactor(60);
+    assert(context != NULL);
+    context->latitude_sum += pos.getLatitude().refactor(60);
+    context->longitude_sum += pos.getLongitude().refactor(60);
     ++num_vertices;
 }
 
 void
 CenfisBuffer::append_anchor(const SurfacePosition &rel)
 {
+    assert(context != NULL);
+
+    if (!context->sums_reset)
+        context->depends = true;
+
+    Latitude::value_t &latitude_sum = context->latitude_sum;
+    Longitude::value_t &longitude_sum = context->longitude_sum;
+
     latitude_sum /= num_vertices;
     latitude_sum -= rel.getLatitude().refactor(60);
 
@@ -264,7 +376,11 @@ CenfisBuffer::append_arc(const Edge &edge, const SurfacePosition &rel)
     int end_alfa_i = deg10_add(arc_angle_deg10(edge.getEnd(), edge.getCenter()),
                                -edge.getSign());
 
-    static int num_points = 0; /* static due to bug reproduction */
+    assert(context != NULL);
+
+    /* bug reproduction: num_points is kept from the previous arc
+       when start and end angle are equal */
+    int &num_points = context->num_points;
     if (edge.getSign() > 0) {
         if (start_alfa_i < end_alfa_i)
             num_points = end_alfa_i - start_alfa_i;
@@ -277,6 +393,11 @@ CenfisBuffer::append_arc(const Edge &edge, const SurfacePosition &rel)
             num_points = start_alfa_i - end_alfa_i;
     }
 
+    if (start_alfa_i != end_alfa_i)
+        context->num_points_set = true;
+    else if (!context->num_points_set)
+        context->depends = true;
+
     for (int i = 0; i <= num_points; ++i) {
         int angle = start_alfa_i + edge.getSign() * i;
 
@@ -329,5 +450,23 @@ CenfisBuffer::encrypt(size_t length)
 {
     assert(length <= buffer_pos);
 
-    cenfis_encrypt(buffer + buffer_pos - length, length);
+    if (length == 0)
+        return;
+
+    Chunk &last = chunks.back();
+    if (last.size >= length) {
+        cenfis_encrypt(last.data + last.size - length, length);
+        return;
+    }
+
+    /* the data spans several chunks; the key stream starts over with
+       every cenfis_encrypt() call, so encrypt a contiguous copy */
+    std::vector<unsigned char> tmp(length);
+    for (size_t i = 0; i < length; ++i)
+        tmp[i] = (*this)[buffer_pos - length + i];
+
+    cenfis_encrypt(&tmp[0], length);
+
+    for (size_t i = 0; i < length; ++i)
+        (*this)[buffer_pos - length + i] = tmp[i];
 }
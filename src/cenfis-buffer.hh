@@ -24,71 +24,165 @@
 #include "airspace.hh"
 
 #include <string>
+#include <vector>
 #include <ostream>
+#include <algorithm>
 
 #include <assert.h>
 #include <string.h>
 
+/**
+ * State which is carried from one airspace record to the next.  The
+ * original Cenfis software has a few bugs which make a record depend
+ * on the previous ones, and we reproduce them.
+ *
+ * To compile records independently, start with a blank context: it
+ * records which values were overwritten, and whether the record
+ * depended on a value inherited from its predecessor.  Such a record
+ * has to be compiled again with the real context.
+ */
+struct CenfisCompileContext {
+    /** if an airspace has no first vertex, it inherits the first
+        vertex of the previous one */
+    SurfacePosition first_vertex;
+
+    /** the anchor is calculated from the vertex sums, which are not
+        reset if there is no first vertex */
+    Latitude::value_t latitude_sum;
+    Longitude::value_t longitude_sum;
+
+    /** the number of arc points is kept if the arc start and end
+        angles are equal */
+    int num_points;
+
+    bool first_vertex_set, sums_reset, num_points_set;
+
+    /** has a value of the predecessor been used? */
+    bool depends;
+
+    CenfisCompileContext()
+        :latitude_sum(0), longitude_sum(0), num_points(0),
+         first_vertex_set(false), sums_reset(false), num_points_set(false),
+         depends(false) {}
+
+    /**
+     * Apply the changes made by a record which was compiled with a
+     * blank context.
+     */
+    void merge(const CenfisCompileContext &next) {
+        assert(!next.depends);
+
+        if (next.first_vertex_set)
+            first_vertex = next.first_vertex;
+
+        if (next.sums_reset) {
+            latitude_sum = next.latitude_sum;
+            longitude_sum = next.longitude_sum;
+        } else {
+            latitude_sum += next.latitude_sum;
+            longitude_sum += next.longitude_sum;
+        }
+
+        if (next.num_points_set)
+            num_points = next.num_points;
+    }
+};
+
+/**
+ * A growable byte buffer for building Cenfis files.  The data is
+ * stored in a list of chunks: growing allocates a new chunk instead
+ * of copying, and splicing another buffer moves its chunks over
+ * without copying the data.
+ */
 class CenfisBuffer {
 private:
-    char *buffer;
-    size_t base, buffer_size, buffer_pos;
+    struct Chunk {
+        char *data;
+        size_t size, capacity;
+    };
+
+    std::vector<Chunk> chunks;
+    size_t base, buffer_pos;
     unsigned num_vertices;
 
-    /* bug reproduction: if an airspace has no first vertex, it
-       inherits some of the anchor of the previous airspace */
-    static Latitude::value_t latitude_sum;
-    static Longitude::value_t longitude_sum;
+    /** only needed for airspace records */
+    CenfisCompileContext *context;
 
     const SurfacePosition *arc_start;
 
 public:
     CenfisBuffer()
-        :buffer(NULL), base(0), buffer_size(0), buffer_pos(0),
-         num_vertices(0),
+        :base(0), buffer_pos(0),
+         num_vertices(0), context(NULL),
          arc_start(NULL) {}
 
     CenfisBuffer(size_t _base)
-        :buffer(NULL), base(_base), buffer_size(0), buffer_pos(0),
-         num_vertices(0),
+        :base(_base), buffer_pos(0),
+         num_vertices(0), context(NULL),
+         arc_start(NULL) {}
+
+    CenfisBuffer(CenfisCompileContext &_context)
+        :base(0), buffer_pos(0),
+         num_vertices(0), context(&_context),
          arc_start(NULL) {}
 
+    CenfisBuffer(CenfisBuffer &&other)
+        :base(0), buffer_pos(0),
+         num_vertices(0), context(NULL),
+         arc_start(NULL) {
+        swap(other);
+    }
+
+    CenfisBuffer(const CenfisBuffer &) = delete;
+
     ~CenfisBuffer()
     {
-        if (buffer != NULL)
-            delete[] buffer;
+        clear();
     }
 
-protected:
-    void need_buffer(size_t min_size)
+    CenfisBuffer &operator =(CenfisBuffer &&other)
     {
-        if (buffer_size >= min_size)
-            return;
-        size_t new_size = buffer_size;
-        if (new_size < 1024)
-            new_size = 1024;
-        do
-            new_size *= 2;
-        while (new_size < min_size);
-        char *new_buffer = new char[new_size];
-        if (new_buffer == NULL)
-            throw "XXX out of memory";
-        memcpy(new_buffer, buffer, buffer_pos);
-        buffer = new_buffer;
-        buffer_size = new_size;
+        swap(other);
+        return *this;
     }
 
-    const void *data() const
+    CenfisBuffer &operator =(const CenfisBuffer &) = delete;
+
+    void swap(CenfisBuffer &other)
     {
-        return buffer;
+        chunks.swap(other.chunks);
+        std::swap(base, other.base);
+        std::swap(buffer_pos, other.buffer_pos);
+        std::swap(num_vertices, other.num_vertices);
+        std::swap(context, other.context);
+        std::swap(arc_start, other.arc_start);
     }
 
+    /** free all data */
+    void clear();
+
+    /**
+     * Make sure that the next length bytes can be appended without
+     * allocating memory, and are contiguous.
+     */
+    void reserve(size_t length);
+
+private:
+    /** return a contiguous write area of at least one byte */
+    char *write_area(size_t &length);
+
 public:
     size_t tell() const
     {
         return buffer_pos;
     }
 
+    CenfisCompileContext &get_context()
+    {
+        assert(context != NULL);
+        return *context;
+    }
+
     void fill(uint8_t ch, size_t length);
     void append(const void *buffer, size_t length);
     void append(const char *s);
@@ -129,28 +223,24 @@ public:
 
     void make_header() {
         assert(buffer_pos == 0);
-        need_buffer(sizeof(header()));
-        buffer_pos = sizeof(header());
-        memset(buffer, 0xff, sizeof(header()));
+        reserve(sizeof(header()));
+        fill(0xff, sizeof(header()));
         header().voice_ind = 0;
     }
 
     struct cenfis_airspace_header &header()
     {
         assert(buffer_pos >= sizeof(header()));
-        return *(struct cenfis_airspace_header*)buffer;
+        assert(chunks.front().size >= sizeof(header()));
+        return *(struct cenfis_airspace_header*)chunks.front().data;
     }
 
-    unsigned char &operator [](size_t offset)
-    {
-        assert(offset < buffer_pos);
-        return (unsigned char&)buffer[offset];
-    }
+    unsigned char &operator [](size_t offset);
 
     void auto_bank_switch(size_t length)
     {
         size_t pos = base + tell();
-        if (pos / 0x8000 == (pos + length) / 0x8000)
+        if (length == 0 || pos / 0x8000 == (pos + length - 1) / 0x8000)
             return;
 
         /* don't write across bank limit, insert 0xff padding
@@ -160,18 +250,21 @@ public:
 
     void encrypt(size_t length);
 
-    CenfisBuffer &operator <<(const CenfisBuffer &src)
-    {
-        auto_bank_switch(src.tell());
-        append(src.data(), src.tell());
-        return *this;
-    }
+    CenfisBuffer &operator <<(const CenfisBuffer &src);
+
+    /**
+     * Move the contents of the other buffer to the end of this one,
+     * without copying.
+     */
+    CenfisBuffer &operator <<(CenfisBuffer &&src);
 
     friend std::ostream &operator <<(std::ostream &os, const CenfisBuffer &src)
     {
-        os.write((const std::ostream::char_type*)src.data(), src.tell());
+        for (std::vector<Chunk>::const_iterator it = src.chunks.begin();
+             it != src.chunks.end(); ++it)
+            os.write((const std::ostream::char_type*)it->data, it->size);
         return os;
     }
-} __attribute__((packed));
+};
 
 #endif
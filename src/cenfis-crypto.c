@@ -19,25 +19,251 @@
 
 #include "cenfis-crypto.h"
 
+#include <pthread.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_DISPATCH
+#endif
+
+#define KEY_LENGTH 200
+
+/** the widest vector step; the tables are extended by this much so a
+    full vector can be loaded at every key position */
+#define KEY_OVERLAP 32
+
 extern unsigned char cenfis_key_1[];
 
 extern unsigned char cenfis_key_2[];
 
 extern unsigned char cenfis_key_3[];
 
+/**
+ * The three key bytes of each position, with the constant offsets
+ * already applied: c = ((p ^ xor1[k]) + add[k]) ^ xor2[k].
+ */
+static struct {
+    unsigned char xor1[KEY_LENGTH + KEY_OVERLAP];
+    unsigned char add[KEY_LENGTH + KEY_OVERLAP];
+    unsigned char xor2[KEY_LENGTH + KEY_OVERLAP];
+} keystream;
+
+/** the fastest implementation the CPU supports */
+static enum cenfis_crypto_impl best_impl;
+
+/** the implementation in use, at most best_impl */
+static enum cenfis_crypto_impl impl;
+
+static pthread_once_t keystream_once = PTHREAD_ONCE_INIT;
+
+static void
+keystream_init(void)
+{
+    unsigned i, k;
+
+    for (i = 0; i < KEY_LENGTH + KEY_OVERLAP; ++i) {
+        k = i % KEY_LENGTH;
+        keystream.xor1[i] = (unsigned char)(cenfis_key_1[k] + 60);
+        keystream.add[i] = (unsigned char)(cenfis_key_2[k] - 60);
+        keystream.xor2[i] = (unsigned char)(cenfis_key_3[k] + 100);
+    }
+
+#ifdef __SSE2__
+    best_impl = CENFIS_CRYPTO_SSE2;
+#else
+    best_impl = CENFIS_CRYPTO_SCALAR;
+#endif
+
+#ifdef HAVE_AVX2_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        best_impl = CENFIS_CRYPTO_AVX2;
+#endif
+
+    impl = best_impl;
+}
+
+static size_t
+key_advance(size_t k, size_t n)
+{
+    k += n;
+    return k >= KEY_LENGTH ? k - KEY_LENGTH : k;
+}
+
+#ifdef HAVE_AVX2_DISPATCH
+
+__attribute__((target("avx2")))
+static inline __m256i
+load256(const unsigned char *p)
+{
+    return _mm256_loadu_si256((const __m256i*)p);
+}
+
+__attribute__((target("avx2")))
+static size_t
+encrypt_avx2(unsigned char *p, size_t length, size_t *k_r)
+{
+    size_t k = *k_r, done = 0;
+
+    for (; length - done >= 32; done += 32) {
+        __m256i v = load256(p + done);
+        v = _mm256_xor_si256(v, load256(keystream.xor1 + k));
+        v = _mm256_add_epi8(v, load256(keystream.add + k));
+        v = _mm256_xor_si256(v, load256(keystream.xor2 + k));
+        _mm256_storeu_si256((__m256i*)(p + done), v);
+        k = key_advance(k, 32);
+    }
+
+    *k_r = k;
+    return done;
+}
+
+__attribute__((target("avx2")))
+static size_t
+decrypt_avx2(unsigned char *p, size_t length, size_t *k_r)
+{
+    size_t k = *k_r, done = 0;
+
+    for (; length - done >= 32; done += 32) {
+        __m256i v = load256(p + done);
+        v = _mm256_xor_si256(v, load256(keystream.xor2 + k));
+        v = _mm256_sub_epi8(v, load256(keystream.add + k));
+        v = _mm256_xor_si256(v, load256(keystream.xor1 + k));
+        _mm256_storeu_si256((__m256i*)(p + done), v);
+        k = key_advance(k, 32);
+    }
+
+    *k_r = k;
+    return done;
+}
+
+#endif
+
+#ifdef __SSE2__
+
+static inline __m128i
+load128(const unsigned char *p)
+{
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+static size_t
+encrypt_sse2(unsigned char *p, size_t length, size_t *k_r)
+{
+    size_t k = *k_r, done = 0;
+
+    for (; length - done >= 16; done += 16) {
+        __m128i v = load128(p + done);
+        v = _mm_xor_si128(v, load128(keystream.xor1 + k));
+        v = _mm_add_epi8(v, load128(keystream.add + k));
+        v = _mm_xor_si128(v, load128(keystream.xor2 + k));
+        _mm_storeu_si128((__m128i*)(p + done), v);
+        k = key_advance(k, 16);
+    }
+
+    *k_r = k;
+    return done;
+}
+
+static size_t
+decrypt_sse2(unsigned char *p, size_t length, size_t *k_r)
+{
+    size_t k = *k_r, done = 0;
+
+    for (; length - done >= 16; done += 16) {
+        __m128i v = load128(p + done);
+        v = _mm_xor_si128(v, load128(keystream.xor2 + k));
+        v = _mm_sub_epi8(v, load128(keystream.add + k));
+        v = _mm_xor_si128(v, load128(keystream.xor1 + k));
+        _mm_storeu_si128((__m128i*)(p + done), v);
+        k = key_advance(k, 16);
+    }
+
+    *k_r = k;
+    return done;
+}
+
+#endif
+
 void
 cenfis_encrypt(void *p0, size_t length)
 {
     unsigned char *p = (unsigned char*)p0;
-    size_t k = 0;
+    size_t k = 0, done;
+
+    pthread_once(&keystream_once, keystream_init);
+
+#ifdef HAVE_AVX2_DISPATCH
+    if (impl >= CENFIS_CRYPTO_AVX2) {
+        done = encrypt_avx2(p, length, &k);
+        p += done;
+        length -= done;
+    }
+#endif
+
+#ifdef __SSE2__
+    if (impl >= CENFIS_CRYPTO_SSE2) {
+        done = encrypt_sse2(p, length, &k);
+        p += done;
+        length -= done;
+    }
+#endif
+
+    (void)done;
+
+    while (length > 0) {
+        *p = (unsigned char)(((*p ^ keystream.xor1[k]) + keystream.add[k])
+                             ^ keystream.xor2[k]);
+        k = key_advance(k, 1);
+        ++p;
+        --length;
+    }
+}
+
+void
+cenfis_decrypt(void *p0, size_t length)
+{
+    unsigned char *p = (unsigned char*)p0;
+    size_t k = 0, done;
+
+    pthread_once(&keystream_once, keystream_init);
+
+#ifdef HAVE_AVX2_DISPATCH
+    if (impl >= CENFIS_CRYPTO_AVX2) {
+        done = decrypt_avx2(p, length, &k);
+        p += done;
+        length -= done;
+    }
+#endif
+
+#ifdef __SSE2__
+    if (impl >= CENFIS_CRYPTO_SSE2) {
+        done = decrypt_sse2(p, length, &k);
+        p += done;
+        length -= done;
+    }
+#endif
+
+    (void)done;
 
     while (length > 0) {
-        *p = ((*p ^ (cenfis_key_1[k] + 60)) + cenfis_key_2[k] - 60)
-            ^ (cenfis_key_3[k] + 100);
-        ++k;
-        if (k == 200)
-            k = 0;
+        *p = (unsigned char)(((*p ^ keystream.xor2[k]) - keystream.add[k])
+                             ^ keystream.xor1[k]);
+        k = key_advance(k, 1);
         ++p;
         --length;
     }
 }
+
+enum cenfis_crypto_impl
+cenfis_crypto_select(enum cenfis_crypto_impl limit)
+{
+    pthread_once(&keystream_once, keystream_init);
+
+    impl = limit < best_impl ? limit : best_impl;
+    return impl;
+}
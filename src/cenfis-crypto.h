@@ -22,7 +22,43 @@
 
 #include <sys/types.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Encrypts a buffer in place.  The key stream starts over at the
+ * beginning of every call.
+ */
 void
 cenfis_encrypt(void *p0, size_t length);
 
+/**
+ * Reverses cenfis_encrypt().
+ */
+void
+cenfis_decrypt(void *p0, size_t length);
+
+/**
+ * The instruction sets cenfis_encrypt() and cenfis_decrypt() can
+ * use, from the slowest to the fastest.
+ */
+enum cenfis_crypto_impl {
+    CENFIS_CRYPTO_SCALAR,
+    CENFIS_CRYPTO_SSE2,
+    CENFIS_CRYPTO_AVX2,
+};
+
+/**
+ * Limits cenfis_encrypt() and cenfis_decrypt() to the given
+ * instruction set, for the test suite.  Returns the fastest one
+ * which is available up to that limit.
+ */
+enum cenfis_crypto_impl
+cenfis_crypto_select(enum cenfis_crypto_impl limit);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
@@ -115,7 +115,6 @@ command_upload(const struct config *config, int argc, char **argv, int pos)
     size_t length;
     cenfis_status_t status;
     cenfis_t cenfis;
-    struct timeval tv;
 
     if (pos >= argc)
         arg_error("Please provide a file name");
@@ -149,12 +148,9 @@ command_upload(const struct config *config, int argc, char **argv, int pos)
     /* wait for the device to become ready and automatically respond
        to questions */
     while (1) {
-        tv.tv_sec = 1;
-        tv.tv_usec = 0;
-
         printf("Waiting for device\n");
 
-        status = cenfis_select(cenfis, &tv);
+        status = cenfis_select(cenfis, 1000);
         if (cenfis_is_error(status)) {
             fprintf(stderr, "cenfis_select failed with status %d\n", status);
             _exit(1);
@@ -208,10 +204,7 @@ command_upload(const struct config *config, int argc, char **argv, int pos)
         }
 
         /* wait for ACK from device */
-        tv.tv_sec = 2;
-        tv.tv_usec = 0;
-
-        status = cenfis_select(cenfis, &tv);
+        status = cenfis_select(cenfis, 2000);
         if (cenfis_is_error(status)) {
             fprintf(stderr, "cenfis_select failed with status %d\n", status);
             _exit(1);
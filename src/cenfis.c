@@ -120,22 +120,22 @@ cenfis_flush(cenfis_t cenfis)
 }
 
 cenfis_status_t
-cenfis_select(cenfis_t cenfis,
-              struct timeval *timeout)
+cenfis_select(cenfis_t cenfis, unsigned timeout_ms)
 {
+    const uint64_t deadline = serialio_deadline(timeout_ms);
     int ret;
     size_t nbytes;
     char *p;
 
-    if (cenfis_is_error(cenfis->status) || timeout == NULL)
+    if (cenfis_is_error(cenfis->status))
         return cenfis->status;
 
-    assert(timeout->tv_sec > 0 || timeout->tv_usec > 0);
+    assert(timeout_ms > 0);
 
     do {
         /* select on file handle */
         ret = serialio_select(cenfis->serio, SERIALIO_SELECT_AVAILABLE,
-                              timeout);
+                              deadline);
         if (ret < 0) {
             cenfis_invalidate(cenfis);
             return CENFIS_STATUS_ERRNO;
@@ -220,7 +220,7 @@ cenfis_select(cenfis_t cenfis,
             cenfis_flush(cenfis);
             break;
         }
-    } while (timeout->tv_sec > 0 || timeout->tv_usec > 0);
+    } while (serialio_now() < deadline);
 
     return cenfis->status;
 }
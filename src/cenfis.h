@@ -50,9 +50,12 @@ cenfis_close(cenfis_t cenfis);
 void
 cenfis_dump(cenfis_t cenfis, int fd);
 
+/**
+ * Reads from the device until its status changes, or until
+ * timeout_ms milliseconds have passed.
+ */
 cenfis_status_t
-cenfis_select(cenfis_t cenfis,
-              struct timeval *timeout);
+cenfis_select(cenfis_t cenfis, unsigned timeout_ms);
 
 cenfis_status_t
 cenfis_confirm(cenfis_t cenfis);
@@ -164,3 +164,51 @@ parsePosition(const char *&p)
 
     return Position(latitude, longitude, Altitude());
 }
+
+const Altitude
+parseAltitude(const char *p)
+{
+    char *q;
+    long value;
+    Altitude::unit_t unit = Altitude::UNIT_FEET;
+    Altitude::ref_t ref = Altitude::REF_MSL;
+
+    skipWhitespace(p);
+
+    if (strcmp(p, "UNL") == 0)
+        return Altitude();
+
+    if (strcmp(p, "GND") == 0 || strcmp(p, "SFC") == 0)
+        return Altitude(0, Altitude::UNIT_FEET, Altitude::REF_GND);
+
+    if (p[0] == 'F' && p[1] == 'L') {
+        value = strtol(p + 2, &q, 10);
+        if (q == p + 2 || *q != 0)
+            throw malformed_input("failed to parse flight level");
+
+        return Altitude(value * 100, Altitude::UNIT_FEET, Altitude::REF_1013);
+    }
+
+    value = strtol(p, &q, 10);
+    if (q == p)
+        throw malformed_input("failed to parse altitude value");
+
+    p = q;
+    if (strncmp(p, "ft", 2) == 0) {
+        p += 2;
+    } else if (*p == 'm' && (p[1] == 0 || p[1] == ' ')) {
+        unit = Altitude::UNIT_METERS;
+        ++p;
+    }
+
+    skipWhitespace(p);
+
+    if (strcmp(p, "GND") == 0 || strcmp(p, "AGL") == 0)
+        ref = Altitude::REF_GND;
+    else if (strcmp(p, "STD") == 0)
+        ref = Altitude::REF_1013;
+    else if (*p != 0 && strcmp(p, "MSL") != 0)
+        throw malformed_input("unknown altitude reference");
+
+    return Altitude(value, unit, ref);
+}
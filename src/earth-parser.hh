@@ -28,4 +28,12 @@ parseDistance(const char *p);
 const Position
 parsePosition(const char *&p);
 
+/**
+ * Parses an altitude like "FL95", "GND", "1500ft GND" or "2000m MSL".
+ * The reference defaults to MSL.  "UNL" returns an undefined
+ * altitude.
+ */
+const Altitude
+parseAltitude(const char *p);
+
 #endif
@@ -54,7 +54,7 @@ public:
         case UNIT_FEET:
             return value / 3.2808399;
         case UNIT_NAUTICAL_MILES:
-            return value / 1.852;
+            return value * 1852.;
         }
 
         return 0.0;
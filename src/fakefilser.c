@@ -44,10 +44,26 @@
 #include "datadir.h"
 #include "lxn-reader.h"
 #include "dump.h"
+#include "serialio.h"
 
 struct config {
     int verbose;
     const char *datadir, *tty;
+
+    /** the symlink to the virtual terminal */
+    const char *link;
+
+    /** split memory sections larger than this (0 = no limit) */
+    unsigned section_size;
+
+    /** send a bad CRC with every n-th memory section (0 = never) */
+    unsigned corrupt_interval;
+
+    /** answer the first n uploads with NAK */
+    unsigned nak_count;
+
+    /** ignore everything received at another line speed (0 = any) */
+    unsigned baud;
 };
 
 struct filser_wtf37 {
@@ -75,6 +91,8 @@ struct fake_filser {
     unsigned start_address, end_address;
     struct flight_file *flights;
     struct mem_block mem_blocks[0x10];
+    unsigned section_size, corrupt_interval, num_sections_sent;
+    unsigned nak_count;
 };
 
 
@@ -85,10 +103,6 @@ static void exit_handler(int dummy) {
     should_exit = 1;
 }
 
-static void alarm_handler(int dummy) {
-    (void)dummy;
-}
-
 static void usage(void) {
     puts("usage: fakefilser [options]\n\n"
          "valid options:\n"
@@ -120,6 +134,26 @@ static void usage(void) {
          " --virtual\n"
 #endif
          " -u             create a virtual terminal\n"
+#ifdef __GLIBC__
+         " --link PATH\n"
+#endif
+         " -l PATH        symlink the virtual terminal here (default /tmp/fakefilser)\n"
+#ifdef __GLIBC__
+         " --section-size BYTES\n"
+#endif
+         " -s BYTES       split memory sections larger than BYTES\n"
+#ifdef __GLIBC__
+         " --corrupt N\n"
+#endif
+         " -e N           send a bad CRC with every N-th memory section\n"
+#ifdef __GLIBC__
+         " --baud BAUD\n"
+#endif
+         " -b BAUD        answer only at this line speed\n"
+#ifdef __GLIBC__
+         " --nak N\n"
+#endif
+         " -n N           answer the first N uploads with NAK\n"
          "\n"
          );
 }
@@ -144,21 +178,27 @@ static void parse_cmdline(struct config *config,
         {"data", 1, 0, 'd'},
         {"tty", 1, 0, 't'},
         {"virtual", 0, 0, 'u'},
+        {"link", 1, 0, 'l'},
+        {"section-size", 1, 0, 's'},
+        {"corrupt", 1, 0, 'e'},
+        {"baud", 1, 0, 'b'},
+        {"nak", 1, 0, 'n'},
         {0,0,0,0}
     };
 #endif
 
     memset(config, 0, sizeof(*config));
     config->tty = "/dev/ttyS0";
+    config->link = "/tmp/fakefilser";
 
     while (1) {
 #ifdef __GLIBC__
         int option_index = 0;
 
-        ret = getopt_long(argc, argv, "hVvqd:t:u",
+        ret = getopt_long(argc, argv, "hVvqd:t:ul:s:e:b:n:",
                           long_options, &option_index);
 #else
-        ret = getopt(argc, argv, "hVvqd:t:u");
+        ret = getopt(argc, argv, "hVvqd:t:ul:s:e:b:n:");
 #endif
         if (ret == -1)
             break;
@@ -193,6 +233,27 @@ static void parse_cmdline(struct config *config,
             config->tty = NULL;
             break;
 
+        case 'l':
+            config->tty = NULL;
+            config->link = optarg;
+            break;
+
+        case 's':
+            config->section_size = (unsigned)atoi(optarg);
+            break;
+
+        case 'e':
+            config->corrupt_interval = (unsigned)atoi(optarg);
+            break;
+
+        case 'b':
+            config->baud = (unsigned)atoi(optarg);
+            break;
+
+        case 'n':
+            config->nak_count = (unsigned)atoi(optarg);
+            break;
+
         default:
             exit(1);
         }
@@ -242,7 +303,7 @@ static void write_crc(filser_t device, const void *buffer, size_t length) {
 static ssize_t read_full_crc(filser_t device, void *buffer, size_t len) {
     int ret;
 
-    ret = filser_read_crc(device, buffer, len, 40);
+    ret = filser_read_crc(device, buffer, len, 40000);
     if (ret == -2) {
         fprintf(stderr, "CRC error\n");
         _exit(1);
@@ -263,37 +324,28 @@ static void dump_buffer_crc(const void *q,
 
 static void dump_timeout(struct fake_filser *filser) {
     unsigned char data;
-    ssize_t nbytes;
-    time_t timeout = time(NULL) + 2;
     unsigned offset = 0, i;
     unsigned char row[0x10];
 
-    while (1) {
-        alarm(1);
-        nbytes = read(filser->device->fd, &data, sizeof(data));
-        alarm(0);
-        if (nbytes < 0)
-            break;
-        if ((size_t)nbytes >= sizeof(data)) {
-            if (offset % 16 == 0)
-                printf("%04x ", offset);
-            else if (offset % 8 == 0)
-                printf(" ");
-
-            printf(" %02x", data);
-            row[offset%0x10] = data;
-            ++offset;
-
-            if (offset % 16 == 0) {
-                printf(" | ");
-                for (i = 0; i < 0x10; i++)
-                    putchar(row[i] >= 0x20 && row[i] < 0x80 ? row[i] : '.');
-                printf("\n");
-            }
+    /* dump until the client is silent for two seconds */
+    while (serialio_read_full(filser->device->fd, &data, sizeof(data),
+                              2000) > 0) {
+        if (offset % 16 == 0)
+            printf("%04x ", offset);
+        else if (offset % 8 == 0)
+            printf(" ");
+
+        printf(" %02x", data);
+        row[offset%0x10] = data;
+        ++offset;
+
+        if (offset % 16 == 0) {
+            printf(" | ");
+            for (i = 0; i < 0x10; i++)
+                putchar(row[i] >= 0x20 && row[i] < 0x80 ? row[i] : '.');
+            printf("\n");
+        }
 
-            timeout = time(NULL) + 2;
-        } else if (time(NULL) >= timeout)
-            break;
         fflush(stdout);
     }
 
@@ -323,9 +375,20 @@ static void send_ack(struct fake_filser *filser) {
     }
 }
 
-static void download_to_file(struct fake_filser *filser,
-                             const char *filename,
-                             size_t length) {
+static void send_nak(struct fake_filser *filser) {
+    static const unsigned char nak = FILSER_NAK;
+
+    if (write(filser->device->fd, &nak, sizeof(nak)) != sizeof(nak)) {
+        fprintf(stderr, "write() failed: %s\n", strerror(errno));
+        _exit(1);
+    }
+}
+
+/** returns 0 on success, -1 if the upload is rejected (the caller
+    sends NAK) */
+static int download_to_file(struct fake_filser *filser,
+                            const char *filename,
+                            size_t length) {
     void *buffer;
     int ret;
 
@@ -335,7 +398,17 @@ static void download_to_file(struct fake_filser *filser,
         abort();
     }
 
-    ret = filser_read_crc(filser->device, buffer, length, 10);
+    ret = filser_read_crc(filser->device, buffer, length, 10000);
+    if (ret == -2 || (ret > 0 && filser->nak_count > 0)) {
+        if (ret == -2)
+            fprintf(stderr, "CRC error in %s\n", filename);
+        else
+            --filser->nak_count;
+
+        free(buffer);
+        return -1;
+    }
+
     if (ret <= 0) {
         fprintf(stderr, "error during filser_read_crc\n");
         exit(2);
@@ -356,6 +429,7 @@ static void download_to_file(struct fake_filser *filser,
     }
 
     free(buffer);
+    return 0;
 }
 
 static void upload_from_file(struct fake_filser *filser,
@@ -593,17 +667,25 @@ static void handle_get_mem_section(struct fake_filser *filser) {
 
     for (flight = find_flight_at(filser, filser->start_address), i = 0;
          flight != NULL && address < filser->end_address && i < 0x10;
-         flight = flight->next, ++i) {
+         ++i) {
+        size_t length;
+
         filser->mem_blocks[i].flight = flight;
         filser->mem_blocks[i].offset = address - flight->address;
 
-        if (filser->end_address >= flight->address + flight->length) {
-            filser->mem_blocks[i].length = flight->address + flight->length - address;
-            address = flight->address + flight->length;
-        } else {
-            filser->mem_blocks[i].length = filser->end_address - address;
-            address = filser->end_address;
-        }
+        if (filser->end_address >= flight->address + flight->length)
+            length = flight->address + flight->length - address;
+        else
+            length = filser->end_address - address;
+
+        if (filser->section_size > 0 && length > filser->section_size)
+            length = filser->section_size;
+
+        filser->mem_blocks[i].length = length;
+        address += length;
+
+        if (address >= flight->address + flight->length)
+            flight = flight->next;
 
         packet.section_lengths[i] = htons(filser->mem_blocks[i].length);
     }
@@ -616,14 +698,16 @@ static void handle_def_mem(struct fake_filser *filser) {
 
     read_full_crc(filser->device, &packet, sizeof(packet));
 
+    /* the client copies the bytes from the flight index, lowest
+       byte first (see fill_flight_list()) */
     filser->start_address
-        = packet.start_address[2]
+        = packet.start_address[0]
         + (packet.start_address[1] << 8)
-        + (packet.start_address[0] << 16);
+        + (packet.start_address[2] << 16);
     filser->end_address
-        = packet.end_address[2]
+        = packet.end_address[0]
         + (packet.end_address[1] << 8)
-        + (packet.end_address[0] << 16);
+        + (packet.end_address[2] << 16);
 
     printf("def_mem: address = %02x %02x %02x %02x %02x %02x\n",
            packet.start_address[0],
@@ -657,7 +741,15 @@ static void handle_get_logger_data(struct fake_filser *filser, unsigned block) {
 
     printf("reading block %u size %u\n", block, size);
 
-    write_crc(filser->device, buffer, size);
+    if (filser->corrupt_interval > 0 &&
+        ++filser->num_sections_sent % filser->corrupt_interval == 0) {
+        unsigned char crc = filser_calc_crc(buffer, size) ^ 0xff;
+
+        printf("sending a bad CRC\n");
+        write(filser->device->fd, buffer, size);
+        write(filser->device->fd, &crc, sizeof(crc));
+    } else
+        write_crc(filser->device, buffer, size);
 
     if (data != NULL)
         free(data);
@@ -692,9 +784,10 @@ static void handle_read_tp_tsk(struct fake_filser *filser) {
 }
 
 static void handle_write_tp_tsk(struct fake_filser *filser) {
-    download_to_file(filser, "tp_tsk", 0x5528);
-
-    send_ack(filser);
+    if (download_to_file(filser, "tp_tsk", 0x5528) == 0)
+        send_ack(filser);
+    else
+        send_nak(filser);
 }
 
 static void handle_read_setup(struct fake_filser *filser) {
@@ -731,10 +824,11 @@ static void handle_get_extra_data(struct fake_filser *filser) {
 }
 
 static void handle_write_contest_class(struct fake_filser *filser) {
-    download_to_file(filser, "contest_class",
-                     sizeof(struct filser_contest_class));
-
-    send_ack(filser);
+    if (download_to_file(filser, "contest_class",
+                         sizeof(struct filser_contest_class)) == 0)
+        send_ack(filser);
+    else
+        send_nak(filser);
 }
 
 static void handle_30(struct fake_filser *filser) {
@@ -757,15 +851,17 @@ static void handle_apt_upload(struct fake_filser *filser,
     char filename[] = "apt_X";
 
     filename[4] = '0' + idx;
-    download_to_file(filser, filename, 0x8000);
-
-    send_ack(filser);
+    if (download_to_file(filser, filename, 0x8000) == 0)
+        send_ack(filser);
+    else
+        send_nak(filser);
 }
 
 static void handle_apt_state(struct fake_filser *filser) {
-    download_to_file(filser, "apt_state", 0xa07);
-
-    send_ack(filser);
+    if (download_to_file(filser, "apt_state", 0xa07) == 0)
+        send_ack(filser);
+    else
+        send_nak(filser);
 }
 
 static int open_virtual(const char *symlink_path) {
@@ -804,7 +900,7 @@ static void open_tty(struct config *config, filser_t *device_r) {
     int fd, ret;
 
     if (config->tty == NULL) {
-        fd = open_virtual("/tmp/fakefilser");
+        fd = open_virtual(config->link);
         if (fd < 0) {
             fprintf(stderr, "failed to open tty\n");
             exit(2);
@@ -837,9 +933,11 @@ int main(int argc, char **argv) {
     signal(SIGINT, exit_handler);
     signal(SIGTERM, exit_handler);
     signal(SIGQUIT, exit_handler);
-    signal(SIGALRM, alarm_handler);
 
     default_filser(&filser);
+    filser.section_size = config.section_size;
+    filser.corrupt_interval = config.corrupt_interval;
+    filser.nak_count = config.nak_count;
 
     open_tty(&config, &filser.device);
 
@@ -854,7 +952,7 @@ int main(int argc, char **argv) {
         unsigned char cmd;
         int ret;
 
-        ret = filser_read(filser.device, &cmd, sizeof(cmd), 5);
+        ret = filser_read(filser.device, &cmd, sizeof(cmd), 5000);
         if (ret < 0) {
             if (errno == EIO) {
                 filser_close(&filser.device);
@@ -872,6 +970,13 @@ int main(int argc, char **argv) {
         if (ret == 0)
             continue;
 
+        /* a real logger sees only line noise at the wrong speed; on a
+           virtual terminal, the master reports the speed the other
+           side has chosen */
+        if (config.baud > 0 &&
+            serialio_get_baud(filser.device->fd) != config.baud)
+            continue;
+
         switch (cmd) {
         case FILSER_SYN: /* SYN (expects ACK) */
             printf("received SYN\n");
@@ -880,7 +985,7 @@ int main(int argc, char **argv) {
             break;
 
         case FILSER_PREFIX:
-            ret = filser_read(filser.device, &cmd, sizeof(cmd), 5);
+            ret = filser_read(filser.device, &cmd, sizeof(cmd), 5000);
             if (ret <= 0) {
                 fprintf(stderr, "read failed: %s\n", strerror(errno));
                 _exit(1);
@@ -48,6 +48,9 @@
 struct config {
     int verbose;
     const char *datadir, *tty;
+
+    /** the symlink to the virtual terminal */
+    const char *link;
 };
 
 struct fake_zander {
@@ -63,10 +66,6 @@ static void exit_handler(int dummy) {
     should_exit = 1;
 }
 
-static void alarm_handler(int dummy) {
-    (void)dummy;
-}
-
 static void usage(void) {
     puts("usage: fakezander [options]\n\n"
          "valid options:\n"
@@ -98,6 +97,10 @@ static void usage(void) {
          " --virtual\n"
 #endif
          " -u             create a virtual terminal\n"
+#ifdef __GLIBC__
+         " --link PATH\n"
+#endif
+         " -l PATH        symlink the virtual terminal here (default /tmp/fakezander)\n"
          "\n"
          );
 }
@@ -122,21 +125,23 @@ static void parse_cmdline(struct config *config,
         {"data", 1, 0, 'd'},
         {"tty", 1, 0, 't'},
         {"virtual", 0, 0, 'u'},
+        {"link", 1, 0, 'l'},
         {0,0,0,0}
     };
 #endif
 
     memset(config, 0, sizeof(*config));
     config->tty = "/dev/ttyS0";
+    config->link = "/tmp/fakezander";
 
     while (1) {
 #ifdef __GLIBC__
         int option_index = 0;
 
-        ret = getopt_long(argc, argv, "hVvqd:t:u",
+        ret = getopt_long(argc, argv, "hVvqd:t:ul:",
                           long_options, &option_index);
 #else
-        ret = getopt(argc, argv, "hVvqd:t:u");
+        ret = getopt(argc, argv, "hVvqd:t:ul:");
 #endif
         if (ret == -1)
             break;
@@ -171,6 +176,11 @@ static void parse_cmdline(struct config *config,
             config->tty = NULL;
             break;
 
+        case 'l':
+            config->tty = NULL;
+            config->link = optarg;
+            break;
+
         default:
             exit(1);
         }
@@ -387,7 +397,7 @@ static void open_tty(struct config *config, zander_t *device_r) {
     int fd, ret;
 
     if (config->tty == NULL) {
-        fd = open_virtual("/tmp/fakezander");
+        fd = open_virtual(config->link);
         if (fd < 0) {
             fprintf(stderr, "failed to open tty\n");
             exit(2);
@@ -419,7 +429,6 @@ int main(int argc, char **argv) {
     signal(SIGINT, exit_handler);
     signal(SIGTERM, exit_handler);
     signal(SIGQUIT, exit_handler);
-    signal(SIGALRM, alarm_handler);
 
     open_tty(&config, &zander.device);
 
@@ -489,8 +498,10 @@ int main(int argc, char **argv) {
             break;
 
         default:
+            /* ignore garbage like a real logger does, e.g. another
+               protocol's probe */
             fprintf(stderr, "unknown command 0x%02x received\n", cmd);
-            _exit(1);
+            break;
         }
     }
 
@@ -21,6 +21,306 @@
 
 #include "filser.h"
 
+/**
+ * crc_table[0][x] is the CRC register after shifting in the byte x,
+ * starting with zero (polynomial 0x69, MSB first).  crc_table[k][x]
+ * is the same followed by k zero bytes; the CRC is linear, so the
+ * contribution of each byte in a group of 8 can be looked up
+ * independently ("slicing-by-8").
+ */
+static const unsigned char crc_table[8][256] = {
+    {
+        0x00, 0x69, 0xd2, 0xbb, 0xcd, 0xa4, 0x1f, 0x76,
+        0xf3, 0x9a, 0x21, 0x48, 0x3e, 0x57, 0xec, 0x85,
+        0x8f, 0xe6, 0x5d, 0x34, 0x42, 0x2b, 0x90, 0xf9,
+        0x7c, 0x15, 0xae, 0xc7, 0xb1, 0xd8, 0x63, 0x0a,
+        0x77, 0x1e, 0xa5, 0xcc, 0xba, 0xd3, 0x68, 0x01,
+        0x84, 0xed, 0x56, 0x3f, 0x49, 0x20, 0x9b, 0xf2,
+        0xf8, 0x91, 0x2a, 0x43, 0x35, 0x5c, 0xe7, 0x8e,
+        0x0b, 0x62, 0xd9, 0xb0, 0xc6, 0xaf, 0x14, 0x7d,
+        0xee, 0x87, 0x3c, 0x55, 0x23, 0x4a, 0xf1, 0x98,
+        0x1d, 0x74, 0xcf, 0xa6, 0xd0, 0xb9, 0x02, 0x6b,
+        0x61, 0x08, 0xb3, 0xda, 0xac, 0xc5, 0x7e, 0x17,
+        0x92, 0xfb, 0x40, 0x29, 0x5f, 0x36, 0x8d, 0xe4,
+        0x99, 0xf0, 0x4b, 0x22, 0x54, 0x3d, 0x86, 0xef,
+        0x6a, 0x03, 0xb8, 0xd1, 0xa7, 0xce, 0x75, 0x1c,
+        0x16, 0x7f, 0xc4, 0xad, 0xdb, 0xb2, 0x09, 0x60,
+        0xe5, 0x8c, 0x37, 0x5e, 0x28, 0x41, 0xfa, 0x93,
+        0xb5, 0xdc, 0x67, 0x0e, 0x78, 0x11, 0xaa, 0xc3,
+        0x46, 0x2f, 0x94, 0xfd, 0x8b, 0xe2, 0x59, 0x30,
+        0x3a, 0x53, 0xe8, 0x81, 0xf7, 0x9e, 0x25, 0x4c,
+        0xc9, 0xa0, 0x1b, 0x72, 0x04, 0x6d, 0xd6, 0xbf,
+        0xc2, 0xab, 0x10, 0x79, 0x0f, 0x66, 0xdd, 0xb4,
+        0x31, 0x58, 0xe3, 0x8a, 0xfc, 0x95, 0x2e, 0x47,
+        0x4d, 0x24, 0x9f, 0xf6, 0x80, 0xe9, 0x52, 0x3b,
+        0xbe, 0xd7, 0x6c, 0x05, 0x73, 0x1a, 0xa1, 0xc8,
+        0x5b, 0x32, 0x89, 0xe0, 0x96, 0xff, 0x44, 0x2d,
+        0xa8, 0xc1, 0x7a, 0x13, 0x65, 0x0c, 0xb7, 0xde,
+        0xd4, 0xbd, 0x06, 0x6f, 0x19, 0x70, 0xcb, 0xa2,
+        0x27, 0x4e, 0xf5, 0x9c, 0xea, 0x83, 0x38, 0x51,
+        0x2c, 0x45, 0xfe, 0x97, 0xe1, 0x88, 0x33, 0x5a,
+        0xdf, 0xb6, 0x0d, 0x64, 0x12, 0x7b, 0xc0, 0xa9,
+        0xa3, 0xca, 0x71, 0x18, 0x6e, 0x07, 0xbc, 0xd5,
+        0x50, 0x39, 0x82, 0xeb, 0x9d, 0xf4, 0x4f, 0x26,
+    },
+    {
+        0x00, 0x03, 0x06, 0x05, 0x0c, 0x0f, 0x0a, 0x09,
+        0x18, 0x1b, 0x1e, 0x1d, 0x14, 0x17, 0x12, 0x11,
+        0x30, 0x33, 0x36, 0x35, 0x3c, 0x3f, 0x3a, 0x39,
+        0x28, 0x2b, 0x2e, 0x2d, 0x24, 0x27, 0x22, 0x21,
+        0x60, 0x63, 0x66, 0x65, 0x6c, 0x6f, 0x6a, 0x69,
+        0x78, 0x7b, 0x7e, 0x7d, 0x74, 0x77, 0x72, 0x71,
+        0x50, 0x53, 0x56, 0x55, 0x5c, 0x5f, 0x5a, 0x59,
+        0x48, 0x4b, 0x4e, 0x4d, 0x44, 0x47, 0x42, 0x41,
+        0xc0, 0xc3, 0xc6, 0xc5, 0xcc, 0xcf, 0xca, 0xc9,
+        0xd8, 0xdb, 0xde, 0xdd, 0xd4, 0xd7, 0xd2, 0xd1,
+        0xf0, 0xf3, 0xf6, 0xf5, 0xfc, 0xff, 0xfa, 0xf9,
+        0xe8, 0xeb, 0xee, 0xed, 0xe4, 0xe7, 0xe2, 0xe1,
+        0xa0, 0xa3, 0xa6, 0xa5, 0xac, 0xaf, 0xaa, 0xa9,
+        0xb8, 0xbb, 0xbe, 0xbd, 0xb4, 0xb7, 0xb2, 0xb1,
+        0x90, 0x93, 0x96, 0x95, 0x9c, 0x9f, 0x9a, 0x99,
+        0x88, 0x8b, 0x8e, 0x8d, 0x84, 0x87, 0x82, 0x81,
+        0xe9, 0xea, 0xef, 0xec, 0xe5, 0xe6, 0xe3, 0xe0,
+        0xf1, 0xf2, 0xf7, 0xf4, 0xfd, 0xfe, 0xfb, 0xf8,
+        0xd9, 0xda, 0xdf, 0xdc, 0xd5, 0xd6, 0xd3, 0xd0,
+        0xc1, 0xc2, 0xc7, 0xc4, 0xcd, 0xce, 0xcb, 0xc8,
+        0x89, 0x8a, 0x8f, 0x8c, 0x85, 0x86, 0x83, 0x80,
+        0x91, 0x92, 0x97, 0x94, 0x9d, 0x9e, 0x9b, 0x98,
+        0xb9, 0xba, 0xbf, 0xbc, 0xb5, 0xb6, 0xb3, 0xb0,
+        0xa1, 0xa2, 0xa7, 0xa4, 0xad, 0xae, 0xab, 0xa8,
+        0x29, 0x2a, 0x2f, 0x2c, 0x25, 0x26, 0x23, 0x20,
+        0x31, 0x32, 0x37, 0x34, 0x3d, 0x3e, 0x3b, 0x38,
+        0x19, 0x1a, 0x1f, 0x1c, 0x15, 0x16, 0x13, 0x10,
+        0x01, 0x02, 0x07, 0x04, 0x0d, 0x0e, 0x0b, 0x08,
+        0x49, 0x4a, 0x4f, 0x4c, 0x45, 0x46, 0x43, 0x40,
+        0x51, 0x52, 0x57, 0x54, 0x5d, 0x5e, 0x5b, 0x58,
+        0x79, 0x7a, 0x7f, 0x7c, 0x75, 0x76, 0x73, 0x70,
+        0x61, 0x62, 0x67, 0x64, 0x6d, 0x6e, 0x6b, 0x68,
+    },
+    {
+        0x00, 0xbb, 0x1f, 0xa4, 0x3e, 0x85, 0x21, 0x9a,
+        0x7c, 0xc7, 0x63, 0xd8, 0x42, 0xf9, 0x5d, 0xe6,
+        0xf8, 0x43, 0xe7, 0x5c, 0xc6, 0x7d, 0xd9, 0x62,
+        0x84, 0x3f, 0x9b, 0x20, 0xba, 0x01, 0xa5, 0x1e,
+        0x99, 0x22, 0x86, 0x3d, 0xa7, 0x1c, 0xb8, 0x03,
+        0xe5, 0x5e, 0xfa, 0x41, 0xdb, 0x60, 0xc4, 0x7f,
+        0x61, 0xda, 0x7e, 0xc5, 0x5f, 0xe4, 0x40, 0xfb,
+        0x1d, 0xa6, 0x02, 0xb9, 0x23, 0x98, 0x3c, 0x87,
+        0x5b, 0xe0, 0x44, 0xff, 0x65, 0xde, 0x7a, 0xc1,
+        0x27, 0x9c, 0x38, 0x83, 0x19, 0xa2, 0x06, 0xbd,
+        0xa3, 0x18, 0xbc, 0x07, 0x9d, 0x26, 0x82, 0x39,
+        0xdf, 0x64, 0xc0, 0x7b, 0xe1, 0x5a, 0xfe, 0x45,
+        0xc2, 0x79, 0xdd, 0x66, 0xfc, 0x47, 0xe3, 0x58,
+        0xbe, 0x05, 0xa1, 0x1a, 0x80, 0x3b, 0x9f, 0x24,
+        0x3a, 0x81, 0x25, 0x9e, 0x04, 0xbf, 0x1b, 0xa0,
+        0x46, 0xfd, 0x59, 0xe2, 0x78, 0xc3, 0x67, 0xdc,
+        0xb6, 0x0d, 0xa9, 0x12, 0x88, 0x33, 0x97, 0x2c,
+        0xca, 0x71, 0xd5, 0x6e, 0xf4, 0x4f, 0xeb, 0x50,
+        0x4e, 0xf5, 0x51, 0xea, 0x70, 0xcb, 0x6f, 0xd4,
+        0x32, 0x89, 0x2d, 0x96, 0x0c, 0xb7, 0x13, 0xa8,
+        0x2f, 0x94, 0x30, 0x8b, 0x11, 0xaa, 0x0e, 0xb5,
+        0x53, 0xe8, 0x4c, 0xf7, 0x6d, 0xd6, 0x72, 0xc9,
+        0xd7, 0x6c, 0xc8, 0x73, 0xe9, 0x52, 0xf6, 0x4d,
+        0xab, 0x10, 0xb4, 0x0f, 0x95, 0x2e, 0x8a, 0x31,
+        0xed, 0x56, 0xf2, 0x49, 0xd3, 0x68, 0xcc, 0x77,
+        0x91, 0x2a, 0x8e, 0x35, 0xaf, 0x14, 0xb0, 0x0b,
+        0x15, 0xae, 0x0a, 0xb1, 0x2b, 0x90, 0x34, 0x8f,
+        0x69, 0xd2, 0x76, 0xcd, 0x57, 0xec, 0x48, 0xf3,
+        0x74, 0xcf, 0x6b, 0xd0, 0x4a, 0xf1, 0x55, 0xee,
+        0x08, 0xb3, 0x17, 0xac, 0x36, 0x8d, 0x29, 0x92,
+        0x8c, 0x37, 0x93, 0x28, 0xb2, 0x09, 0xad, 0x16,
+        0xf0, 0x4b, 0xef, 0x54, 0xce, 0x75, 0xd1, 0x6a,
+    },
+    {
+        0x00, 0x05, 0x0a, 0x0f, 0x14, 0x11, 0x1e, 0x1b,
+        0x28, 0x2d, 0x22, 0x27, 0x3c, 0x39, 0x36, 0x33,
+        0x50, 0x55, 0x5a, 0x5f, 0x44, 0x41, 0x4e, 0x4b,
+        0x78, 0x7d, 0x72, 0x77, 0x6c, 0x69, 0x66, 0x63,
+        0xa0, 0xa5, 0xaa, 0xaf, 0xb4, 0xb1, 0xbe, 0xbb,
+        0x88, 0x8d, 0x82, 0x87, 0x9c, 0x99, 0x96, 0x93,
+        0xf0, 0xf5, 0xfa, 0xff, 0xe4, 0xe1, 0xee, 0xeb,
+        0xd8, 0xdd, 0xd2, 0xd7, 0xcc, 0xc9, 0xc6, 0xc3,
+        0x29, 0x2c, 0x23, 0x26, 0x3d, 0x38, 0x37, 0x32,
+        0x01, 0x04, 0x0b, 0x0e, 0x15, 0x10, 0x1f, 0x1a,
+        0x79, 0x7c, 0x73, 0x76, 0x6d, 0x68, 0x67, 0x62,
+        0x51, 0x54, 0x5b, 0x5e, 0x45, 0x40, 0x4f, 0x4a,
+        0x89, 0x8c, 0x83, 0x86, 0x9d, 0x98, 0x97, 0x92,
+        0xa1, 0xa4, 0xab, 0xae, 0xb5, 0xb0, 0xbf, 0xba,
+        0xd9, 0xdc, 0xd3, 0xd6, 0xcd, 0xc8, 0xc7, 0xc2,
+        0xf1, 0xf4, 0xfb, 0xfe, 0xe5, 0xe0, 0xef, 0xea,
+        0x52, 0x57, 0x58, 0x5d, 0x46, 0x43, 0x4c, 0x49,
+        0x7a, 0x7f, 0x70, 0x75, 0x6e, 0x6b, 0x64, 0x61,
+        0x02, 0x07, 0x08, 0x0d, 0x16, 0x13, 0x1c, 0x19,
+        0x2a, 0x2f, 0x20, 0x25, 0x3e, 0x3b, 0x34, 0x31,
+        0xf2, 0xf7, 0xf8, 0xfd, 0xe6, 0xe3, 0xec, 0xe9,
+        0xda, 0xdf, 0xd0, 0xd5, 0xce, 0xcb, 0xc4, 0xc1,
+        0xa2, 0xa7, 0xa8, 0xad, 0xb6, 0xb3, 0xbc, 0xb9,
+        0x8a, 0x8f, 0x80, 0x85, 0x9e, 0x9b, 0x94, 0x91,
+        0x7b, 0x7e, 0x71, 0x74, 0x6f, 0x6a, 0x65, 0x60,
+        0x53, 0x56, 0x59, 0x5c, 0x47, 0x42, 0x4d, 0x48,
+        0x2b, 0x2e, 0x21, 0x24, 0x3f, 0x3a, 0x35, 0x30,
+        0x03, 0x06, 0x09, 0x0c, 0x17, 0x12, 0x1d, 0x18,
+        0xdb, 0xde, 0xd1, 0xd4, 0xcf, 0xca, 0xc5, 0xc0,
+        0xf3, 0xf6, 0xf9, 0xfc, 0xe7, 0xe2, 0xed, 0xe8,
+        0x8b, 0x8e, 0x81, 0x84, 0x9f, 0x9a, 0x95, 0x90,
+        0xa3, 0xa6, 0xa9, 0xac, 0xb7, 0xb2, 0xbd, 0xb8,
+    },
+    {
+        0x00, 0xa4, 0x21, 0x85, 0x42, 0xe6, 0x63, 0xc7,
+        0x84, 0x20, 0xa5, 0x01, 0xc6, 0x62, 0xe7, 0x43,
+        0x61, 0xc5, 0x40, 0xe4, 0x23, 0x87, 0x02, 0xa6,
+        0xe5, 0x41, 0xc4, 0x60, 0xa7, 0x03, 0x86, 0x22,
+        0xc2, 0x66, 0xe3, 0x47, 0x80, 0x24, 0xa1, 0x05,
+        0x46, 0xe2, 0x67, 0xc3, 0x04, 0xa0, 0x25, 0x81,
+        0xa3, 0x07, 0x82, 0x26, 0xe1, 0x45, 0xc0, 0x64,
+        0x27, 0x83, 0x06, 0xa2, 0x65, 0xc1, 0x44, 0xe0,
+        0xed, 0x49, 0xcc, 0x68, 0xaf, 0x0b, 0x8e, 0x2a,
+        0x69, 0xcd, 0x48, 0xec, 0x2b, 0x8f, 0x0a, 0xae,
+        0x8c, 0x28, 0xad, 0x09, 0xce, 0x6a, 0xef, 0x4b,
+        0x08, 0xac, 0x29, 0x8d, 0x4a, 0xee, 0x6b, 0xcf,
+        0x2f, 0x8b, 0x0e, 0xaa, 0x6d, 0xc9, 0x4c, 0xe8,
+        0xab, 0x0f, 0x8a, 0x2e, 0xe9, 0x4d, 0xc8, 0x6c,
+        0x4e, 0xea, 0x6f, 0xcb, 0x0c, 0xa8, 0x2d, 0x89,
+        0xca, 0x6e, 0xeb, 0x4f, 0x88, 0x2c, 0xa9, 0x0d,
+        0xb3, 0x17, 0x92, 0x36, 0xf1, 0x55, 0xd0, 0x74,
+        0x37, 0x93, 0x16, 0xb2, 0x75, 0xd1, 0x54, 0xf0,
+        0xd2, 0x76, 0xf3, 0x57, 0x90, 0x34, 0xb1, 0x15,
+        0x56, 0xf2, 0x77, 0xd3, 0x14, 0xb0, 0x35, 0x91,
+        0x71, 0xd5, 0x50, 0xf4, 0x33, 0x97, 0x12, 0xb6,
+        0xf5, 0x51, 0xd4, 0x70, 0xb7, 0x13, 0x96, 0x32,
+        0x10, 0xb4, 0x31, 0x95, 0x52, 0xf6, 0x73, 0xd7,
+        0x94, 0x30, 0xb5, 0x11, 0xd6, 0x72, 0xf7, 0x53,
+        0x5e, 0xfa, 0x7f, 0xdb, 0x1c, 0xb8, 0x3d, 0x99,
+        0xda, 0x7e, 0xfb, 0x5f, 0x98, 0x3c, 0xb9, 0x1d,
+        0x3f, 0x9b, 0x1e, 0xba, 0x7d, 0xd9, 0x5c, 0xf8,
+        0xbb, 0x1f, 0x9a, 0x3e, 0xf9, 0x5d, 0xd8, 0x7c,
+        0x9c, 0x38, 0xbd, 0x19, 0xde, 0x7a, 0xff, 0x5b,
+        0x18, 0xbc, 0x39, 0x9d, 0x5a, 0xfe, 0x7b, 0xdf,
+        0xfd, 0x59, 0xdc, 0x78, 0xbf, 0x1b, 0x9e, 0x3a,
+        0x79, 0xdd, 0x58, 0xfc, 0x3b, 0x9f, 0x1a, 0xbe,
+    },
+    {
+        0x00, 0x0f, 0x1e, 0x11, 0x3c, 0x33, 0x22, 0x2d,
+        0x78, 0x77, 0x66, 0x69, 0x44, 0x4b, 0x5a, 0x55,
+        0xf0, 0xff, 0xee, 0xe1, 0xcc, 0xc3, 0xd2, 0xdd,
+        0x88, 0x87, 0x96, 0x99, 0xb4, 0xbb, 0xaa, 0xa5,
+        0x89, 0x86, 0x97, 0x98, 0xb5, 0xba, 0xab, 0xa4,
+        0xf1, 0xfe, 0xef, 0xe0, 0xcd, 0xc2, 0xd3, 0xdc,
+        0x79, 0x76, 0x67, 0x68, 0x45, 0x4a, 0x5b, 0x54,
+        0x01, 0x0e, 0x1f, 0x10, 0x3d, 0x32, 0x23, 0x2c,
+        0x7b, 0x74, 0x65, 0x6a, 0x47, 0x48, 0x59, 0x56,
+        0x03, 0x0c, 0x1d, 0x12, 0x3f, 0x30, 0x21, 0x2e,
+        0x8b, 0x84, 0x95, 0x9a, 0xb7, 0xb8, 0xa9, 0xa6,
+        0xf3, 0xfc, 0xed, 0xe2, 0xcf, 0xc0, 0xd1, 0xde,
+        0xf2, 0xfd, 0xec, 0xe3, 0xce, 0xc1, 0xd0, 0xdf,
+        0x8a, 0x85, 0x94, 0x9b, 0xb6, 0xb9, 0xa8, 0xa7,
+        0x02, 0x0d, 0x1c, 0x13, 0x3e, 0x31, 0x20, 0x2f,
+        0x7a, 0x75, 0x64, 0x6b, 0x46, 0x49, 0x58, 0x57,
+        0xf6, 0xf9, 0xe8, 0xe7, 0xca, 0xc5, 0xd4, 0xdb,
+        0x8e, 0x81, 0x90, 0x9f, 0xb2, 0xbd, 0xac, 0xa3,
+        0x06, 0x09, 0x18, 0x17, 0x3a, 0x35, 0x24, 0x2b,
+        0x7e, 0x71, 0x60, 0x6f, 0x42, 0x4d, 0x5c, 0x53,
+        0x7f, 0x70, 0x61, 0x6e, 0x43, 0x4c, 0x5d, 0x52,
+        0x07, 0x08, 0x19, 0x16, 0x3b, 0x34, 0x25, 0x2a,
+        0x8f, 0x80, 0x91, 0x9e, 0xb3, 0xbc, 0xad, 0xa2,
+        0xf7, 0xf8, 0xe9, 0xe6, 0xcb, 0xc4, 0xd5, 0xda,
+        0x8d, 0x82, 0x93, 0x9c, 0xb1, 0xbe, 0xaf, 0xa0,
+        0xf5, 0xfa, 0xeb, 0xe4, 0xc9, 0xc6, 0xd7, 0xd8,
+        0x7d, 0x72, 0x63, 0x6c, 0x41, 0x4e, 0x5f, 0x50,
+        0x05, 0x0a, 0x1b, 0x14, 0x39, 0x36, 0x27, 0x28,
+        0x04, 0x0b, 0x1a, 0x15, 0x38, 0x37, 0x26, 0x29,
+        0x7c, 0x73, 0x62, 0x6d, 0x40, 0x4f, 0x5e, 0x51,
+        0xf4, 0xfb, 0xea, 0xe5, 0xc8, 0xc7, 0xd6, 0xd9,
+        0x8c, 0x83, 0x92, 0x9d, 0xb0, 0xbf, 0xae, 0xa1,
+    },
+    {
+        0x00, 0x85, 0x63, 0xe6, 0xc6, 0x43, 0xa5, 0x20,
+        0xe5, 0x60, 0x86, 0x03, 0x23, 0xa6, 0x40, 0xc5,
+        0xa3, 0x26, 0xc0, 0x45, 0x65, 0xe0, 0x06, 0x83,
+        0x46, 0xc3, 0x25, 0xa0, 0x80, 0x05, 0xe3, 0x66,
+        0x2f, 0xaa, 0x4c, 0xc9, 0xe9, 0x6c, 0x8a, 0x0f,
+        0xca, 0x4f, 0xa9, 0x2c, 0x0c, 0x89, 0x6f, 0xea,
+        0x8c, 0x09, 0xef, 0x6a, 0x4a, 0xcf, 0x29, 0xac,
+        0x69, 0xec, 0x0a, 0x8f, 0xaf, 0x2a, 0xcc, 0x49,
+        0x5e, 0xdb, 0x3d, 0xb8, 0x98, 0x1d, 0xfb, 0x7e,
+        0xbb, 0x3e, 0xd8, 0x5d, 0x7d, 0xf8, 0x1e, 0x9b,
+        0xfd, 0x78, 0x9e, 0x1b, 0x3b, 0xbe, 0x58, 0xdd,
+        0x18, 0x9d, 0x7b, 0xfe, 0xde, 0x5b, 0xbd, 0x38,
+        0x71, 0xf4, 0x12, 0x97, 0xb7, 0x32, 0xd4, 0x51,
+        0x94, 0x11, 0xf7, 0x72, 0x52, 0xd7, 0x31, 0xb4,
+        0xd2, 0x57, 0xb1, 0x34, 0x14, 0x91, 0x77, 0xf2,
+        0x37, 0xb2, 0x54, 0xd1, 0xf1, 0x74, 0x92, 0x17,
+        0xbc, 0x39, 0xdf, 0x5a, 0x7a, 0xff, 0x19, 0x9c,
+        0x59, 0xdc, 0x3a, 0xbf, 0x9f, 0x1a, 0xfc, 0x79,
+        0x1f, 0x9a, 0x7c, 0xf9, 0xd9, 0x5c, 0xba, 0x3f,
+        0xfa, 0x7f, 0x99, 0x1c, 0x3c, 0xb9, 0x5f, 0xda,
+        0x93, 0x16, 0xf0, 0x75, 0x55, 0xd0, 0x36, 0xb3,
+        0x76, 0xf3, 0x15, 0x90, 0xb0, 0x35, 0xd3, 0x56,
+        0x30, 0xb5, 0x53, 0xd6, 0xf6, 0x73, 0x95, 0x10,
+        0xd5, 0x50, 0xb6, 0x33, 0x13, 0x96, 0x70, 0xf5,
+        0xe2, 0x67, 0x81, 0x04, 0x24, 0xa1, 0x47, 0xc2,
+        0x07, 0x82, 0x64, 0xe1, 0xc1, 0x44, 0xa2, 0x27,
+        0x41, 0xc4, 0x22, 0xa7, 0x87, 0x02, 0xe4, 0x61,
+        0xa4, 0x21, 0xc7, 0x42, 0x62, 0xe7, 0x01, 0x84,
+        0xcd, 0x48, 0xae, 0x2b, 0x0b, 0x8e, 0x68, 0xed,
+        0x28, 0xad, 0x4b, 0xce, 0xee, 0x6b, 0x8d, 0x08,
+        0x6e, 0xeb, 0x0d, 0x88, 0xa8, 0x2d, 0xcb, 0x4e,
+        0x8b, 0x0e, 0xe8, 0x6d, 0x4d, 0xc8, 0x2e, 0xab,
+    },
+    {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+        0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+        0x79, 0x68, 0x5b, 0x4a, 0x3d, 0x2c, 0x1f, 0x0e,
+        0xf1, 0xe0, 0xd3, 0xc2, 0xb5, 0xa4, 0x97, 0x86,
+        0xf2, 0xe3, 0xd0, 0xc1, 0xb6, 0xa7, 0x94, 0x85,
+        0x7a, 0x6b, 0x58, 0x49, 0x3e, 0x2f, 0x1c, 0x0d,
+        0x8b, 0x9a, 0xa9, 0xb8, 0xcf, 0xde, 0xed, 0xfc,
+        0x03, 0x12, 0x21, 0x30, 0x47, 0x56, 0x65, 0x74,
+        0x8d, 0x9c, 0xaf, 0xbe, 0xc9, 0xd8, 0xeb, 0xfa,
+        0x05, 0x14, 0x27, 0x36, 0x41, 0x50, 0x63, 0x72,
+        0xf4, 0xe5, 0xd6, 0xc7, 0xb0, 0xa1, 0x92, 0x83,
+        0x7c, 0x6d, 0x5e, 0x4f, 0x38, 0x29, 0x1a, 0x0b,
+        0x7f, 0x6e, 0x5d, 0x4c, 0x3b, 0x2a, 0x19, 0x08,
+        0xf7, 0xe6, 0xd5, 0xc4, 0xb3, 0xa2, 0x91, 0x80,
+        0x06, 0x17, 0x24, 0x35, 0x42, 0x53, 0x60, 0x71,
+        0x8e, 0x9f, 0xac, 0xbd, 0xca, 0xdb, 0xe8, 0xf9,
+        0x73, 0x62, 0x51, 0x40, 0x37, 0x26, 0x15, 0x04,
+        0xfb, 0xea, 0xd9, 0xc8, 0xbf, 0xae, 0x9d, 0x8c,
+        0x0a, 0x1b, 0x28, 0x39, 0x4e, 0x5f, 0x6c, 0x7d,
+        0x82, 0x93, 0xa0, 0xb1, 0xc6, 0xd7, 0xe4, 0xf5,
+        0x81, 0x90, 0xa3, 0xb2, 0xc5, 0xd4, 0xe7, 0xf6,
+        0x09, 0x18, 0x2b, 0x3a, 0x4d, 0x5c, 0x6f, 0x7e,
+        0xf8, 0xe9, 0xda, 0xcb, 0xbc, 0xad, 0x9e, 0x8f,
+        0x70, 0x61, 0x52, 0x43, 0x34, 0x25, 0x16, 0x07,
+        0xfe, 0xef, 0xdc, 0xcd, 0xba, 0xab, 0x98, 0x89,
+        0x76, 0x67, 0x54, 0x45, 0x32, 0x23, 0x10, 0x01,
+        0x87, 0x96, 0xa5, 0xb4, 0xc3, 0xd2, 0xe1, 0xf0,
+        0x0f, 0x1e, 0x2d, 0x3c, 0x4b, 0x5a, 0x69, 0x78,
+        0x0c, 0x1d, 0x2e, 0x3f, 0x48, 0x59, 0x6a, 0x7b,
+        0x84, 0x95, 0xa6, 0xb7, 0xc0, 0xd1, 0xe2, 0xf3,
+        0x75, 0x64, 0x57, 0x46, 0x31, 0x20, 0x13, 0x02,
+        0xfd, 0xec, 0xdf, 0xce, 0xb9, 0xa8, 0x9b, 0x8a,
+    },
+};
+
+unsigned char filser_calc_crc(const void *p0, size_t len) {
+    const unsigned char *p = p0;
+    unsigned char crc = 0xff;
+
+    /* 8 bytes at a time; the lookups do not depend on each other,
+       only the first one on the previous CRC */
+    for (; len >= 8; p += 8, len -= 8)
+        crc = crc_table[7][crc ^ p[0]] ^ crc_table[6][p[1]] ^
+            crc_table[5][p[2]] ^ crc_table[4][p[3]] ^
+            crc_table[3][p[4]] ^ crc_table[2][p[5]] ^
+            crc_table[1][p[6]] ^ crc_table[0][p[7]];
+
+    for (; len > 0; ++p, --len)
+        crc = crc_table[0][crc ^ *p];
+
+    return crc;
+}
+
 static unsigned char calc_crc_char(unsigned char d, unsigned char crc) {
     unsigned char tmp;
     const unsigned char crcpoly = 0x69;
@@ -35,7 +335,7 @@ static unsigned char calc_crc_char(unsigned char d, unsigned char crc) {
     return crc;
 }
 
-unsigned char filser_calc_crc(const void *p0, size_t len) {
+unsigned char filser_calc_crc_bitwise(const void *p0, size_t len) {
     const unsigned char *p = p0;
     size_t i;
     unsigned char crc = 0xff;
@@ -0,0 +1,578 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2007 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "open.h"
+
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <termios.h>
+#include <time.h>
+#include <stdlib.h>
+#include <arpa/inet.h>
+
+#include "filser.h"
+#include "serialio.h"
+#include "lxn-to-igc.h"
+
+/** how often a memory section is requested again before giving up */
+#define SECTION_RETRIES 5
+
+static void download_error(struct filser_download *download,
+                           const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+/** writes "PATH.part" to the buffer; fails with ENAMETOOLONG if it
+    does not fit */
+static int make_part_path(char *buffer, size_t size, const char *path) {
+    int ret = snprintf(buffer, size, "%s.part", path);
+
+    if (ret < 0 || (size_t)ret >= size) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+
+    return 0;
+}
+
+/** describes the error; the first one wins, because later errors
+    are usually a consequence */
+static void download_error(struct filser_download *download,
+                           const char *fmt, ...) {
+    va_list ap;
+
+    if (download->error[0] != 0)
+        return;
+
+    va_start(ap, fmt);
+    vsnprintf(download->error, sizeof(download->error), fmt, ap);
+    va_end(ap);
+}
+
+static void download_message(struct filser_download *download, int level,
+                             const char *fmt, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void download_message(struct filser_download *download, int level,
+                             const char *fmt, ...) {
+    char buffer[256];
+    va_list ap;
+
+    if (download->message == NULL)
+        return;
+
+    va_start(ap, fmt);
+    vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    va_end(ap);
+
+    download->message(download->ctx, level, buffer);
+}
+
+static int read_full_crc(filser_t device, void *buffer, size_t len) {
+    int ret;
+
+    ret = filser_read_crc(device, buffer, len, 40000);
+    if (ret == -2) {
+        errno = EBADMSG;
+        return -1;
+    }
+
+    if (ret == 0)
+        errno = ETIMEDOUT;
+
+    return ret;
+}
+
+/** SYN/ACK with a few retries; the device may be busy */
+static int sync_ack(filser_t device) {
+    unsigned tries;
+    int ret;
+
+    for (tries = 0; tries < 3; ++tries) {
+        ret = filser_syn_ack(device);
+        if (ret < 0)
+            return -1;
+        if (ret > 0)
+            return 0;
+    }
+
+    errno = ETIMEDOUT;
+    return -1;
+}
+
+static int seek_mem(filser_t device, const struct filser_flight_index *flight) {
+    struct filser_packet_def_mem packet;
+    int ret;
+    unsigned char response;
+
+    /* ignore highest byte here, the same as in kflog */
+
+    /* start address */
+    packet.start_address[0] = flight->start_address0;
+    packet.start_address[1] = flight->start_address1;
+    packet.start_address[2] = flight->start_address2;
+
+    /* end address */
+    packet.end_address[0] = flight->end_address0;
+    packet.end_address[1] = flight->end_address1;
+    packet.end_address[2] = flight->end_address2;
+
+    tcflush(device->fd, TCIOFLUSH);
+
+    ret = filser_write_packet(device, FILSER_DEF_MEM,
+                              &packet, sizeof(packet));
+    if (ret <= 0)
+        return -1;
+
+    ret = filser_read(device, &response, sizeof(response), 40000);
+    if (ret < 0)
+        return -1;
+
+    if (ret == 0) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
+    if (response != FILSER_ACK) {
+        errno = EPROTO;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int get_mem_section(filser_t device, size_t section_lengths[0x10]) {
+    struct filser_packet_mem_section packet;
+    int ret;
+    unsigned z;
+
+    ret = filser_send_command(device, FILSER_GET_MEM_SECTION);
+    if (ret <= 0)
+        return -1;
+
+    ret = read_full_crc(device, &packet, sizeof(packet));
+    if (ret <= 0)
+        return -1;
+
+    for (z = 0; z < 0x10; z++)
+        section_lengths[z] = ntohs(packet.section_lengths[z]);
+
+    return 0;
+}
+
+static int download_section(filser_t device, unsigned section,
+                            unsigned char *buffer, size_t length) {
+    int ret;
+
+    ret = filser_send_command(device, FILSER_READ_LOGGER_DATA + section);
+    if (ret <= 0)
+        return -1;
+
+    ret = read_full_crc(device, buffer, length);
+    if (ret <= 0)
+        return -1;
+
+    return 0;
+}
+
+/**
+ * Converts the LXN data to IGC while it is being downloaded.  The
+ * LXN packets do not respect section boundaries, so the tail of a
+ * section which does not form a complete packet is kept at the start
+ * of the buffer, and the next section is appended to it.
+ */
+struct igc_stream {
+    struct filser_download *download;
+
+    const char *path;
+
+    /** the file being written; it is renamed to the real name when
+        the conversion is complete */
+    char part_path[1024];
+
+    FILE *file;
+    lxn_to_igc_t fti;
+    unsigned char *buffer;
+    size_t capacity, pending;
+    int done, failed;
+};
+
+static int igc_stream_open(struct igc_stream *stream, const char *path,
+                           struct filser_download *download) {
+    int ret;
+
+    stream->download = download;
+    stream->path = path;
+    if (make_part_path(stream->part_path, sizeof(stream->part_path),
+                       path) < 0) {
+        download_error(download, "path too long: %s", path);
+        return -1;
+    }
+
+    stream->file = fopen(stream->part_path, "w");
+    if (stream->file == NULL) {
+        download_error(download, "failed to create %s: %s",
+                       stream->part_path, strerror(errno));
+        return -1;
+    }
+
+    ret = lxn_to_igc_open(stream->file, &stream->fti);
+    if (ret != 0) {
+        download_error(download, "lxn_to_igc_open() failed");
+        fclose(stream->file);
+        unlink(stream->part_path);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    stream->buffer = NULL;
+    stream->capacity = 0;
+    stream->pending = 0;
+    stream->done = 0;
+    stream->failed = 0;
+    return 0;
+}
+
+/** returns a buffer for the next section, behind the pending bytes */
+static unsigned char *igc_stream_prepare(struct igc_stream *stream,
+                                         size_t length) {
+    if (stream->pending + length > stream->capacity) {
+        stream->capacity = stream->pending + length;
+        stream->buffer = realloc(stream->buffer, stream->capacity);
+        if (stream->buffer == NULL)
+            abort();
+    }
+
+    return stream->buffer + stream->pending;
+}
+
+/** converts the section which was stored by the caller in the
+    buffer returned by igc_stream_prepare() */
+static void igc_stream_feed(struct igc_stream *stream, size_t length) {
+    size_t start = 0, end = stream->pending + length, consumed;
+    int ret;
+
+    while (start < end && !stream->done && !stream->failed) {
+        consumed = 0;
+        ret = lxn_to_igc_process(stream->fti, stream->buffer + start,
+                                 end - start, &consumed);
+        assert(start + consumed <= end);
+        start += consumed;
+
+        if (ret == 0) {
+            stream->done = 1;
+        } else if (ret == EAGAIN) {
+            /* incomplete packet, wait for the next section */
+            break;
+        } else {
+            if (ret == -1 && lxn_to_igc_error(stream->fti) != NULL)
+                download_error(stream->download,
+                               "lxn_to_igc_process() failed: %s",
+                               lxn_to_igc_error(stream->fti));
+            else
+                download_error(stream->download,
+                               "lxn_to_igc_process() failed: %d", ret);
+            stream->failed = 1;
+        }
+    }
+
+    if (stream->done || stream->failed)
+        start = end;
+
+    if (start > 0 && end > start)
+        memmove(stream->buffer, stream->buffer + start, end - start);
+    stream->pending = end - start;
+}
+
+static int igc_stream_close(struct igc_stream *stream) {
+    int ret;
+
+    if (!stream->failed && stream->pending > 0) {
+        download_error(stream->download, "unexpected eof");
+        stream->failed = 1;
+    }
+
+    ret = lxn_to_igc_close(&stream->fti);
+    if (ret != 0 && !stream->failed) {
+        download_error(stream->download, "lxn_to_igc_close() failed");
+        stream->failed = 1;
+    }
+
+    if (fclose(stream->file) != 0 && !stream->failed) {
+        download_error(stream->download, "failed to write %s: %s",
+                       stream->part_path, strerror(errno));
+        stream->failed = 1;
+    }
+
+    free(stream->buffer);
+
+    if (!stream->failed && rename(stream->part_path, stream->path) < 0) {
+        download_error(stream->download, "failed to rename %s: %s",
+                       stream->part_path, strerror(errno));
+        stream->failed = 1;
+    }
+
+    /* don't leave a truncated IGC file behind */
+    if (stream->failed) {
+        unlink(stream->part_path);
+        errno = EINVAL;
+        return -1;
+    }
+
+    return 0;
+}
+
+/** discards the IGC file after a failed download */
+static void igc_stream_abort(struct igc_stream *stream) {
+    const int e = errno;
+
+    stream->failed = 1;
+    igc_stream_close(stream);
+    errno = e;
+}
+
+/** waits 250 ms before the first retry, and doubles the delay up to
+    8 seconds */
+static void backoff(unsigned attempt) {
+    unsigned ms = attempt < 5 ? 250u << attempt : 8000;
+    struct timespec ts;
+
+    ts.tv_sec = ms / 1000;
+    ts.tv_nsec = (long)(ms % 1000) * 1000000;
+    nanosleep(&ts, NULL);
+}
+
+/**
+ * Downloads one memory section.  After an error (timeout, CRC), the
+ * logger has to be told the memory range of the flight again before
+ * it sends the section once more.
+ */
+static int download_section_retry(filser_t device,
+                                  const struct filser_flight_index *flight,
+                                  const size_t section_lengths[0x10],
+                                  unsigned section, unsigned char *buffer,
+                                  struct filser_download *download) {
+    size_t lengths[0x10];
+    unsigned attempt;
+
+    for (attempt = 0; attempt <= SECTION_RETRIES; ++attempt) {
+        if (attempt > 0) {
+            download_message(download, 1,
+                             "io error in memory section %u: %s, retrying",
+                             section, strerror(errno));
+            ++download->retries;
+            backoff(attempt - 1);
+
+            if (sync_ack(device) < 0)
+                continue;
+
+            download_message(download, 3, "seeking logger memory");
+            if (seek_mem(device, flight) < 0 ||
+                get_mem_section(device, lengths) < 0)
+                continue;
+
+            if (memcmp(lengths, section_lengths, sizeof(lengths)) != 0) {
+                download_error(download, "the memory sections have changed");
+                errno = EPROTO;
+                return -1;
+            }
+        }
+
+        if (download_section(device, section, buffer,
+                             section_lengths[section]) == 0)
+            return 0;
+    }
+
+    download_error(download, "io error in memory section %u: %s",
+                   section, strerror(errno));
+    return -1;
+}
+
+/**
+ * Makes sure that only one process writes the partial file, e.g. when
+ * one logger is connected twice.
+ */
+static int lock_partial(int fd) {
+    struct flock lock;
+
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+
+    if (fcntl(fd, F_SETLK, &lock) < 0) {
+        if (errno == EACCES || errno == EAGAIN)
+            errno = EBUSY;
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Picks up the partial file of an earlier, interrupted download of
+ * the same flight: the complete sections in it are converted, and a
+ * torn section at the end is discarded.  Returns the number of the
+ * first section which must be downloaded, or -1 on error.
+ */
+static int resume_partial(int fd, const char *path,
+                          const size_t section_lengths[0x10],
+                          struct igc_stream *igc) {
+    struct stat st;
+    off_t offset = 0;
+    int num_sections = 0, i;
+    unsigned char *p;
+
+    if (fstat(fd, &st) < 0 || st.st_size == 0)
+        return 0;
+
+    while (num_sections < 0x10 && section_lengths[num_sections] > 0 &&
+           offset + (off_t)section_lengths[num_sections] <= st.st_size)
+        offset += section_lengths[num_sections++];
+
+    if (ftruncate(fd, offset) < 0 || lseek(fd, 0, SEEK_SET) < 0) {
+        download_error(igc->download, "failed to truncate %s: %s",
+                       path, strerror(errno));
+        return -1;
+    }
+
+    for (i = 0; i < num_sections; ++i) {
+        p = igc_stream_prepare(igc, section_lengths[i]);
+        if (read(fd, p, section_lengths[i]) != (ssize_t)section_lengths[i]) {
+            download_error(igc->download, "failed to read %s: %s",
+                           path, strerror(errno));
+            return -1;
+        }
+
+        igc_stream_feed(igc, section_lengths[i]);
+    }
+
+    return num_sections;
+}
+
+int filser_download_flight(filser_t device,
+                           const struct filser_flight_index *flight,
+                           const char *lxn_path, const char *igc_path,
+                           struct filser_download *download) {
+    int fd, i;
+    size_t section_lengths[0x10];
+    struct igc_stream igc;
+    unsigned char *p;
+    char lxn_part_path[1024];
+
+    download->first_section = 0;
+    download->num_bytes = 0;
+    download->retries = 0;
+    download->error[0] = 0;
+
+    download_message(download, 3, "seeking logger memory");
+    if (seek_mem(device, flight) < 0) {
+        download_error(download, "failed to seek the logger memory: %s",
+                       strerror(errno));
+        return -1;
+    }
+
+    download_message(download, 3, "obtaining logger memory section data");
+    if (get_mem_section(device, section_lengths) < 0) {
+        download_error(download, "failed to read the memory sections: %s",
+                       strerror(errno));
+        return -1;
+    }
+
+    /* the sections are checkpointed in the partial file, which gets
+       its real name when the download is complete */
+    if (make_part_path(lxn_part_path, sizeof(lxn_part_path), lxn_path) < 0) {
+        download_error(download, "path too long: %s", lxn_path);
+        return -1;
+    }
+
+    fd = open(lxn_part_path, O_RDWR|O_CREAT|O_BINARY, 0666);
+    if (fd < 0) {
+        download_error(download, "failed to create %s: %s",
+                       lxn_part_path, strerror(errno));
+        return -1;
+    }
+
+    if (lock_partial(fd) < 0) {
+        download_error(download, "failed to lock %s: %s",
+                       lxn_part_path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    if (igc_stream_open(&igc, igc_path, download) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    i = resume_partial(fd, lxn_part_path, section_lengths, &igc);
+    if (i < 0)
+        goto fail;
+
+    download->first_section = (unsigned)i;
+    if (i > 0)
+        download_message(download, 1,
+                         "resuming download at memory section %d", i);
+
+    for (; i < 0x10; i++) {
+        if (section_lengths[i] == 0)
+            break;
+
+        download_message(download, 3,
+                         "downloading memory section %d from logger, %lu bytes",
+                         i, (unsigned long)section_lengths[i]);
+
+        p = igc_stream_prepare(&igc, section_lengths[i]);
+
+        if (download_section_retry(device, flight, section_lengths,
+                                   (unsigned)i, p, download) < 0)
+            goto fail;
+
+        if (write(fd, p, section_lengths[i]) != (ssize_t)section_lengths[i]) {
+            download_error(download, "failed to write %s: %s",
+                           lxn_part_path, strerror(errno));
+            goto fail;
+        }
+
+        download->num_bytes += section_lengths[i];
+        igc_stream_feed(&igc, section_lengths[i]);
+    }
+
+    close(fd);
+
+    if (rename(lxn_part_path, lxn_path) < 0) {
+        download_error(download, "failed to rename %s: %s",
+                       lxn_part_path, strerror(errno));
+        igc_stream_abort(&igc);
+        return -1;
+    }
+
+    return igc_stream_close(&igc);
+
+ fail:
+    /* the partial LXN file stays for the next attempt */
+    close(fd);
+    igc_stream_abort(&igc);
+    return -1;
+}
@@ -18,14 +18,14 @@
  */
 
 #include <assert.h>
-#include <sys/select.h>
-#include <sys/time.h>
 #include <sys/types.h>
 #include <unistd.h>
+#include <termios.h>
 #include <time.h>
 #include <errno.h>
 
 #include "filser.h"
+#include "serialio.h"
 
 int filser_write_cmd(filser_t device, unsigned char cmd) {
     static const unsigned char prefix = FILSER_PREFIX;
@@ -42,46 +42,85 @@ int filser_write_cmd(filser_t device, unsigned char cmd) {
     return 1;
 }
 
+/** the monotonic clock in microseconds */
+static uint64_t now_us(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int write_drain(filser_t device, const void *p, size_t length) {
+    const uint64_t start = now_us();
+    ssize_t nbytes;
+
+    nbytes = write(device->fd, p, length);
+    if (nbytes < 0)
+        return -1;
+
+    if ((size_t)nbytes != length)
+        return 0;
+
+    /* not a tty (e.g. a pipe in a test): nothing to wait for */
+    if (tcdrain(device->fd) < 0 && errno != ENOTTY && errno != EINVAL)
+        return -1;
+
+    device->write_stats.bytes += length;
+    ++device->write_stats.chunks;
+    device->write_stats.line_time += now_us() - start;
+    return 1;
+}
+
 int filser_write_crc(filser_t device, const void *p0, size_t length) {
     const unsigned char *const p = p0;
-    ssize_t nbytes;
     unsigned char crc;
     size_t pos = 0, sublen;
+    struct timespec ts;
+    int ret;
 
-    while (pos < length) {
-        if (pos > 0) {
-            struct timeval tv;
+    assert(device->write_chunk > 0);
 
-            /* we have to throttle here ... */
-            tv.tv_sec = 0;
-            tv.tv_usec = 10000;
-            select(0, NULL, NULL, NULL, &tv);
+    while (pos < length) {
+        if (pos > 0 && device->write_pause > 0) {
+            /* configured, or grown after the device dropped data */
+            ts.tv_sec = device->write_pause / 1000000;
+            ts.tv_nsec = (long)(device->write_pause % 1000000) * 1000;
+            nanosleep(&ts, NULL);
+            device->write_stats.pause_time += device->write_pause;
         }
 
         sublen = length - pos;
-        if (sublen > 256)
-            sublen = 256;
-
-        nbytes = write(device->fd, p + pos, sublen);
-        if (nbytes < 0)
-            return -1;
+        if (sublen > device->write_chunk)
+            sublen = device->write_chunk;
 
-        if ((size_t)nbytes != sublen)
-            return 0;
+        ret = write_drain(device, p + pos, sublen);
+        if (ret <= 0)
+            return ret;
 
         pos += sublen;
     }
 
     crc = filser_calc_crc(p, length);
 
-    nbytes = write(device->fd, &crc, sizeof(crc));
-    if (nbytes < 0)
-        return -1;
+    return write_drain(device, &crc, sizeof(crc));
+}
 
-    if ((size_t)nbytes != sizeof(crc))
-        return 0;
+void filser_set_write_pacing(filser_t device, size_t chunk, unsigned pause) {
+    if (chunk > 0)
+        device->write_chunk = chunk;
+    device->write_pause = pause;
+}
 
-    return 1;
+void filser_write_backoff(filser_t device) {
+    if (device->write_pause < 2000)
+        device->write_pause = 2000;
+    else if (device->write_pause < 100000)
+        device->write_pause *= 2;
+
+    if (device->write_pause > 100000)
+        device->write_pause = 100000;
+
+    ++device->write_stats.backoffs;
 }
 
 int filser_write_packet(filser_t device, unsigned char cmd,
@@ -102,58 +141,21 @@ int filser_write_packet(filser_t device, unsigned char cmd,
     return 1;
 }
 
-static int filser_select(filser_t device, time_t seconds) {
-    fd_set rfds;
-    struct timeval tv;
-
-    tv.tv_sec = seconds;
-    tv.tv_usec = 0;
-
-    FD_ZERO(&rfds);
-    FD_SET(device->fd, &rfds);
-
-    return select(device->fd + 1, &rfds, NULL, NULL, &tv);
-}
-
-int filser_read(filser_t device, void *p0, size_t length,
-                time_t timeout) {
-    unsigned char *p = p0;
-    ssize_t nbytes;
-    size_t pos = 0;
-    time_t end_time = 0;
-
-    if (timeout > 0)
-        end_time = time(NULL) + timeout;
-
-    for (;;) {
-        nbytes = read(device->fd, p + pos, length - pos);
-        if (nbytes < 0)
-            return -1;
-
-        if (nbytes > 0)
-            end_time = time(NULL) + timeout;
-
-        pos += (size_t)nbytes;
-        if (pos >= length)
-            break;
-
-        if (timeout > 0 && time(NULL) > end_time)
-            return 0;
-    }
-
-    return 1;
+int filser_read(filser_t device, void *p, size_t length,
+                unsigned timeout_ms) {
+    return serialio_read_full(device->fd, p, length, timeout_ms);
 }
 
 int filser_read_crc(filser_t device, void *p0, size_t length,
-                    time_t timeout) {
+                    unsigned timeout_ms) {
     int ret;
     unsigned char crc;
 
-    ret = filser_read(device, p0, length, timeout);
+    ret = filser_read(device, p0, length, timeout_ms);
     if (ret <= 0)
         return ret;
 
-    ret = filser_read(device, &crc, sizeof(crc), timeout);
+    ret = filser_read(device, &crc, sizeof(crc), timeout_ms);
     if (ret <= 0)
         return ret;
 
@@ -164,57 +166,60 @@ int filser_read_crc(filser_t device, void *p0, size_t length,
 }
 
 ssize_t filser_read_most(filser_t device, void *p0, size_t length,
-                         time_t timeout) {
+                         unsigned timeout_ms) {
     unsigned char *buffer = p0;
     int ret;
     ssize_t nbytes;
     size_t pos = 0;
-    time_t end_time = time(NULL) + timeout, timeout2 = 0;
+    const uint64_t end_time = serialio_deadline(timeout_ms);
+    uint64_t silence;
 
     assert(length > 0);
-    assert(timeout > 0);
+    assert(timeout_ms > 0);
 
     for (;;) {
-        ret = filser_select(device, 1);
+        /* the response is complete after one second of silence */
+        silence = serialio_deadline(1000);
+        ret = serialio_poll(device->fd, SERIALIO_SELECT_AVAILABLE,
+                            silence < end_time ? silence : end_time);
         if (ret < 0)
             return -1;
 
-        if (ret == 0)
-            return (ssize_t)pos;
+        if (ret == 0) {
+            if (silence < end_time)
+                return (ssize_t)pos;
+
+            /* the deadline came before the second of silence */
+            errno = ETIMEDOUT;
+            return -1;
+        }
 
         nbytes = read(device->fd, buffer + pos, length - pos);
         if (nbytes < 0)
             return -1;
 
-        if (timeout2 == 0) {
-            if (nbytes == 0)
-                timeout2 = time(NULL) + 1;
-        } else {
-            if (nbytes > 0)
-                timeout2 = 0;
-        }
+        if (nbytes == 0)
+            /* end of file */
+            return (ssize_t)pos;
 
         pos += (size_t)nbytes;
         if (pos >= length)
             return (ssize_t)pos;
 
-        if (timeout2 > 0 && time(NULL) >= timeout2)
-            return pos;
-
-        if (time(NULL) >= end_time) {
-            errno = EINTR;
+        if (serialio_now() >= end_time) {
+            errno = ETIMEDOUT;
             return -1;
         }
     }
 }
 
 ssize_t filser_read_most_crc(filser_t device, void *p0, size_t length,
-                             time_t timeout) {
+                             unsigned timeout_ms) {
     unsigned char *buffer = p0;
     ssize_t nbytes;
     unsigned char crc;
 
-    nbytes = filser_read_most(device, buffer, length, timeout);
+    nbytes = filser_read_most(device, buffer, length, timeout_ms);
     if (nbytes <= 0)
         return nbytes;
 
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 
 #include "filser.h"
+#include "serialio.h"
 
 int filser_fdopen(int fd, filser_t *device_r) {
     filser_t device;
@@ -39,6 +40,7 @@ int filser_fdopen(int fd, filser_t *device_r) {
         return -1;
 
     device->fd = fd;
+    device->write_chunk = 256;
 
     *device_r = device;
     return 0;
@@ -46,38 +48,11 @@ int filser_fdopen(int fd, filser_t *device_r) {
 
 int filser_open(const char *device_path, filser_t *device_r) {
     int fd, ret;
-    struct termios attr;
 
-    fd = open(device_path, O_RDWR | O_NOCTTY);
+    fd = serialio_open_fd(device_path, B19200);
     if (fd < 0)
         return -1;
 
-    ret = tcgetattr(fd, &attr);
-    if (ret < 0) {
-        int save_errno = errno;
-        close(fd);
-        errno = save_errno;
-        return -1;
-    }
-
-    attr.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
-    attr.c_oflag &= ~OPOST;
-    attr.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-    attr.c_cflag &= ~(CSIZE | PARENB | CRTSCTS | IXON | IXOFF);
-    attr.c_cflag |= (CS8 | CLOCAL);
-    attr.c_cc[VMIN] = 0;
-    attr.c_cc[VTIME] = 1;
-    cfsetospeed(&attr, B19200);
-    cfsetispeed(&attr, B19200);
-
-    ret = tcsetattr(fd, TCSANOW, &attr);
-    if (ret < 0) {
-        int save_errno = errno;
-        close(fd);
-        errno = save_errno;
-        return -1;
-    }
-
     ret = filser_fdopen(fd, device_r);
     if (ret != 0)
         close(fd);
@@ -22,6 +22,7 @@
 #include <unistd.h>
 
 #include "filser.h"
+#include "serialio.h"
 
 int filser_send_syn(filser_t device) {
     static const unsigned char syn = FILSER_SYN;
@@ -36,14 +37,18 @@ int filser_send_syn(filser_t device) {
     return 1;
 }
 
+/** a logger answers SYN within a few milliseconds */
+#define FILSER_ACK_TIMEOUT_MS 250
+
 int filser_recv_ack(filser_t device) {
     static const unsigned char ack = FILSER_ACK;
     unsigned char buffer;
-    ssize_t nbytes;
+    int ret;
 
-    nbytes = read(device->fd, &buffer, sizeof(buffer));
-    if (nbytes <= 0)
-        return (int)nbytes;
+    ret = serialio_read_full(device->fd, &buffer, sizeof(buffer),
+                             FILSER_ACK_TIMEOUT_MS);
+    if (ret <= 0)
+        return ret;
 
     return buffer == ack
         ? 1 : 0;
@@ -74,3 +79,24 @@ int filser_send_command(filser_t device, unsigned char cmd) {
 
     return 1;
 }
+
+unsigned filser_negotiate_speed(filser_t device, unsigned max_baud) {
+    static const unsigned speeds[] = { 115200, 57600, 38400, 19200 };
+    const unsigned original = serialio_get_baud(device->fd);
+    unsigned i, tries;
+
+    for (i = 0; i < sizeof(speeds) / sizeof(speeds[0]); ++i) {
+        if (speeds[i] > max_baud ||
+            serialio_set_baud(device->fd, speeds[i]) < 0)
+            continue;
+
+        for (tries = 0; tries < 3; ++tries)
+            if (filser_syn_ack(device) > 0)
+                return speeds[i];
+    }
+
+    if (original > 0)
+        serialio_set_baud(device->fd, original);
+
+    return 0;
+}
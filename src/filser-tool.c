@@ -28,7 +28,6 @@
 #include <string.h>
 #include <errno.h>
 #include <termios.h>
-#include <signal.h>
 #include <time.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
@@ -43,6 +42,11 @@
 struct config {
     int verbose;
     const char *tty;
+
+    /** pacing of uploads: bytes per chunk (0 = default) and pause
+        after each chunk in microseconds */
+    size_t write_chunk;
+    unsigned write_pause;
 };
 
 static void usage(void) {
@@ -56,6 +60,14 @@ static void usage(void) {
          " --tty DEVICE\n"
 #endif
          " -t DEVICE      open this tty device (default /dev/ttyS0)\n"
+#ifdef __GLIBC__
+         " --chunk BYTES\n"
+#endif
+         " -c BYTES       upload in chunks of this size (default 256)\n"
+#ifdef __GLIBC__
+         " --pause MS\n"
+#endif
+         " -p MS          pause after each uploaded chunk (default 0)\n"
          "valid commands:\n"
          "  list\n"
          "        print a list of flights\n"
@@ -72,10 +84,19 @@ static void usage(void) {
          );
 }
 
+static void arg_error(const char *msg) __attribute__ ((noreturn));
+static void arg_error(const char *msg) {
+    fprintf(stderr, "filsertool: %s\n", msg);
+    fprintf(stderr, "Try 'filsertool -h' for more information.\n");
+    _exit(1);
+}
+
 /** read configuration options from the command line */
 static void parse_cmdline(struct config *config,
                           int argc, char **argv) {
     int ret;
+    long n;
+    char *endptr;
 #ifdef __GLIBC__
     static const struct option long_options[] = {
         {"help", 0, 0, 'h'},
@@ -83,6 +104,8 @@ static void parse_cmdline(struct config *config,
         {"verbose", 0, 0, 'v'},
         {"quiet", 1, 0, 'q'},
         {"tty", 1, 0, 't'},
+        {"chunk", 1, 0, 'c'},
+        {"pause", 1, 0, 'p'},
         {0,0,0,0}
     };
 #endif
@@ -94,10 +117,10 @@ static void parse_cmdline(struct config *config,
 #ifdef __GLIBC__
         int option_index = 0;
 
-        ret = getopt_long(argc, argv, "hVvqt:",
+        ret = getopt_long(argc, argv, "hVvqt:c:p:",
                           long_options, &option_index);
 #else
-        ret = getopt(argc, argv, "hVvqt:");
+        ret = getopt(argc, argv, "hVvqt:c:p:");
 #endif
         if (ret == -1)
             break;
@@ -124,31 +147,32 @@ static void parse_cmdline(struct config *config,
             config->tty = optarg;
             break;
 
+        case 'c':
+            n = strtol(optarg, &endptr, 10);
+            if (*endptr != 0 || n <= 0 || n > 0x10000)
+                arg_error("invalid chunk size");
+            config->write_chunk = (size_t)n;
+            break;
+
+        case 'p':
+            n = strtol(optarg, &endptr, 10);
+            if (*endptr != 0 || n < 0 || n > 1000)
+                arg_error("invalid pause");
+            config->write_pause = (unsigned)n * 1000;
+            break;
+
         default:
             exit(1);
         }
     }
 }
 
-static void arg_error(const char *msg) __attribute__ ((noreturn));
-static void arg_error(const char *msg) {
-    fprintf(stderr, "filsertool: %s\n", msg);
-    fprintf(stderr, "Try 'filsertool -h' for more information.\n");
-    _exit(1);
-}
-
-static void alarm_handler(int dummy) {
-    (void)dummy;
-}
-
 static void syn_ack_wait(filser_t device) {
     int ret;
     unsigned tries = 20;
 
     do {
-        alarm(10);
         ret = filser_syn_ack(device);
-        alarm(0);
         if (ret < 0) {
             fprintf(stderr, "failed to connect: %s\n",
                     strerror(errno));
@@ -170,7 +194,7 @@ static void syn_ack_wait(filser_t device) {
 static int read_full_crc(filser_t device, void *buffer, size_t len) {
     int ret;
 
-    ret = filser_read_crc(device, buffer, len, 40);
+    ret = filser_read_crc(device, buffer, len, 40000);
     if (ret == -2) {
         fprintf(stderr, "CRC error\n");
         exit(1);
@@ -182,7 +206,7 @@ static int read_full_crc(filser_t device, void *buffer, size_t len) {
 static ssize_t read_timeout_crc(filser_t device, unsigned char *buffer, size_t len) {
     ssize_t nbytes;
 
-    nbytes = filser_read_most_crc(device, buffer, len, 10);
+    nbytes = filser_read_most_crc(device, buffer, len, 10000);
     if (nbytes == -2) {
         fprintf(stderr, "CRC error\n");
         _exit(1);
@@ -210,36 +234,70 @@ static int communicate(filser_t device, unsigned char cmd,
     return 1;
 }
 
+/** how often an upload is sent again after the device has rejected
+    it */
+#define SEND_RETRIES 4
+
 static int filser_send(filser_t device, unsigned char cmd,
                        const void *buffer, size_t buffer_len,
-                       int timeout) {
+                       unsigned timeout_ms) {
     unsigned char response;
+    unsigned attempt;
     int ret;
 
-    syn_ack_wait(device);
+    for (attempt = 0;; ++attempt) {
+        syn_ack_wait(device);
 
-    tcflush(device->fd, TCIOFLUSH);
+        tcflush(device->fd, TCIOFLUSH);
 
-    ret = filser_write_packet(device, cmd,
-                              buffer, buffer_len);
-    if (ret <= 0)
-        return -1;
+        ret = filser_write_packet(device, cmd,
+                                  buffer, buffer_len);
+        if (ret <= 0)
+            return -1;
 
-    ret = filser_read(device, &response, sizeof(response), timeout);
-    if (ret < 0)
-        return -1;
+        ret = filser_read(device, &response, sizeof(response), timeout_ms);
+        if (ret < 0)
+            return -1;
 
-    if (ret == 0) {
-        fprintf(stderr, "no response\n");
-        _exit(1);
-    }
+        if (ret > 0 && response == FILSER_ACK)
+            return 1;
 
-    if (response != FILSER_ACK) {
-        fprintf(stderr, "no ACK\n");
-        _exit(1);
+        if (attempt >= SEND_RETRIES) {
+            fprintf(stderr, ret == 0 ? "no response\n" : "no ACK\n");
+            _exit(1);
+        }
+
+        /* the device has probably lost some of the data: slow down,
+           and send it again */
+        filser_write_backoff(device);
+        fprintf(stderr, "%s, retrying with %u ms pause\n",
+                ret == 0 ? "no response" : "no ACK",
+                device->write_pause / 1000);
     }
+}
 
-    return 1;
+static void set_write_pacing(const struct config *config, filser_t device) {
+    filser_set_write_pacing(device, config->write_chunk,
+                            config->write_pause);
+}
+
+static void print_write_stats(const struct config *config,
+                              filser_t device) {
+    const struct filser_write_stats *stats = &device->write_stats;
+    const uint64_t total = stats->line_time + stats->pause_time;
+
+    if (config->verbose < 1 || total == 0)
+        return;
+
+    fprintf(stderr, "wrote %llu bytes in %llu chunks, %.2f s"
+            " (%.2f s on the line, %.2f s pausing), %llu bytes/s,"
+            " %llu back-offs\n",
+            (unsigned long long)stats->bytes,
+            (unsigned long long)stats->chunks,
+            (double)total / 1e6, (double)stats->line_time / 1e6,
+            (double)stats->pause_time / 1e6,
+            (unsigned long long)(stats->bytes * 1000000 / total),
+            (unsigned long long)stats->backoffs);
 }
 
 static int check_mem_settings(filser_t device) {
@@ -280,7 +338,7 @@ static int raw(struct config *config, int argc, char **argv) {
 
     check_mem_settings(device);
 
-    nbytes1 = filser_read_most(0, buffer, sizeof(buffer), 10);
+    nbytes1 = filser_read_most(0, buffer, sizeof(buffer), 10000);
     if (nbytes1 < 0) {
         fprintf(stderr, "failed to read from stdin: %s\n",
                 strerror(errno));
@@ -294,7 +352,7 @@ static int raw(struct config *config, int argc, char **argv) {
         _exit(1);
     }
 
-    nbytes1 = filser_read_most(device, buffer, sizeof(buffer), 10);
+    nbytes1 = filser_read_most(device, buffer, sizeof(buffer), 10000);
     if (nbytes1 < 0) {
         fprintf(stderr, "failed to read from '%s': %s\n",
                 config->tty, strerror(errno));
@@ -409,7 +467,7 @@ static int get_basic_data(struct config *config, int argc, char **argv) {
 
     filser_send_command(device, FILSER_READ_BASIC_DATA);
 
-    nbytes = filser_read_most(device, buffer, sizeof(buffer), 10);
+    nbytes = filser_read_most(device, buffer, sizeof(buffer), 10000);
     if (nbytes < 0) {
         fprintf(stderr, "failed to read from '%s': %s\n",
                 config->tty, strerror(errno));
@@ -481,9 +539,7 @@ static int seek_mem_x(filser_t device, unsigned start_address, unsigned end_addr
     if (ret <= 0)
         return -1;
 
-    alarm(40);
-    ret = filser_read(device, &response, sizeof(response), 40);
-    alarm(0);
+    ret = filser_read(device, &response, sizeof(response), 40000);
     if (ret < 0)
         return -1;
 
@@ -524,9 +580,7 @@ static int seek_mem(filser_t device, const struct filser_flight_index *flight) {
     if (ret <= 0)
         return -1;
 
-    alarm(40);
-    ret = filser_read(device, &response, sizeof(response), 40);
-    alarm(0);
+    ret = filser_read(device, &response, sizeof(response), 40000);
     if (ret < 0)
         return -1;
 
@@ -869,14 +923,18 @@ static int cmd_write_tp_tsk(struct config *config, int argc, char **argv) {
         _exit(1);
     }
 
+    set_write_pacing(config, device);
+
     ret = filser_send(device, FILSER_WRITE_TP_TSK,
                       (const unsigned char*)&tp_tsk, sizeof(tp_tsk),
-                      15);
+                      15000);
     if (ret <= 0) {
         fprintf(stderr, "io error: %s\n", strerror(errno));
         return 1;
     }
 
+    print_write_stats(config, device);
+
     filser_close(&device);
 
     return 0;
@@ -903,6 +961,8 @@ static int cmd_write_apt(struct config *config, int argc, char **argv) {
         _exit(1);
     }
 
+    set_write_pacing(config, device);
+
     data_path = argv[optind];
     dir = datadir_open(data_path);
     if (dir == NULL) {
@@ -920,7 +980,7 @@ static int cmd_write_apt(struct config *config, int argc, char **argv) {
         filename[4] = '0' + i;
         data = datadir_read(dir, filename, 0x8000);
         ret = filser_send(device, FILSER_APT_1 + i,
-                          data, 0x8000, 10);
+                          data, 0x8000, 10000);
         if (ret <= 0) {
             fprintf(stderr, "io error: %s\n", strerror(errno));
             return 1;
@@ -933,7 +993,7 @@ static int cmd_write_apt(struct config *config, int argc, char **argv) {
 
     data = datadir_read(dir, "apt_state", 0xa07);
     ret = filser_send(device, FILSER_APT_STATE,
-                      data, 0xa07, 10);
+                      data, 0xa07, 10000);
     if (ret <= 0) {
         fprintf(stderr, "io error: %s\n", strerror(errno));
         return 1;
@@ -941,6 +1001,8 @@ static int cmd_write_apt(struct config *config, int argc, char **argv) {
 
     free(data);
 
+    print_write_stats(config, device);
+
     datadir_close(dir);
     filser_close(&device);
 
@@ -951,8 +1013,6 @@ int main(int argc, char **argv) {
     struct config config;
     const char *cmd;
 
-    signal(SIGALRM, alarm_handler);
-
     parse_cmdline(&config, argc, argv);
 
     if (optind >= argc)
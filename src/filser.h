@@ -153,6 +153,7 @@ struct filser_packet_mem_section {
 enum filser_command {
     FILSER_PREFIX = 0x02,
     FILSER_ACK = 0x06,
+    FILSER_NAK = 0x15,
     FILSER_SYN = 0x16,
     FILSER_READ_LO4 = 0x30,
     FILSER_ERASE_LO4 = 0x4c,
@@ -178,8 +179,29 @@ enum filser_command {
     FILSER_READ_LOGGER_DATA = 0xe6
 };
 
+/** timing of filser_write_crc(), all times in microseconds */
+struct filser_write_stats {
+    uint64_t bytes, chunks, backoffs;
+
+    /** time spent in write() and tcdrain(), i.e. on the line */
+    uint64_t line_time;
+
+    /** time spent in the back-off pause */
+    uint64_t pause_time;
+};
+
 struct filser {
     int fd;
+
+    /** filser_write_crc() writes at most this many bytes at a time,
+        and waits until they have been transmitted */
+    size_t write_chunk;
+
+    /** an additional pause after each chunk in microseconds; it
+        grows with every filser_write_backoff() */
+    unsigned write_pause;
+
+    struct filser_write_stats write_stats;
 };
 
 typedef struct filser *filser_t;
@@ -193,6 +215,12 @@ extern "C" {
 
 unsigned char filser_calc_crc(const void *p0, size_t len);
 
+/**
+ * The same as filser_calc_crc(), bit by bit.  This is the reference
+ * for the test suite.
+ */
+unsigned char filser_calc_crc_bitwise(const void *p0, size_t len);
+
 /* filser-open.c */
 
 int filser_fdopen(int fd, filser_t *device_r);
@@ -205,22 +233,50 @@ void filser_close(filser_t *device_r);
 
 int filser_write_cmd(filser_t device, unsigned char cmd);
 
+/**
+ * Writes the buffer and its CRC.  The data is sent in chunks of
+ * device->write_chunk bytes, and each chunk is drained with
+ * tcdrain(), so the pace follows the line speed.
+ */
 int filser_write_crc(filser_t device, const void *p, size_t length);
 
+/** sets the chunk size (0 = unchanged) and the pause after each
+    chunk in microseconds */
+void filser_set_write_pacing(filser_t device, size_t chunk, unsigned pause);
+
+/**
+ * Call this when the device has dropped written data (it answered
+ * with NAK, or not at all): the pause after each chunk is doubled,
+ * starting with 2 ms, up to 100 ms.
+ */
+void filser_write_backoff(filser_t device);
+
 int filser_write_packet(filser_t device, unsigned char cmd,
                         const void *packet, size_t length);
 
+/**
+ * Reads exactly length bytes.  The operation fails if the device is
+ * silent for timeout_ms milliseconds (0 = wait forever).  Returns 1
+ * on success, 0 on timeout, -1 on error.
+ */
 int filser_read(filser_t device, void *p0, size_t length,
-                time_t timeout);
+                unsigned timeout_ms);
 
+/** like filser_read(), and checks the CRC byte which follows the
+    data (returns -2 on mismatch) */
 int filser_read_crc(filser_t device, void *p, size_t length,
-                    time_t timeout);
+                    unsigned timeout_ms);
 
+/**
+ * Reads a response of unknown length: it is complete after one
+ * second of silence.  Fails with ETIMEDOUT if that second has not
+ * passed within timeout_ms milliseconds.
+ */
 ssize_t filser_read_most(filser_t device, void *p0, size_t length,
-                         time_t timeout);
+                         unsigned timeout_ms);
 
 ssize_t filser_read_most_crc(filser_t device, void *buffer, size_t length,
-                             time_t timeout);
+                             unsigned timeout_ms);
 
 /* filser-proto.c */
 
@@ -232,6 +288,56 @@ int filser_syn_ack(filser_t device);
 
 int filser_send_command(filser_t device, unsigned char cmd);
 
+/**
+ * Finds the highest line speed (115200 baud or less, but not more
+ * than max_baud) at which the logger answers SYN with ACK, and
+ * leaves the port at that speed.  LX loggers don't switch speeds on
+ * request, they listen at the speed configured in their setup, so
+ * this probes from the top down.  Returns the speed in baud, or 0 if
+ * the logger did not answer at all; in that case, the port gets its
+ * old speed back.
+ */
+unsigned filser_negotiate_speed(filser_t device, unsigned max_baud);
+
+/* filser-download.c */
+
+/** the progress and the result of filser_download_flight() */
+struct filser_download {
+    /**
+     * Called with progress messages (may be NULL): level 1 for
+     * retries and resumed downloads, level 3 for every step.
+     */
+    void (*message)(void *ctx, int level, const char *text);
+    void *ctx;
+
+    /** the sections before this one were taken from the partial file
+        of an earlier attempt */
+    unsigned first_section;
+
+    /** the number of bytes received from the logger */
+    unsigned long num_bytes;
+
+    unsigned retries;
+
+    /** describes the error after a failure */
+    char error[256];
+};
+
+/**
+ * Downloads a flight to lxn_path, and converts it to igc_path while
+ * the data arrives.  Call it right after a successful SYN/ACK.  A
+ * memory section which fails is requested again up to 5 times, with
+ * growing pauses.  Both files are written with the suffix ".part" and
+ * renamed when they are complete.  After an error, the partial LXN
+ * file stays, and the next call resumes at its first incomplete
+ * section.  Returns 0 on success, or -1 with errno and
+ * download->error set.
+ */
+int filser_download_flight(filser_t device,
+                           const struct filser_flight_index *flight,
+                           const char *lxn_path, const char *igc_path,
+                           struct filser_download *download);
+
 /* filser-filename.c */
 
 void filser_flight_filename(char *filename,
@@ -0,0 +1,153 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2007 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "flarm-internal.h"
+#include "serialio.h"
+
+#include <errno.h>
+
+static const struct {
+    unsigned baud;
+    int code;
+} flarm_speeds[] = {
+    { 57600, FLARM_BAUD_57600 },
+    { 38400, FLARM_BAUD_38400 },
+    { 19200, FLARM_BAUD_19200 },
+    { 9600, FLARM_BAUD_9600 },
+    { 4800, FLARM_BAUD_4800 },
+};
+
+#define NUM_FLARM_SPEEDS (sizeof(flarm_speeds) / sizeof(flarm_speeds[0]))
+
+static flarm_result_t
+flarm_wait_reply(flarm_t flarm, unsigned timeout_ms)
+{
+    const void *payload;
+    size_t length;
+
+    return flarm_recv_reply(flarm, timeout_ms, &payload, &length);
+}
+
+/** forget everything received at the old line speed */
+static void
+flarm_discard_input(flarm_t flarm)
+{
+    fifo_buffer_clear(flarm->in);
+    fifo_buffer_clear(flarm->frame);
+    flarm->frame_started = 0;
+}
+
+static flarm_result_t
+flarm_ping_ack(flarm_t flarm)
+{
+    flarm_result_t ret;
+
+    ret = flarm_send_ping(flarm);
+    if (ret != FLARM_RESULT_SUCCESS)
+        return ret;
+
+    return flarm_wait_reply(flarm, 1000);
+}
+
+static int
+flarm_speed_code(unsigned baud)
+{
+    unsigned i;
+
+    for (i = 0; i < NUM_FLARM_SPEEDS; ++i)
+        if (flarm_speeds[i].baud == baud)
+            return flarm_speeds[i].code;
+
+    return -1;
+}
+
+/**
+ * Switches the host port to the new speed, and checks if the Flarm
+ * is still there.
+ */
+static flarm_result_t
+flarm_follow(flarm_t flarm, unsigned baud)
+{
+    if (serialio_set_baud(flarm->fd, baud) < 0)
+        return errno;
+
+    flarm_discard_input(flarm);
+
+    return flarm_ping_ack(flarm);
+}
+
+flarm_result_t
+flarm_set_speed(flarm_t flarm, unsigned baud)
+{
+    const int code = flarm_speed_code(baud);
+    flarm_result_t ret;
+
+    if (code < 0)
+        return EINVAL;
+
+    if (serialio_get_baud(flarm->fd) == baud)
+        return FLARM_RESULT_SUCCESS;
+
+    /* the Flarm acknowledges at the old speed, and switches after
+       that */
+    ret = flarm_send_set_baud_rate(flarm, code);
+    if (ret != FLARM_RESULT_SUCCESS)
+        return ret;
+
+    ret = flarm_wait_reply(flarm, 1000);
+    if (ret != FLARM_RESULT_SUCCESS)
+        return ret;
+
+    return flarm_follow(flarm, baud);
+}
+
+flarm_result_t
+flarm_negotiate_speed(flarm_t flarm, unsigned max_baud, unsigned *baud_r)
+{
+    const unsigned original = serialio_get_baud(flarm->fd);
+    const int original_code = flarm_speed_code(original);
+    flarm_result_t ret;
+    unsigned i;
+
+    for (i = 0; i < NUM_FLARM_SPEEDS && flarm_speeds[i].baud > original;
+         ++i) {
+        if (flarm_speeds[i].baud > max_baud)
+            continue;
+
+        ret = flarm_set_speed(flarm, flarm_speeds[i].baud);
+        if (ret == FLARM_RESULT_SUCCESS) {
+            *baud_r = flarm_speeds[i].baud;
+            return FLARM_RESULT_SUCCESS;
+        }
+
+        if (serialio_get_baud(flarm->fd) != original) {
+            /* the Flarm has acknowledged the new speed, but does not
+               answer at it: tell it blindly to go back */
+            if (original_code >= 0)
+                flarm_send_set_baud_rate(flarm, original_code);
+
+            ret = flarm_follow(flarm, original);
+            if (ret != FLARM_RESULT_SUCCESS)
+                return ret;
+        }
+    }
+
+    *baud_r = original;
+    return FLARM_RESULT_SUCCESS;
+}
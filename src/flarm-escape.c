@@ -66,18 +66,18 @@ flarm_unescape(void *dest0,
                 return EAGAIN;
             }
 
-            switch (src[src_pos]) {
+            switch (src[src_pos++]) {
             case FLARM_ESC_START:
                 dest[dest_pos++] = FLARM_STARTFRAME;
                 break;
 
             case FLARM_ESC_ESC:
-                dest[dest_pos++] = FLARM_STARTFRAME;
+                dest[dest_pos++] = FLARM_ESCAPE;
                 break;
 
             default:
                 *dest_pos_r = dest_pos;
-                *src_pos_r = src_pos;
+                *src_pos_r = src_pos - 1;
                 return EINVAL;
             }
 
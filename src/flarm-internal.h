@@ -61,6 +61,12 @@ uint16_t flarm_crc_update(uint16_t crc, uint8_t data);
 uint16_t flarm_crc_update_block(uint16_t crc, const void *src,
                                 size_t length);
 
+/**
+ * The sample code from the specification, bit by bit.  This is the
+ * reference for the test suite.
+ */
+uint16_t flarm_crc_update_bitwise(uint16_t crc, uint8_t data);
+
 /* flarm-escape.c */
 
 size_t flarm_escape(uint8_t *dest, const void *src, size_t length);
@@ -28,6 +28,7 @@
 
 #include "flarm.h"
 #include "flarm-internal.h"
+#include "serialio.h"
 
 flarm_result_t
 flarm_fdopen(int fd, flarm_t *flarm_r) {
@@ -63,36 +64,11 @@ flarm_fdopen(int fd, flarm_t *flarm_r) {
 
 int flarm_open(const char *device_path, flarm_t *flarm_r) {
     int fd, ret;
-    struct termios attr;
 
-    fd = open(device_path, O_RDWR | O_NOCTTY);
+    fd = serialio_open_fd(device_path, B4800);
     if (fd < 0)
         return errno;
 
-    ret = tcgetattr(fd, &attr);
-    if (ret < 0) {
-        int save_errno = errno;
-        close(fd);
-        return save_errno;
-    }
-
-    attr.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
-    attr.c_oflag &= ~OPOST;
-    attr.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-    attr.c_cflag &= ~(CSIZE | PARENB | CRTSCTS | IXON | IXOFF);
-    attr.c_cflag |= (CS8 | CLOCAL);
-    attr.c_cc[VMIN] = 0;
-    attr.c_cc[VTIME] = 1;
-    cfsetospeed(&attr, B4800);
-    cfsetispeed(&attr, B4800);
-
-    ret = tcsetattr(fd, TCSANOW, &attr);
-    if (ret < 0) {
-        int save_errno = errno;
-        close(fd);
-        return save_errno;
-    }
-
     ret = flarm_fdopen(fd, flarm_r);
     if (ret != FLARM_RESULT_SUCCESS)
         close(fd);
@@ -18,6 +18,7 @@
  */
 
 #include "flarm-internal.h"
+#include "serialio.h"
 
 #include <assert.h>
 #include <unistd.h>
@@ -25,11 +26,12 @@
 #include <errno.h>
 
 static flarm_result_t
-flarm_fill_in(flarm_t flarm)
+flarm_fill_in(flarm_t flarm, uint64_t deadline)
 {
     void *p;
     size_t max_length;
     ssize_t nbytes;
+    int ret;
 
     p = fifo_buffer_write(flarm->in, &max_length);
     if (p == NULL)
@@ -37,16 +39,30 @@ flarm_fill_in(flarm_t flarm)
 
     assert(max_length > 0);
 
+    /* if nothing arrives until the deadline, the caller gets
+       EAGAIN */
+    ret = serialio_poll(flarm->fd, SERIALIO_SELECT_AVAILABLE, deadline);
+    if (ret < 0)
+        return errno;
+    if (ret == 0)
+        return FLARM_RESULT_SUCCESS;
+
     nbytes = read(flarm->fd, p, max_length);
     if (nbytes < 0)
         return errno;
 
+    if (nbytes == 0)
+        /* end of file: the port was hung up, no more data will
+           arrive */
+        return ECONNRESET;
+
     fifo_buffer_append(flarm->in, (size_t)nbytes);
     return FLARM_RESULT_SUCCESS;
 }
 
 static flarm_result_t
-flarm_read(flarm_t flarm, const uint8_t **p_r, size_t *length_r)
+flarm_read(flarm_t flarm, uint64_t deadline,
+           const uint8_t **p_r, size_t *length_r)
 {
     flarm_result_t ret;
 
@@ -54,7 +70,7 @@ flarm_read(flarm_t flarm, const uint8_t **p_r, size_t *length_r)
     if (*p_r != NULL)
         return FLARM_RESULT_SUCCESS;
 
-    ret = flarm_fill_in(flarm);
+    ret = flarm_fill_in(flarm, deadline);
     if (ret != FLARM_RESULT_SUCCESS)
         return ret;
 
@@ -66,13 +82,13 @@ flarm_read(flarm_t flarm, const uint8_t **p_r, size_t *length_r)
 }
 
 static flarm_result_t
-flarm_wait_startframe(flarm_t flarm) {
+flarm_wait_startframe(flarm_t flarm, uint64_t deadline) {
     flarm_result_t ret;
     const uint8_t *src, *startframe;
     size_t length;
 
     for (;;) {
-        ret = flarm_read(flarm, &src, &length);
+        ret = flarm_read(flarm, deadline, &src, &length);
         if (ret != FLARM_RESULT_SUCCESS)
             return ret;
 
@@ -87,13 +103,13 @@ flarm_wait_startframe(flarm_t flarm) {
 }
 
 static flarm_result_t
-flarm_recv_unescape(flarm_t flarm) {
+flarm_recv_unescape(flarm_t flarm, uint64_t deadline) {
     const uint8_t *src;
     uint8_t *dest;
     flarm_result_t ret;
     size_t in_length, max_length, src_pos, dest_pos;
 
-    ret = flarm_read(flarm, &src, &in_length);
+    ret = flarm_read(flarm, deadline, &src, &in_length);
     if (ret != FLARM_RESULT_SUCCESS)
         return ret;
 
@@ -118,11 +134,11 @@ flarm_recv_unescape(flarm_t flarm) {
     return ret;
 }
 
-flarm_result_t
-flarm_recv_frame(flarm_t flarm,
-                 uint8_t *version_r, uint8_t *type_r,
-                 uint16_t *seq_no_r,
-                 const void **payload_r, size_t *length_r) {
+static flarm_result_t
+flarm_recv_frame_until(flarm_t flarm, uint64_t deadline,
+                       uint8_t *version_r, uint8_t *type_r,
+                       uint16_t *seq_no_r,
+                       const void **payload_r, size_t *length_r) {
     flarm_result_t ret;
     const struct flarm_frame_header *header;
     size_t length;
@@ -139,27 +155,32 @@ flarm_recv_frame(flarm_t flarm,
     if (!flarm->frame_started) {
         fifo_buffer_clear(flarm->frame);
 
-        ret = flarm_wait_startframe(flarm);
+        ret = flarm_wait_startframe(flarm, deadline);
         if (ret != FLARM_RESULT_SUCCESS)
             return ret;
 
         flarm->frame_started = 1;
     }
 
-    ret = flarm_recv_unescape(flarm);
+    ret = flarm_recv_unescape(flarm, deadline);
     if (ret == ENOSPC)
         flarm->frame_started = 0;
     if (ret != FLARM_RESULT_SUCCESS && ret != ECONNRESET)
         return ret;
 
+    /* header->length is the length of the whole frame, including
+       the header */
     header = (const struct flarm_frame_header*)fifo_buffer_read(flarm->frame, &length);
     if (header == NULL || length < sizeof(*header) ||
-        length < sizeof(*header) + header->length) {
+        header->length < sizeof(*header) || length < header->length) {
         if (ret == ECONNRESET)
             flarm->frame_started = 0;
         return EAGAIN;
     }
 
+    /* the next call waits for a new frame */
+    flarm->frame_started = 0;
+
     if (version_r != NULL)
         *version_r = header->version;
 
@@ -169,7 +190,7 @@ flarm_recv_frame(flarm_t flarm,
         *seq_no_r = header->seq_no;
 
     *payload_r = header + 1;
-    *length_r = header->length;
+    *length_r = header->length - sizeof(*header);
 
     if (header->type == FLARM_MESSAGE_ACK)
         return FLARM_RESULT_SUCCESS;
@@ -178,3 +199,59 @@ flarm_recv_frame(flarm_t flarm,
     else
         return FLARM_RESULT_NOT_ACK;
 }
+
+flarm_result_t
+flarm_recv_frame(flarm_t flarm,
+                 uint8_t *version_r, uint8_t *type_r,
+                 uint16_t *seq_no_r,
+                 const void **payload_r, size_t *length_r) {
+    return flarm_recv_frame_until(flarm, serialio_deadline(100),
+                                  version_r, type_r, seq_no_r,
+                                  payload_r, length_r);
+}
+
+flarm_result_t
+flarm_recv_frame_timeout(flarm_t flarm, unsigned timeout_ms,
+                         uint8_t *version_r, uint8_t *type_r,
+                         uint16_t *seq_no_r,
+                         const void **payload_r, size_t *length_r) {
+    const uint64_t deadline = serialio_deadline(timeout_ms);
+    flarm_result_t ret;
+
+    do {
+        ret = flarm_recv_frame_until(flarm, deadline,
+                                     version_r, type_r, seq_no_r,
+                                     payload_r, length_r);
+    } while (ret == EAGAIN && serialio_now() < deadline);
+
+    return ret;
+}
+
+flarm_result_t
+flarm_recv_reply(flarm_t flarm, unsigned timeout_ms,
+                 const void **payload_r, size_t *length_r) {
+    const unsigned expected_seq_no = flarm_last_seq_no(flarm);
+    const uint64_t deadline = serialio_deadline(timeout_ms);
+    flarm_result_t ret;
+    uint8_t type;
+    uint16_t seq_no;
+
+    do {
+        ret = flarm_recv_frame_until(flarm, deadline, NULL, &type, &seq_no,
+                                     payload_r, length_r);
+        if (ret == EAGAIN)
+            continue;
+
+        if (ret != FLARM_RESULT_SUCCESS &&
+            ret != FLARM_RESULT_NACK &&
+            ret != FLARM_RESULT_NOT_ACK)
+            return ret;
+
+        if (seq_no == expected_seq_no)
+            return ret;
+
+        /* otherwise a late reply to an earlier frame: skip it */
+    } while (serialio_now() < deadline);
+
+    return EAGAIN;
+}
@@ -26,7 +26,6 @@
 #include <string.h>
 #include <errno.h>
 #include <termios.h>
-#include <time.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
 #ifdef __GLIBC__
@@ -35,11 +34,13 @@
 
 #include "version.h"
 #include "flarm.h"
+#include "serialio.h"
 #include "datadir.h"
 
 struct config {
     int verbose;
     const char *tty;
+    int fast;
 };
 
 static void usage(void) {
@@ -53,6 +54,10 @@ static void usage(void) {
          " --tty DEVICE\n"
 #endif
          " -t DEVICE      open this tty device (default /dev/ttyS0)\n"
+#ifdef __GLIBC__
+         " --fast\n"
+#endif
+         " -f             switch to the highest line speed the Flarm supports\n"
          "valid commands:\n"
          "  ping\n"
          "        perform a connection test\n"
@@ -74,6 +79,7 @@ static void parse_cmdline(struct config *config,
         {"verbose", 0, 0, 'v'},
         {"quiet", 1, 0, 'q'},
         {"tty", 1, 0, 't'},
+        {"fast", 0, 0, 'f'},
         {0,0,0,0}
     };
 #endif
@@ -85,10 +91,10 @@ static void parse_cmdline(struct config *config,
 #ifdef __GLIBC__
         int option_index = 0;
 
-        ret = getopt_long(argc, argv, "hVvqt:",
+        ret = getopt_long(argc, argv, "hVvqt:f",
                           long_options, &option_index);
 #else
-        ret = getopt(argc, argv, "hVvqt:");
+        ret = getopt(argc, argv, "hVvqt:f");
 #endif
         if (ret == -1)
             break;
@@ -115,6 +121,10 @@ static void parse_cmdline(struct config *config,
             config->tty = optarg;
             break;
 
+        case 'f':
+            config->fast = 1;
+            break;
+
         default:
             exit(1);
         }
@@ -135,30 +145,13 @@ flarm_wait_recv_frame(flarm_t flarm,
                       const void **payload_r, size_t *length_r)
 {
     flarm_result_t ret;
-    int n = 0;
-    struct timespec ts = {
-        .tv_sec = 0,
-        .tv_nsec = 100000,
-    };
 
-    for (n = 0; n < 15; ++n) {
-        ret = flarm_recv_frame(flarm, version_r, type_r, seq_no_r,
-                               payload_r, length_r);
-        if (ret != EAGAIN)
-            return ret;
-
-        if (n == 5)
-            ts.tv_sec = 1;
-        else if (n > 5)
-            fprintf(stderr, "waiting for flarm\n");
-
-        nanosleep(&ts, NULL);
-    }
-
-    if (n > 6)
+    ret = flarm_recv_frame_timeout(flarm, 10000, version_r, type_r, seq_no_r,
+                                   payload_r, length_r);
+    if (ret == EAGAIN)
         fprintf(stderr, "giving up\n");
 
-    return EAGAIN;
+    return ret;
 }
 
 static flarm_result_t
@@ -212,9 +205,10 @@ flarm_ping_wait(flarm_t flarm)
 }
 
 static void
-flarm_tool_binary_mode(flarm_t flarm)
+flarm_tool_binary_mode(const struct config *config, flarm_t flarm)
 {
     flarm_result_t result;
+    unsigned baud;
 
     result = flarm_enter_binary_mode(flarm);
     if (result != FLARM_RESULT_SUCCESS &&
@@ -225,19 +219,30 @@ flarm_tool_binary_mode(flarm_t flarm)
     }
 
     flarm_ping_wait(flarm);
+
+    if (config->fast) {
+        result = flarm_negotiate_speed(flarm, 57600, &baud);
+        if (result != FLARM_RESULT_SUCCESS) {
+            fprintf(stderr, "lost the flarm while changing speed: %s\n",
+                    flarm_strerror(result));
+            exit(2);
+        }
+
+        if (config->verbose > 0)
+            fprintf(stderr, "talking to the flarm at %u baud\n", baud);
+    }
 }
 
 static void
 cmd_ping(const struct config *config, flarm_t flarm,
          int argc, char **argv)
 {
-    (void)config;
     (void)argv;
 
     if (optind < argc)
         arg_error("Too many arguments");
 
-    flarm_tool_binary_mode(flarm);
+    flarm_tool_binary_mode(config, flarm);
 }
 
 static void
@@ -249,13 +254,12 @@ cmd_list(const struct config *config, flarm_t flarm,
     const char *payload;
     size_t length;
 
-    (void)config;
     (void)argv;
 
     if (optind < argc)
         arg_error("Too many arguments");
 
-    flarm_tool_binary_mode(flarm);
+    flarm_tool_binary_mode(config, flarm);
 
     for (i = 0;; ++i) {
         ret = flarm_send_select_record(flarm, i);
@@ -310,7 +314,6 @@ cmd_download(const struct config *config, flarm_t flarm,
     size_t length;
     int is_eof = 0;
 
-    (void)config;
     (void)argv;
 
     if (optind == argc)
@@ -321,7 +324,7 @@ cmd_download(const struct config *config, flarm_t flarm,
     if (optind < argc)
         arg_error("Too many arguments");
 
-    flarm_tool_binary_mode(flarm);
+    flarm_tool_binary_mode(config, flarm);
 
     ret = flarm_send_select_record(flarm, record_no);
     if (ret != FLARM_RESULT_SUCCESS) {
@@ -375,6 +378,7 @@ int main(int argc, char **argv) {
     const char *cmd;
     flarm_result_t ret;
     flarm_t flarm;
+    unsigned original_baud;
 
     parse_cmdline(&config, argc, argv);
 
@@ -390,6 +394,8 @@ int main(int argc, char **argv) {
         exit(2);
     }
 
+    original_baud = serialio_get_baud(flarm_fileno(flarm));
+
     if (strcmp(cmd, "ping") == 0) {
         cmd_ping(&config, flarm, argc, argv);
     } else if (strcmp(cmd, "list") == 0) {
@@ -400,6 +406,9 @@ int main(int argc, char **argv) {
         arg_error("unknown command");
     }
 
+    if (config.fast)
+        flarm_set_speed(flarm, original_baud);
+
     flarm_exit_binary_mode(flarm);
     flarm_close(&flarm);
 }
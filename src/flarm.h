@@ -107,12 +107,36 @@ flarm_send_get_igc_data(flarm_t flarm);
 
 /* flarm-recv.c */
 
+/**
+ * Receives the next frame.  Waits up to 100 ms for data; returns
+ * EAGAIN if the frame is not complete yet.
+ */
 flarm_result_t
 flarm_recv_frame(flarm_t flarm,
                  uint8_t *version_r, uint8_t *type_r,
                  uint16_t *seq_no_r,
                  const void **payload_r, size_t *length_r);
 
+/**
+ * Like flarm_recv_frame(), but waits up to timeout_ms milliseconds
+ * for a complete frame.  Returns EAGAIN on timeout.
+ */
+flarm_result_t
+flarm_recv_frame_timeout(flarm_t flarm, unsigned timeout_ms,
+                         uint8_t *version_r, uint8_t *type_r,
+                         uint16_t *seq_no_r,
+                         const void **payload_r, size_t *length_r);
+
+/**
+ * Waits up to timeout_ms milliseconds for the reply to the last frame
+ * which was sent, skipping other frames.  Returns
+ * FLARM_RESULT_SUCCESS for ACK, FLARM_RESULT_NACK, or EAGAIN on
+ * timeout.
+ */
+flarm_result_t
+flarm_recv_reply(flarm_t flarm, unsigned timeout_ms,
+                 const void **payload_r, size_t *length_r);
+
 
 /* flarm-mode.c */
 
@@ -123,6 +147,26 @@ flarm_result_t
 flarm_exit_binary_mode(flarm_t flarm);
 
 
+/* flarm-baud.c */
+
+/**
+ * Asks the Flarm to switch to another line speed (in baud), follows
+ * with the host port, and checks with a ping that the Flarm answers
+ * at the new speed.
+ */
+flarm_result_t
+flarm_set_speed(flarm_t flarm, unsigned baud);
+
+/**
+ * Switches to the highest line speed up to max_baud at which the
+ * Flarm answers, and returns it in *baud_r.  If no higher speed works,
+ * the Flarm and the host port stay at the current speed.  Returns an
+ * error only if the Flarm could not be reached at all afterwards.
+ */
+flarm_result_t
+flarm_negotiate_speed(flarm_t flarm, unsigned max_baud, unsigned *baud_r);
+
+
 /* flarm-error.c */
 
 const char *
@@ -0,0 +1,241 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "open.h"
+#include "flight-index.h"
+
+#include <assert.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+
+static char *
+index_path(const struct flight_index *index, const char *filename)
+{
+    size_t length = strlen(index->directory) + 1 + strlen(filename) + 1;
+    char *path = malloc(length);
+
+    if (path == NULL)
+        abort();
+
+    snprintf(path, length, "%s/%s", index->directory, filename);
+    return path;
+}
+
+static int
+parse_line(const char *line, struct flight_index_entry *entry)
+{
+    int ret;
+
+    memset(entry, 0, sizeof(*entry));
+
+    ret = sscanf(line, "%31s %u %15s %x %x %" SCNx64 " %63s",
+                 entry->logger, &entry->flight_no, entry->date,
+                 &entry->start, &entry->end, &entry->hash,
+                 entry->filename);
+    return ret == 7;
+}
+
+int
+flight_index_open(struct flight_index *index, const char *directory)
+{
+    char *path, line[256];
+    FILE *file;
+    struct flight_index_entry entry;
+
+    index->directory = strdup(directory);
+    if (index->directory == NULL)
+        abort();
+
+    index->num = 0;
+    index->capacity = 0;
+    index->entries = NULL;
+
+    path = index_path(index, FLIGHT_INDEX_FILENAME);
+    file = fopen(path, "r");
+    free(path);
+    if (file == NULL)
+        return errno == ENOENT ? 0 : errno;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        /* skip comments and lines we don't understand; the worst
+           case is that a flight is downloaded again */
+        if (line[0] == '#' || !parse_line(line, &entry))
+            continue;
+
+        flight_index_update(index, &entry);
+    }
+
+    fclose(file);
+    return 0;
+}
+
+void
+flight_index_close(struct flight_index *index)
+{
+    free(index->directory);
+    free(index->entries);
+}
+
+struct flight_index_entry *
+flight_index_find(struct flight_index *index,
+                  const struct flight_index_entry *key)
+{
+    unsigned i;
+
+    for (i = 0; i < index->num; ++i) {
+        struct flight_index_entry *entry = &index->entries[i];
+
+        if (entry->flight_no == key->flight_no &&
+            entry->start == key->start && entry->end == key->end &&
+            strcmp(entry->logger, key->logger) == 0 &&
+            strcmp(entry->date, key->date) == 0)
+            return entry;
+    }
+
+    return NULL;
+}
+
+void
+flight_index_update(struct flight_index *index,
+                    const struct flight_index_entry *entry)
+{
+    struct flight_index_entry *old = flight_index_find(index, entry);
+
+    if (old != NULL) {
+        *old = *entry;
+        return;
+    }
+
+    if (index->num >= index->capacity) {
+        index->capacity = index->capacity == 0 ? 64 : index->capacity * 2;
+        index->entries = realloc(index->entries,
+                                 index->capacity * sizeof(index->entries[0]));
+        if (index->entries == NULL)
+            abort();
+    }
+
+    index->entries[index->num++] = *entry;
+}
+
+int
+flight_index_save(const struct flight_index *index)
+{
+    char *path, *tmp_path;
+    FILE *file;
+    unsigned i;
+    int ret = 0;
+
+    path = index_path(index, FLIGHT_INDEX_FILENAME);
+    tmp_path = index_path(index, FLIGHT_INDEX_FILENAME ".tmp");
+
+    file = fopen(tmp_path, "w");
+    if (file == NULL) {
+        ret = errno;
+        goto out;
+    }
+
+    fputs("# logger flight date start end hash file\n", file);
+
+    for (i = 0; i < index->num; ++i) {
+        const struct flight_index_entry *entry = &index->entries[i];
+
+        fprintf(file, "%s %u %s %x %x %016" PRIx64 " %s\n",
+                entry->logger, entry->flight_no, entry->date,
+                entry->start, entry->end, entry->hash,
+                entry->filename);
+    }
+
+    if (ferror(file))
+        ret = EIO;
+
+    if (fclose(file) != 0 && ret == 0)
+        ret = errno;
+
+    if (ret == 0 && rename(tmp_path, path) < 0)
+        ret = errno;
+
+    if (ret != 0)
+        unlink(tmp_path);
+
+ out:
+    free(path);
+    free(tmp_path);
+    return ret;
+}
+
+int
+flight_index_hash_file(const char *path, uint64_t *hash_r)
+{
+    /* FNV-1a */
+    uint64_t hash = 14695981039346656037ULL;
+    unsigned char buffer[16384];
+    ssize_t nbytes, i;
+    int fd;
+
+    fd = open(path, O_RDONLY|O_BINARY);
+    if (fd < 0)
+        return errno;
+
+    while ((nbytes = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (i = 0; i < nbytes; ++i) {
+            hash ^= buffer[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    if (nbytes < 0) {
+        int ret = errno;
+        close(fd);
+        return ret;
+    }
+
+    close(fd);
+    *hash_r = hash;
+    return 0;
+}
+
+int
+flight_index_verify(const struct flight_index *index,
+                    const struct flight_index_entry *entry)
+{
+    char *path = index_path(index, entry->filename);
+    uint64_t hash;
+    int ret;
+
+    ret = flight_index_hash_file(path, &hash);
+    free(path);
+
+    return ret == 0 && hash == entry->hash;
+}
+
+void
+flight_index_report(FILE *file, const char *status,
+                    const struct flight_index_entry *entry)
+{
+    assert(status != NULL);
+
+    fprintf(file, "%s logger=%s flight=%u date=%s file=%s hash=%016" PRIx64 "\n",
+            status, entry->logger, entry->flight_no, entry->date,
+            entry->filename, entry->hash);
+}
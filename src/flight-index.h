@@ -0,0 +1,116 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * A persistent list of the flights which were downloaded from
+ * loggers into one directory.  It allows a sync to skip flights
+ * which are already there, and detects local files which were
+ * modified or lost since the download.
+ */
+
+#ifndef __FLIGHT_INDEX_H
+#define __FLIGHT_INDEX_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+/** the name of the index file in the output directory */
+#define FLIGHT_INDEX_FILENAME "flights.index"
+
+struct flight_index_entry {
+    /** logger type and serial number, e.g. "lxn-1234" */
+    char logger[32];
+
+    unsigned flight_no;
+
+    /** the date as reported by the logger */
+    char date[16];
+
+    /** memory range on the logger */
+    unsigned start, end;
+
+    /** FNV-1a hash of the downloaded file */
+    uint64_t hash;
+
+    /** the downloaded file, relative to the directory */
+    char filename[64];
+};
+
+struct flight_index {
+    char *directory;
+    unsigned num, capacity;
+    struct flight_index_entry *entries;
+};
+
+/**
+ * Loads the index of the specified directory.  A missing index file
+ * results in an empty index.  Returns 0 on success or an errno value.
+ */
+int
+flight_index_open(struct flight_index *index, const char *directory);
+
+void
+flight_index_close(struct flight_index *index);
+
+/**
+ * Looks up a flight by logger, flight number, date and memory range.
+ * The hash and file name of the key are ignored.
+ */
+struct flight_index_entry *
+flight_index_find(struct flight_index *index,
+                  const struct flight_index_entry *key);
+
+/**
+ * Adds the entry, or replaces the entry of the same flight.
+ */
+void
+flight_index_update(struct flight_index *index,
+                    const struct flight_index_entry *entry);
+
+/**
+ * Writes the index file.  The old file is replaced atomically, so an
+ * interrupted sync keeps the flights it has finished.
+ */
+int
+flight_index_save(const struct flight_index *index);
+
+/**
+ * Calculates the hash of a file.  Returns 0 on success or an errno
+ * value.
+ */
+int
+flight_index_hash_file(const char *path, uint64_t *hash_r);
+
+/**
+ * Does the file of the entry still exist in the directory, with the
+ * recorded hash?
+ */
+int
+flight_index_verify(const struct flight_index *index,
+                    const struct flight_index_entry *entry);
+
+/**
+ * Prints one line of the machine readable sync summary.  The status
+ * is one of "new", "present", "repaired" and "failed".
+ */
+void
+flight_index_report(FILE *file, const char *status,
+                    const struct flight_index_entry *entry);
+
+#endif
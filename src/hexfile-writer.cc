@@ -21,6 +21,8 @@
 
 #include "hexfile-writer.hh"
 
+#include <string.h>
+
 static const char hexdigits[] = "0123456789ABCDEF";
 
 void hexbyte(char *dest, unsigned char data) {
@@ -36,6 +38,7 @@ void hexshort(char *dest, unsigned short data) {
 
 HexfileOutputFilterBuf::~HexfileOutputFilterBuf()
 {
+    flush_pending();
     write_record(0, 0, 0x01, NULL);
 }
 
@@ -80,33 +83,57 @@ HexfileOutputFilterBuf::write_record(size_t length, unsigned address,
     return p - buffer;
 }
 
+void
+HexfileOutputFilterBuf::flush_pending()
+{
+    if (pending_length == 0)
+        return;
+
+    write_record(pending_length, offset, 0, pending);
+    offset += pending_length;
+    pending_length = 0;
+}
+
 std::streamsize
 HexfileOutputFilterBuf::xsputn(const char_type* s, std::streamsize n)
 {
     std::streamsize rest = n, written = 0;
 
+    /* the data is collected in full records, no matter how it is
+       split into write calls */
     while (rest > 0) {
-        n = rest > 0x10 ? 0x10 : rest;
-        if (offset >= 0x8000) {
+        if (pending_length == 0 && offset >= 0x8000) {
             ++segment;
             offset = 0;
 
             write_record(0, 0, 0x10 + segment, NULL);
         }
 
-        if (offset + n > 0x8000)
-            n = 0x8000 - offset;
+        n = sizeof(pending) - pending_length;
+        if (n > rest)
+            n = rest;
 
-        std::streamsize ret = write_record(n, offset, 0,
-                                           (const unsigned char*)s);
-        if (ret == 0)
-            break;
+        if (offset + pending_length + n > 0x8000)
+            n = 0x8000 - offset - pending_length;
+
+        memcpy(pending + pending_length, s, n);
+        pending_length += n;
+
+        if (pending_length == sizeof(pending) ||
+            offset + pending_length == 0x8000)
+            flush_pending();
 
         s += n;
         rest -= n;
         written += n;
-        offset += n;
     }
 
     return written;
 }
+
+int
+HexfileOutputFilterBuf::sync()
+{
+    flush_pending();
+    return 0;
+}
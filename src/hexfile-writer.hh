@@ -32,9 +32,14 @@ private:
     std::ostream *next;
     unsigned segment, offset;
 
+    /** data which has not been written yet, because it does not
+        fill a whole record; it starts at "offset" */
+    unsigned char pending[0x10];
+    size_t pending_length;
+
 public:
     HexfileOutputFilterBuf(std::ostream &_next, unsigned _segment)
-        :next(&_next), segment(_segment), offset(0) {
+        :next(&_next), segment(_segment), offset(0), pending_length(0) {
         if (segment > 0)
             write_record(0, 0, 0x10 + segment, NULL);
     }
@@ -45,9 +50,14 @@ private:
     write_record(size_t length, unsigned address,
                  unsigned type, const unsigned char *data);
 
+    void flush_pending();
+
 public:
     virtual std::streamsize
     xsputn(const char_type* __s, std::streamsize __n);
+
+protected:
+    virtual int sync();
 };
 
 class HexfileOutputFilter
@@ -29,7 +29,6 @@
 #include <string.h>
 #include <errno.h>
 #include <termios.h>
-#include <signal.h>
 #include <time.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -158,18 +157,12 @@ static void parse_cmdline(struct config *config,
     }
 }
 
-static void alarm_handler(int dummy) {
-    (void)dummy;
-}
-
 static void syn_ack_wait(filser_t device) {
     int ret;
     unsigned tries = 20;
 
     do {
-        alarm(10);
         ret = filser_syn_ack(device);
-        alarm(0);
         if (ret < 0) {
             fprintf(stderr, "failed to connect: %s\n",
                     strerror(errno));
@@ -191,7 +184,7 @@ static void syn_ack_wait(filser_t device) {
 static int read_full_crc(filser_t device, void *buffer, size_t len) {
     int ret;
 
-    ret = filser_read_crc(device, buffer, len, 40);
+    ret = filser_read_crc(device, buffer, len, 40000);
     if (ret == -2) {
         fprintf(stderr, "CRC error\n");
         exit(1);
@@ -247,8 +240,6 @@ int main(int argc, char **argv) {
     int fd;
     unsigned i;
 
-    signal(SIGALRM, alarm_handler);
-
     parse_cmdline(&config, argc, argv);
 
     if (optind < argc - 1)
@@ -31,7 +31,6 @@
 #include <string.h>
 #include <errno.h>
 #include <termios.h>
-#include <signal.h>
 #include <stdlib.h>
 #include <sys/select.h>
 
@@ -92,9 +91,7 @@ static void syn_ack_wait(filser_t device) {
     unsigned tries = 20;
 
     do {
-        alarm(10);
         ret = filser_syn_ack(device);
-        alarm(0);
         if (ret < 0) {
             fprintf(stderr, "failed to connect: %s\n",
                     strerror(errno));
@@ -17,19 +17,12 @@
  * 02111-1307, USA.
  */
 
-#include "open.h"
-
-#include <assert.h>
 #include <sys/types.h>
-#include <sys/stat.h>
-#include <fcntl.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
 #include <termios.h>
-#include <signal.h>
-#include <time.h>
 #include <stdlib.h>
 #include <ctype.h>
 #include <arpa/inet.h>
@@ -39,13 +32,16 @@
 
 #include "version.h"
 #include "filser.h"
-#include "lxn-to-igc.h"
+#include "serialio.h"
+#include "flight-index.h"
 
 #define MAX_FLIGHTS 256
 
 struct config {
     int verbose;
     const char *tty;
+    const char *sync_dir;
+    int fast;
 };
 
 static void usage(void) {
@@ -71,6 +67,14 @@ static void usage(void) {
          " --tty DEVICE\n"
 #endif
          " -t DEVICE      open this tty device (default /dev/ttyS0)\n"
+#ifdef __GLIBC__
+         " --sync DIR\n"
+#endif
+         " -s DIR         download all new flights to DIR, print a summary\n"
+#ifdef __GLIBC__
+         " --fast\n"
+#endif
+         " -f             use the highest line speed the logger answers at\n"
          );
 }
 
@@ -97,6 +101,8 @@ static void parse_cmdline(struct config *config,
         {"verbose", 0, 0, 'v'},
         {"quiet", 1, 0, 'q'},
         {"tty", 1, 0, 't'},
+        {"sync", 1, 0, 's'},
+        {"fast", 0, 0, 'f'},
         {0,0,0,0}
     };
 #endif
@@ -109,10 +115,10 @@ static void parse_cmdline(struct config *config,
 #ifdef __GLIBC__
         int option_index = 0;
 
-        ret = getopt_long(argc, argv, "hVvqt:",
+        ret = getopt_long(argc, argv, "hVvqt:s:f",
                           long_options, &option_index);
 #else
-        ret = getopt(argc, argv, "hVvqt:");
+        ret = getopt(argc, argv, "hVvqt:s:f");
 #endif
         if (ret == -1)
             break;
@@ -139,6 +145,14 @@ static void parse_cmdline(struct config *config,
             config->tty = optarg;
             break;
 
+        case 's':
+            config->sync_dir = optarg;
+            break;
+
+        case 'f':
+            config->fast = 1;
+            break;
+
         case '?':
             arg_error(argv[0], NULL);
 
@@ -148,22 +162,16 @@ static void parse_cmdline(struct config *config,
     }
 }
 
-static void alarm_handler(int dummy) {
-    (void)dummy;
-}
-
-static void syn_ack_wait(filser_t device) {
+static int syn_ack_wait(filser_t device) {
     int ret;
     unsigned tries = 20;
 
     do {
-        alarm(10);
         ret = filser_syn_ack(device);
-        alarm(0);
         if (ret < 0) {
             fprintf(stderr, "failed to connect: %s\n",
                     strerror(errno));
-            exit(1);
+            return -1;
         }
 
         if (ret == 0) {
@@ -174,17 +182,21 @@ static void syn_ack_wait(filser_t device) {
 
     if (ret == 0) {
         fprintf(stderr, "no filser\n");
-        exit(1);
+        errno = ETIMEDOUT;
+        return -1;
     }
+
+    return 0;
 }
 
 static int read_full_crc(filser_t device, void *buffer, size_t len) {
     int ret;
 
-    ret = filser_read_crc(device, buffer, len, 40);
+    ret = filser_read_crc(device, buffer, len, 40000);
     if (ret == -2) {
         fprintf(stderr, "CRC error\n");
-        exit(1);
+        errno = EBADMSG;
+        return -1;
     }
 
     return ret;
@@ -194,7 +206,8 @@ static int communicate(filser_t device, unsigned char cmd,
                        unsigned char *buffer, size_t buffer_len) {
     int ret;
 
-    syn_ack_wait(device);
+    if (syn_ack_wait(device) < 0)
+        return -1;
 
     tcflush(device->fd, TCIOFLUSH);
 
@@ -232,7 +245,8 @@ static int check_mem_settings(filser_t device) {
 static int open_flight_list(filser_t device) {
     int ret;
 
-    syn_ack_wait(device);
+    if (syn_ack_wait(device) < 0)
+        return -1;
 
     ret = filser_send_command(device, FILSER_READ_FLIGHT_LIST);
     if (ret <= 0)
@@ -254,7 +268,8 @@ static int next_flight(filser_t device, struct filser_flight_index *flight) {
     return 1;
 }
 
-static unsigned flight_list(filser_t device, struct filser_flight_index *flights,
+static unsigned flight_list(const struct config *config, filser_t device,
+                            struct filser_flight_index *flights,
                             unsigned max_flights) {
     int ret;
     unsigned num_flights = 0;
@@ -266,8 +281,10 @@ static unsigned flight_list(filser_t device, struct filser_flight_index *flights
         exit(1);
     }
 
-    printf("%-2s  %-8s  %-17s  %s\n",
-           "No", "Date", "Time", "Pilot");
+    /* in sync mode, stdout is reserved for the summary */
+    if (config->sync_dir == NULL)
+        printf("%-2s  %-8s  %-17s  %s\n",
+               "No", "Date", "Time", "Pilot");
 
     for (num_flights = 0; num_flights < max_flights; ++num_flights, ++flight) {
         ret = next_flight(device, flight);
@@ -279,245 +296,162 @@ static unsigned flight_list(filser_t device, struct filser_flight_index *flights
         if (ret == 0)
             break;
 
-        printf("%2u  %8s  %8s-%8s  %s\n",
-               num_flights + 1,
-               flight->date, flight->start_time,
-               flight->stop_time, flight->pilot);
+        if (config->sync_dir == NULL)
+            printf("%2u  %8s  %8s-%8s  %s\n",
+                   num_flights + 1,
+                   flight->date, flight->start_time,
+                   flight->stop_time, flight->pilot);
     }
 
     return num_flights;
 }
 
-static int seek_mem(filser_t device, const struct filser_flight_index *flight) {
-    struct filser_packet_def_mem packet;
-    int ret;
-    unsigned char response;
-
-    /* ignore highest byte here, the same as in kflog */
-
-    /* start address */
-    packet.start_address[0] = flight->start_address0;
-    packet.start_address[1] = flight->start_address1;
-    packet.start_address[2] = flight->start_address2;
+static void download_message(void *ctx, int level, const char *text) {
+    const int *verbose = ctx;
 
-    /* end address */
-    packet.end_address[0] = flight->end_address0;
-    packet.end_address[1] = flight->end_address1;
-    packet.end_address[2] = flight->end_address2;
+    if (*verbose >= level)
+        fprintf(stderr, "%s\n", text);
+}
 
-    tcflush(device->fd, TCIOFLUSH);
+static int download_flight(const struct config *config,
+                           filser_t device, const struct filser_flight_index *flight,
+                           const char *lxn_filename, const char *igc_filename) {
+    struct filser_download download;
+    int verbose = config->verbose;
+    uint64_t start_time = serialio_now(), duration;
 
-    ret = filser_write_packet(device, FILSER_DEF_MEM,
-                              &packet, sizeof(packet));
-    if (ret <= 0)
+    if (syn_ack_wait(device) < 0)
         return -1;
 
-    alarm(40);
-    ret = filser_read(device, &response, sizeof(response), 40);
-    alarm(0);
-    if (ret < 0)
-        return -1;
+    download.message = download_message;
+    download.ctx = &verbose;
 
-    if (ret == 0) {
-        fprintf(stderr, "no response\n");
-        exit(2);
+    if (filser_download_flight(device, flight, lxn_filename, igc_filename,
+                               &download) < 0) {
+        fprintf(stderr, "%s\n", download.error);
+        fprintf(stderr, "giving up; run again to resume the download\n");
+        return -1;
     }
 
-    if (response != FILSER_ACK) {
-        fprintf(stderr, "no ack in seek_mem\n");
-        exit(1);
-    }
+    /* the effective rate, including the time lost in retries */
+    duration = serialio_now() - start_time;
+    if (config->verbose >= 1)
+        fprintf(stderr, "%lu bytes in %lu.%01lu s, %lu bytes/s, %u retries\n",
+                download.num_bytes, (unsigned long)(duration / 1000),
+                (unsigned long)(duration % 1000 / 100),
+                duration > 0
+                ? (unsigned long)(download.num_bytes * 1000 / duration)
+                : download.num_bytes,
+                download.retries);
 
     return 0;
 }
 
-static int get_mem_section(filser_t device, size_t section_lengths[0x10],
-                           size_t *overall_lengthp) {
-    struct filser_packet_mem_section packet;
-    int ret;
-    unsigned z;
-
-    ret = filser_send_command(device, FILSER_GET_MEM_SECTION);
-    if (ret <= 0)
-        return -1;
+/** fill in the flight index key of a flight */
+static void index_key(struct flight_index_entry *key,
+                      const struct filser_flight_index *flight) {
+    unsigned i;
 
-    ret = read_full_crc(device, &packet, sizeof(packet));
-    if (ret <= 0)
-        return -1;
+    memset(key, 0, sizeof(*key));
 
-    *overall_lengthp = 0;
+    snprintf(key->logger, sizeof(key->logger), "lxn-%u",
+             ntohs(flight->logger_id));
+    key->flight_no = flight->flight_no;
 
-    for (z = 0; z < 0x10; z++) {
-        section_lengths[z] = ntohs(packet.section_lengths[z]);
-        (*overall_lengthp) += section_lengths[z];
-    }
+    for (i = 0; i < sizeof(flight->date) && flight->date[i] != 0; ++i)
+        key->date[i] = isgraph((unsigned char)flight->date[i])
+            ? flight->date[i] : '_';
+    if (i == 0)
+        key->date[i] = '-';
 
-    return 0;
+    key->start = flight->start_address0 | flight->start_address1 << 8 |
+        flight->start_address2 << 16 | (unsigned)flight->start_address3 << 24;
+    key->end = flight->end_address0 | flight->end_address1 << 8 |
+        flight->end_address2 << 16 | (unsigned)flight->end_address3 << 24;
 }
 
-static int download_section(filser_t device, unsigned section,
-                            unsigned char *buffer, size_t length) {
+/**
+ * Downloads all flights which are not in the flight index of the
+ * sync directory, or whose file was modified or deleted.  Prints one
+ * summary line per flight to stdout.
+ */
+static int sync_flights(const struct config *config, filser_t device,
+                        const struct filser_flight_index *flights,
+                        unsigned num_flights) {
+    struct flight_index index;
+    struct flight_index_entry key;
+    const struct flight_index_entry *entry;
+    unsigned i, num_new = 0, num_present = 0, num_repaired = 0,
+        num_failed = 0;
+    char name[16], lxn_path[1024], igc_path[1024];
+    const char *status;
     int ret;
 
-    ret = filser_send_command(device, FILSER_READ_LOGGER_DATA + section);
-    if (ret <= 0)
-        return -1;
-
-    ret = read_full_crc(device, buffer, length);
-    if (ret <= 0)
-        return -1;
-
-    return 0;
-}
-
-static int download_flight(const struct config *config,
-                           filser_t device, const struct filser_flight_index *flight,
-                           const char *filename) {
-    int ret, fd2;
-    size_t section_lengths[0x10], overall_length;
-    unsigned char *data, *p;
-    unsigned i;
-
-    syn_ack_wait(device);
-
-    if (config->verbose >= 3)
-        printf("seeking logger memory\n");
-    ret = seek_mem(device, flight);
-    if (ret < 0) {
-        fprintf(stderr, "io error: %s\n", strerror(errno));
-        exit(1);
-    }
-
-    if (config->verbose >= 3)
-        printf("obtaining logger memory section data\n");
-    ret = get_mem_section(device, section_lengths, &overall_length);
-    if (ret < 0) {
-        fprintf(stderr, "io error: %s\n", strerror(errno));
-        exit(1);
-    }
-
-    data = malloc(overall_length);
-    if (data == NULL) {
-        fprintf(stderr, "out of memory\n");
-        exit(1);
-    }
-
-    fd2 = open(filename, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
-    if (fd2 < 0) {
-        fprintf(stderr, "failed to create %s: %s\n",
-                filename, strerror(errno));
+    ret = flight_index_open(&index, config->sync_dir);
+    if (ret != 0) {
+        fprintf(stderr, "failed to read the flight index in %s: %s\n",
+                config->sync_dir, strerror(ret));
         exit(2);
     }
 
-    for (i = 0, p = data; i < 0x10; i++) {
-        if (section_lengths[i] == 0)
-            break;
-
-        if (config->verbose >= 3)
-            printf("downloading memory section %u from logger, %lu bytes\n",
-                   i, (unsigned long)section_lengths[i]);
+    for (i = 0; i < num_flights; ++i) {
+        index_key(&key, &flights[i]);
 
-        ret = download_section(device, i,
-                               p, section_lengths[i]);
-        if (ret < 0) {
-            fprintf(stderr, "io error: %s\n", strerror(errno));
-            exit(1);
+        entry = flight_index_find(&index, &key);
+        if (entry != NULL && flight_index_verify(&index, entry)) {
+            flight_index_report(stdout, "present", entry);
+            ++num_present;
+            continue;
         }
 
-        write(fd2, p, section_lengths[i]);
+        /* a flight in the index whose file was lost or modified */
+        status = entry != NULL ? "repaired" : "new";
 
-        p += section_lengths[i];
-    }
-
-    close(fd2);
+        filser_flight_filename(name, &flights[i]);
+        name[8] = 0;
+        snprintf(key.filename, sizeof(key.filename), "%s.lxn", name);
+        snprintf(lxn_path, sizeof(lxn_path), "%s/%s.lxn",
+                 config->sync_dir, name);
+        snprintf(igc_path, sizeof(igc_path), "%s/%s.igc",
+                 config->sync_dir, name);
 
-    free(data);
-
-    return 0;
-}
-
-static int cmd_lxn2igc(const char *in_path, const char *out_path) {
-    int fd, ret, is_eof = 0, done = 0;
-    FILE *out;
-    unsigned char buffer[4096];
-    size_t start = 0, end = 0, consumed;
-    ssize_t nbytes;
-    lxn_to_igc_t fti;
-
-    fd = open(in_path, O_RDONLY|O_BINARY);
-    if (fd < 0) {
-        fprintf(stderr, "failed to open %s: %s\n",
-                in_path, strerror(errno));
-        return errno;
-    }
+        if (config->verbose >= 1)
+            fprintf(stderr, "Downloading flight %u to %s\n", i + 1, lxn_path);
 
-    out = fopen(out_path, "w");
-    if (out == NULL) {
-        fprintf(stderr, "failed to create %s: %s\n",
-                out_path, strerror(errno));
-        return errno;
-    }
-
-    ret = lxn_to_igc_open(out, &fti);
-    if (ret != 0) {
-        fprintf(stderr, "lxn_to_igc_open() failed\n");
-        return 2;
-    }
-
-    do {
-        if (start > 0) {
-            if (end > start)
-                memmove(buffer, buffer + start, end - start);
-            end -= start;
-            start = 0;
-        }
-
-        if (end < sizeof(buffer)) {
-            nbytes = read(fd, buffer + end, sizeof(buffer) - end);
-            if (nbytes < 0) {
-                fprintf(stderr, "failed to read from %s: %s\n",
-                        in_path, strerror(errno));
-                return 2;
-            } else if (nbytes == 0)
-                is_eof = 1;
-            else
-                end += (size_t)nbytes;
+        ret = download_flight(config, device, &flights[i],
+                              lxn_path, igc_path);
+        if (ret == 0)
+            ret = flight_index_hash_file(lxn_path, &key.hash);
+        if (ret != 0) {
+            /* not added to the index; the next sync tries again */
+            flight_index_report(stdout, "failed", &key);
+            ++num_failed;
+            continue;
         }
 
-        if (end > start) {
-            ret = lxn_to_igc_process(fti, buffer + start, end - start, &consumed);
-            if (ret == 0) {
-                done = 1;
-            } else if (ret != EAGAIN) {
-                if (ret == -1 && lxn_to_igc_error(fti) != NULL)
-                    fprintf(stderr, "lxn_to_igc_process() failed: %s\n", lxn_to_igc_error(fti));
-                else
-                    fprintf(stderr, "lxn_to_igc_process() failed: %d\n", ret);
-                return 2;
-            }
-
-            assert(consumed > 0);
-            assert(start + consumed <= end);
-
-            start += consumed;
+        /* save after each flight, so an interrupted sync doesn't
+           lose the flights it has completed */
+        flight_index_update(&index, &key);
+        ret = flight_index_save(&index);
+        if (ret != 0) {
+            fprintf(stderr, "failed to write the flight index in %s: %s\n",
+                    config->sync_dir, strerror(ret));
+            exit(2);
         }
-    } while (!is_eof && !done);
 
-    if (end > start) {
-        fprintf(stderr, "unexpected eof\n");
-        return 2;
+        flight_index_report(stdout, status, &key);
+        if (status[0] == 'r')
+            ++num_repaired;
+        else
+            ++num_new;
     }
 
-    ret = lxn_to_igc_close(&fti);
-    if (ret != 0) {
-        fprintf(stderr, "lxn_to_igc_close() failed\n");
-        return 2;
-    }
+    printf("summary flights=%u new=%u present=%u repaired=%u failed=%u\n",
+           num_flights, num_new, num_present, num_repaired, num_failed);
 
-    fclose(out);
-    close(fd);
+    flight_index_close(&index);
 
-    return 0;
+    return num_failed > 0 ? -1 : 0;
 }
 
 int main(int argc, char **argv) {
@@ -528,8 +462,6 @@ int main(int argc, char **argv) {
     unsigned num_flights;
     char line[256];
 
-    signal(SIGALRM, alarm_handler);
-
     parse_cmdline(&config, argc, argv);
 
     if (optind < argc)
@@ -545,9 +477,24 @@ int main(int argc, char **argv) {
         exit(1);
     }
 
+    if (config.fast) {
+        unsigned baud = filser_negotiate_speed(device, 115200);
+        if (baud == 0)
+            fprintf(stderr, "no answer from the logger at any speed\n");
+        else if (config.verbose >= 1)
+            fprintf(stderr, "talking to the logger at %u baud\n", baud);
+    }
+
     check_mem_settings(device);
 
-    num_flights = flight_list(device, flights, MAX_FLIGHTS);
+    num_flights = flight_list(&config, device, flights, MAX_FLIGHTS);
+
+    if (config.sync_dir != NULL) {
+        ret = sync_flights(&config, device, flights, num_flights);
+        filser_close(&device);
+        return ret == 0 ? 0 : 1;
+    }
+
     if (num_flights == 0) {
         fprintf(stderr, "no flights on the device\n");
         exit(2);
@@ -592,16 +539,14 @@ int main(int argc, char **argv) {
             strcpy(igc_filename + 8, ".igc");
 
             if (config.verbose >= 1)
-                printf("Downloading flight %u to %s\n", nr, lxn_filename);
-
-            download_flight(&config, device, flight, lxn_filename);
-
-            if (config.verbose >= 1)
-                printf("Converting to %s\n", igc_filename);
-
-            cmd_lxn2igc(lxn_filename, igc_filename);
-
-            if (config.verbose >= 1)
+                printf("Downloading flight %u to %s and %s\n",
+                       nr, lxn_filename, igc_filename);
+
+            ret = download_flight(&config, device, flight,
+                                  lxn_filename, igc_filename);
+            if (ret < 0)
+                printf("Failed to download flight %u\n", nr);
+            else if (config.verbose >= 1)
                 printf("Done with flight %u\n", nr);
         } else if (line[0] != 0 && line[0] != '\n') {
             printf("Invalid command.  Type 'help' for more information.\n");
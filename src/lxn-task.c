@@ -0,0 +1,79 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "lxn-task.h"
+#include "lxn-reader.h"
+
+#include <string.h>
+#include <errno.h>
+
+#ifdef WIN32
+#include <winsock.h>
+#else
+#include <arpa/inet.h>
+#endif
+
+int
+lxn_find_task(const unsigned char *data, size_t length,
+              struct lxn_task_point points[LXN_TASK_MAX_POINTS])
+{
+    struct lxn_reader lxn;
+    unsigned i;
+    size_t name_length;
+    int ret, num_points = 0;
+
+    memset(&lxn, 0, sizeof(lxn));
+    lxn.input = data;
+    lxn.input_length = length;
+
+    while (lxn.input_consumed < lxn.input_length && !lxn.is_end) {
+        ret = lxn_read(&lxn);
+        if (ret == EAGAIN)
+            /* truncated file */
+            break;
+        else if (ret != 0)
+            return -1;
+
+        if (*lxn.packet.cmd != LXN_TASK)
+            continue;
+
+        for (i = 0; i < LXN_TASK_MAX_POINTS; ++i) {
+            if (!lxn.packet.task->usage[i])
+                continue;
+
+            points[num_points].latitude =
+                (int32_t)ntohl(lxn.packet.task->latitude[i]);
+            points[num_points].longitude =
+                (int32_t)ntohl(lxn.packet.task->longitude[i]);
+            memcpy(points[num_points].name, lxn.packet.task->name[i],
+                   sizeof(lxn.packet.task->name[i]));
+            name_length = sizeof(lxn.packet.task->name[i]);
+            while (name_length > 0 &&
+                   (points[num_points].name[name_length - 1] == ' ' ||
+                    points[num_points].name[name_length - 1] == 0))
+                --name_length;
+            points[num_points].name[name_length] = 0;
+            ++num_points;
+        }
+
+        return num_points;
+    }
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef __LXN_TASK_H
+#define __LXN_TASK_H
+
+#include <stddef.h>
+
+#define LXN_TASK_MAX_POINTS 12
+
+/** a point of the task declared in an LXN file */
+struct lxn_task_point {
+    /** in 1/1000 arc minutes, positive is north / east */
+    int latitude, longitude;
+
+    /** null-terminated */
+    char name[10];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* __cplusplus */
+
+/**
+ * Finds the first LXN_TASK packet in the contents of an LXN file, and
+ * copies its points.  Returns the number of points, 0 if there is no
+ * task (or the file is truncated before it), or -1 if the file is
+ * malformed.
+ */
+int
+lxn_find_task(const unsigned char *data, size_t length,
+              struct lxn_task_point points[LXN_TASK_MAX_POINTS]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
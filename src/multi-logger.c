@@ -0,0 +1,1491 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Downloads the flights from many loggers at once.
+ *
+ * The device protocols are strictly request/response, and the
+ * libraries block while waiting for the device.  Therefore every port
+ * is handled by a child process, which detects the logger type,
+ * downloads all new flights and reports its progress line by line
+ * through a pipe.  The main process multiplexes all pipes in one
+ * poll() loop and converts the downloaded files to IGC on a pool of
+ * worker processes, so a slow logger delays only itself.
+ *
+ * Messages from a child process (one per line):
+ *
+ *  T TYPE       the logger type was detected
+ *  N COUNT      number of flights on the logger
+ *  S BASE       the flight exists already in BASE.igc
+ *  F KIND BASE  downloaded BASE.KIND, convert it to BASE.igc
+ *  I BASE       downloaded BASE.igc, no conversion needed (Flarm), or
+ *               converted while downloading (Filser)
+ *  M TEXT       progress information
+ *  E TEXT       error message
+ */
+
+#include "open.h"
+
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <termios.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <ctype.h>
+#include <poll.h>
+#include <glob.h>
+#include <arpa/inet.h>
+#ifdef __GLIBC__
+#include <getopt.h>
+#endif
+
+#include "version.h"
+#include "serialio.h"
+#include "filser.h"
+#include "zander.h"
+#include "zander-igc.h"
+#include "flarm.h"
+
+#define MAX_FLIGHTS 256
+
+enum logger_type {
+    LOGGER_UNKNOWN,
+    LOGGER_FILSER,
+    LOGGER_ZANDER,
+    LOGGER_FLARM,
+};
+
+static const char *const logger_type_names[] = {
+    [LOGGER_UNKNOWN] = "unknown",
+    [LOGGER_FILSER] = "filser",
+    [LOGGER_ZANDER] = "zander",
+    [LOGGER_FLARM] = "flarm",
+};
+
+struct config {
+    int verbose;
+    const char *output_dir;
+
+    /** number of conversion worker processes */
+    unsigned jobs;
+
+    /** rescan the ports every this many seconds; 0 means exit
+        after all ports are done */
+    unsigned watch;
+
+    /** switch Filser and Flarm devices to their highest line
+        speed */
+    bool fast;
+
+    /** the port names (may be glob patterns) */
+    char **ports;
+    unsigned num_ports;
+};
+
+/** a child process which reports through a pipe */
+struct child {
+    pid_t pid;
+    int fd;
+
+    /** the exit status from waitpid() */
+    int status;
+
+    size_t length;
+    char buffer[1024];
+};
+
+struct port {
+    struct port *next;
+    char *path;
+
+    /** the device node which was synchronized last; a different
+        one means the logger was plugged in again */
+    bool synced;
+    dev_t rdev;
+    ino_t ino;
+
+    struct child session;
+
+    enum logger_type type;
+    int num_flights;
+    unsigned num_new, num_skipped, num_errors;
+};
+
+/** a downloaded file which has to be converted to IGC */
+struct job {
+    struct job *next;
+    struct port *port;
+    char kind[4];
+    char *base;
+};
+
+struct worker {
+    struct child child;
+    struct job *job;
+};
+
+struct instance {
+    const struct config *config;
+
+    struct port *ports;
+
+    struct job *jobs, **jobs_tail;
+
+    struct worker *workers;
+
+    unsigned num_sessions, num_busy;
+    unsigned num_new, num_converted, num_errors;
+};
+
+static volatile sig_atomic_t should_exit = 0;
+
+static void exit_handler(int dummy) {
+    (void)dummy;
+    should_exit = 1;
+}
+
+static void usage(void) {
+    puts("usage: multi-logger [OPTIONS] PORT...\n"
+         "valid options:\n"
+#ifdef __GLIBC__
+         " --help\n"
+#endif
+         " -h             help (this text)\n"
+#ifdef __GLIBC__
+         " --version\n"
+#endif
+         " -V             show multi-logger version\n"
+#ifdef __GLIBC__
+         " --verbose\n"
+#endif
+         " -v             be more verbose\n"
+#ifdef __GLIBC__
+         " --quiet\n"
+#endif
+         " -q             be quiet\n"
+#ifdef __GLIBC__
+         " --output DIR\n"
+#endif
+         " -o DIR         write the flights to this directory\n"
+#ifdef __GLIBC__
+         " --jobs N\n"
+#endif
+         " -j N           number of conversion processes\n"
+#ifdef __GLIBC__
+         " --watch SECONDS\n"
+#endif
+         " -w SECONDS     keep running, look for new loggers periodically\n"
+#ifdef __GLIBC__
+         " --fast\n"
+#endif
+         " -f             use the highest line speed of Filser and Flarm devices\n"
+         "\n"
+         "PORT may be a pattern like '/dev/ttyUSB*'.\n"
+         );
+}
+
+static void arg_error(const char *msg) __attribute__ ((noreturn));
+static void arg_error(const char *msg) {
+    fprintf(stderr, "multi-logger: %s\n", msg);
+    fprintf(stderr, "Try 'multi-logger -h' for more information.\n");
+    _exit(1);
+}
+
+/** read configuration options from the command line */
+static void parse_cmdline(struct config *config,
+                          int argc, char **argv) {
+    int ret;
+    long n;
+    char *endptr;
+#ifdef __GLIBC__
+    static const struct option long_options[] = {
+        {"help", 0, 0, 'h'},
+        {"version", 0, 0, 'V'},
+        {"verbose", 0, 0, 'v'},
+        {"quiet", 0, 0, 'q'},
+        {"output", 1, 0, 'o'},
+        {"jobs", 1, 0, 'j'},
+        {"watch", 1, 0, 'w'},
+        {"fast", 0, 0, 'f'},
+        {0,0,0,0}
+    };
+#endif
+
+    memset(config, 0, sizeof(*config));
+    config->verbose = 1;
+    config->output_dir = ".";
+
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+    config->jobs = n > 0 ? (unsigned)n : 1;
+
+    while (1) {
+#ifdef __GLIBC__
+        int option_index = 0;
+
+        ret = getopt_long(argc, argv, "hVvqo:j:w:f",
+                          long_options, &option_index);
+#else
+        ret = getopt(argc, argv, "hVvqo:j:w:f");
+#endif
+        if (ret == -1)
+            break;
+
+        switch (ret) {
+        case 'h':
+            usage();
+            exit(0);
+
+        case 'V':
+            puts("loggertools v" VERSION " (C) 2004-2008 Max Kellermann <max@duempel.org>\n"
+                 "http://max.kellermann.name/projects/loggertools/\n");
+            exit(0);
+
+        case 'v':
+            ++config->verbose;
+            break;
+
+        case 'q':
+            config->verbose = 0;
+            break;
+
+        case 'o':
+            config->output_dir = optarg;
+            break;
+
+        case 'j':
+            n = strtol(optarg, &endptr, 10);
+            if (*endptr != 0 || n <= 0 || n > 64)
+                arg_error("invalid number of jobs");
+            config->jobs = (unsigned)n;
+            break;
+
+        case 'w':
+            n = strtol(optarg, &endptr, 10);
+            if (*endptr != 0 || n <= 0)
+                arg_error("invalid watch interval");
+            config->watch = (unsigned)n;
+            break;
+
+        case 'f':
+            config->fast = true;
+            break;
+
+        default:
+            exit(1);
+        }
+    }
+
+    if (optind == argc)
+        arg_error("no port specified");
+
+    config->ports = argv + optind;
+    config->num_ports = (unsigned)(argc - optind);
+}
+
+static bool
+file_exists(const char *path)
+{
+    struct stat st;
+
+    return stat(path, &st) == 0;
+}
+
+/**
+ * The path of a flight's files without the suffix.  Returns false if
+ * it does not fit into the buffer.
+ */
+static bool
+flight_base(char *buffer, size_t size, const char *dir, const char *name)
+{
+    int ret = snprintf(buffer, size, "%s/%s", dir, name);
+
+    return ret >= 0 && (size_t)ret < size;
+}
+
+/** build the path of an output file; returns false if it does not
+    fit into the buffer */
+static bool
+output_path(char *buffer, size_t size, const char *base, const char *suffix)
+{
+    int ret = snprintf(buffer, size, "%s.%s", base, suffix);
+
+    return ret >= 0 && (size_t)ret < size;
+}
+
+/**
+ * The path of a file which is being written.  It contains the process
+ * id, because two sessions (or two workers) may be writing the same
+ * flight, e.g. when one logger is connected twice.  The file gets its
+ * real name with rename() when it is complete.
+ */
+static bool
+partial_path(char *buffer, size_t size, const char *base, const char *suffix)
+{
+    int ret = snprintf(buffer, size, "%s.%s.%d", base, suffix, (int)getpid());
+
+    return ret >= 0 && (size_t)ret < size;
+}
+
+
+/*
+ * Filser / LX Navigation
+ *
+ */
+
+/** SYN/ACK with a few retries; the device may be busy */
+static int
+filser_sync_ack(filser_t device)
+{
+    unsigned tries;
+    int ret;
+
+    for (tries = 0; tries < 3; ++tries) {
+        ret = filser_syn_ack(device);
+        if (ret != 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+static int
+filser_communicate(filser_t device, unsigned char cmd,
+                   void *buffer, size_t length)
+{
+    int ret;
+
+    ret = filser_sync_ack(device);
+    if (ret <= 0)
+        return ret;
+
+    tcflush(device->fd, TCIOFLUSH);
+
+    ret = filser_write_cmd(device, cmd);
+    if (ret <= 0)
+        return ret;
+
+    return filser_read_crc(device, buffer, length, 40000);
+}
+
+static int
+filser_list(filser_t device, struct filser_flight_index *flights,
+            unsigned *num_flights_r)
+{
+    unsigned num_flights;
+    int ret;
+
+    ret = filser_sync_ack(device);
+    if (ret <= 0)
+        return -1;
+
+    ret = filser_send_command(device, FILSER_READ_FLIGHT_LIST);
+    if (ret <= 0)
+        return -1;
+
+    for (num_flights = 0; num_flights < MAX_FLIGHTS; ++num_flights) {
+        ret = filser_read_crc(device, &flights[num_flights],
+                              sizeof(flights[num_flights]), 40000);
+        if (ret <= 0)
+            return -1;
+
+        if (flights[num_flights].valid != 1)
+            break;
+    }
+
+    *num_flights_r = num_flights;
+    return 0;
+}
+
+/** forwards the progress of filser_download_flight() to the report */
+static void
+filser_download_message(void *ctx, int level, const char *text)
+{
+    FILE *report = ctx;
+
+    (void)level;
+    fprintf(report, "M %s\n", text);
+}
+
+static int
+filser_sync(const struct config *config, filser_t device, FILE *report)
+{
+    unsigned char mem_settings[6];
+    struct filser_flight_index flights[MAX_FLIGHTS];
+    struct filser_download download;
+    unsigned num_flights, i;
+    char name[16], base[1024], path[1024], lxn_path[1024];
+    int ret;
+
+    ret = filser_communicate(device, FILSER_CHECK_MEM_SETTINGS,
+                             mem_settings, sizeof(mem_settings));
+    if (ret <= 0) {
+        fprintf(report, "E failed to read the memory settings\n");
+        return -1;
+    }
+
+    ret = filser_list(device, flights, &num_flights);
+    if (ret < 0) {
+        fprintf(report, "E failed to read the flight list\n");
+        return -1;
+    }
+
+    fprintf(report, "N %u\n", num_flights);
+
+    for (i = 0; i < num_flights; ++i) {
+        filser_flight_filename(name, &flights[i]);
+        name[8] = 0;
+        if (!flight_base(base, sizeof(base), config->output_dir, name) ||
+            !output_path(path, sizeof(path), base, "igc") ||
+            !output_path(lxn_path, sizeof(lxn_path), base, "lxn")) {
+            fprintf(report, "E path too long: %s/%s\n",
+                    config->output_dir, name);
+            return -1;
+        }
+
+        if (file_exists(path)) {
+            fprintf(report, "S %s\n", base);
+            continue;
+        }
+
+        fprintf(report, "M downloading flight %u\n", i + 1);
+
+        download.message = filser_download_message;
+        download.ctx = report;
+
+        /* the IGC file is converted while the data arrives */
+        if (filser_sync_ack(device) <= 0) {
+            fprintf(report, "E failed to download flight %u: no response\n",
+                    i + 1);
+            return -1;
+        }
+
+        if (filser_download_flight(device, &flights[i], lxn_path, path,
+                                   &download) < 0) {
+            fprintf(report, "E failed to download flight %u: %s\n",
+                    i + 1, download.error);
+            return -1;
+        }
+
+        fprintf(report, "I %s\n", base);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Zander
+ *
+ */
+
+static int
+zander_download(zander_t device, const struct zander_flight *flight,
+                const char *path)
+{
+    unsigned start = zander_address_to_host(&flight->memory_start);
+    unsigned end = zander_address_to_host(&flight->memory_end);
+    unsigned length;
+    void *buffer;
+    int ret, fd;
+
+    if (!zander_address_valid(start) || !zander_address_valid(end))
+        return EINVAL;
+
+    length = zander_address_difference(start, end) + 1;
+
+    buffer = malloc(length);
+    if (buffer == NULL)
+        abort();
+
+    ret = zander_read_memory(device, buffer, start, length);
+    if (ret != 0) {
+        free(buffer);
+        return ret;
+    }
+
+    fd = open(path, O_WRONLY|O_CREAT|O_TRUNC|O_BINARY, 0666);
+    if (fd < 0) {
+        free(buffer);
+        return errno;
+    }
+
+    if (write(fd, buffer, length) != (ssize_t)length) {
+        ret = errno != 0 ? errno : ENOSPC;
+        close(fd);
+        unlink(path);
+        free(buffer);
+        return ret;
+    }
+
+    close(fd);
+    free(buffer);
+    return 0;
+}
+
+static int
+zander_sync(const struct config *config, zander_t device,
+            const struct zander_serial *serial, FILE *report)
+{
+    struct zander_flight flights[ZANDER_MAX_FLIGHTS];
+    unsigned num_flights = 0, i;
+    char name[16], base[1024], igc_path[1024], path[1024], tmp[1024];
+    int ret;
+
+    ret = zander_flight_list(device, flights);
+    if (ret != 0) {
+        fprintf(report, "E failed to read the flight list: %s\n",
+                zander_strerror(ret));
+        return -1;
+    }
+
+    for (i = 0; i < ZANDER_MAX_FLIGHTS; ++i)
+        if (zander_address_defined(&flights[i].memory_start) &&
+            zander_address_defined(&flights[i].memory_end))
+            ++num_flights;
+
+    fprintf(report, "N %u\n", num_flights);
+
+    for (i = 0; i < ZANDER_MAX_FLIGHTS; ++i) {
+        const struct zander_flight *flight = &flights[i];
+
+        if (!zander_address_defined(&flight->memory_start) ||
+            !zander_address_defined(&flight->memory_end))
+            continue;
+
+        zander_flight_filename(name, serial, flight);
+        name[8] = 0;
+        if (!flight_base(base, sizeof(base), config->output_dir, name) ||
+            !output_path(igc_path, sizeof(igc_path), base, "igc") ||
+            !output_path(path, sizeof(path), base, "zan") ||
+            !partial_path(tmp, sizeof(tmp), base, "zan")) {
+            fprintf(report, "E path too long: %s/%s\n",
+                    config->output_dir, name);
+            return -1;
+        }
+
+        if (file_exists(igc_path)) {
+            fprintf(report, "S %s\n", base);
+            continue;
+        }
+
+        fprintf(report, "M downloading flight %u\n", ntohs(flight->no));
+
+        ret = zander_download(device, flight, tmp);
+        if (ret == 0 && rename(tmp, path) < 0) {
+            ret = errno;
+            unlink(tmp);
+        }
+
+        if (ret != 0) {
+            fprintf(report, "E failed to download flight %u: %s\n",
+                    ntohs(flight->no), zander_strerror(ret));
+            return -1;
+        }
+
+        fprintf(report, "F zan %s\n", base);
+    }
+
+    return 0;
+}
+
+
+/*
+ * Flarm
+ *
+ */
+
+static bool
+flarm_detect(flarm_t flarm)
+{
+    const void *payload;
+    size_t length;
+
+    return flarm_enter_binary_mode(flarm) == FLARM_RESULT_SUCCESS &&
+        flarm_send_ping(flarm) == FLARM_RESULT_SUCCESS &&
+        flarm_recv_reply(flarm, 1000, &payload, &length) == FLARM_RESULT_SUCCESS;
+}
+
+/** make a file name from the record info */
+static void
+flarm_flight_name(char *name, size_t size, const char *info)
+{
+    size_t i;
+
+    for (i = 0; i + 1 < size && info[i] != 0; ++i)
+        name[i] = isalnum((unsigned char)info[i]) || info[i] == '-'
+            ? info[i] : '_';
+
+    name[i] = 0;
+}
+
+static flarm_result_t
+flarm_select(flarm_t flarm, unsigned record_no)
+{
+    flarm_result_t ret;
+    const void *payload;
+    size_t length;
+
+    ret = flarm_send_select_record(flarm, record_no);
+    if (ret != FLARM_RESULT_SUCCESS)
+        return ret;
+
+    return flarm_recv_reply(flarm, 3000, &payload, &length);
+}
+
+static int
+flarm_download(flarm_t flarm, unsigned record_no, const char *path)
+{
+    flarm_result_t ret;
+    const unsigned char *payload;
+    size_t length;
+    bool is_eof = false;
+    FILE *file;
+
+    ret = flarm_select(flarm, record_no);
+    if (ret != FLARM_RESULT_SUCCESS)
+        return -1;
+
+    file = fopen(path, "wb");
+    if (file == NULL)
+        return -1;
+
+    while (!is_eof) {
+        ret = flarm_send_get_igc_data(flarm);
+        if (ret == FLARM_RESULT_SUCCESS)
+            ret = flarm_recv_reply(flarm, 3000, (const void**)&payload, &length);
+        if (ret != FLARM_RESULT_SUCCESS || length < 3)
+            break;
+
+        if (length > 3 && payload[length - 1] == 0x1a) {
+            is_eof = true;
+            --length;
+        }
+
+        fwrite(payload + 3, length - 3, 1, file);
+    }
+
+    if (fclose(file) != 0 || !is_eof) {
+        unlink(path);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int
+flarm_sync(const struct config *config, flarm_t flarm, FILE *report)
+{
+    static char names[MAX_FLIGHTS][64];
+    flarm_result_t ret;
+    const char *payload;
+    size_t length;
+    unsigned num_flights, i;
+    char base[1024], path[1024], tmp[1024];
+
+    for (num_flights = 0; num_flights < MAX_FLIGHTS; ++num_flights) {
+        ret = flarm_select(flarm, num_flights);
+        if (ret == FLARM_RESULT_NACK)
+            break;
+
+        if (ret == FLARM_RESULT_SUCCESS) {
+            ret = flarm_send_get_record_info(flarm);
+            if (ret == FLARM_RESULT_SUCCESS)
+                ret = flarm_recv_reply(flarm, 3000, (const void**)&payload,
+                                     &length);
+        }
+
+        if (ret != FLARM_RESULT_SUCCESS) {
+            fprintf(report, "E failed to read the flight list: %s\n",
+                    flarm_strerror(ret));
+            return -1;
+        }
+
+        if (length < 4 || payload[length - 1] != 0) {
+            fprintf(report, "E invalid record info\n");
+            return -1;
+        }
+
+        flarm_flight_name(names[num_flights], sizeof(names[num_flights]),
+                          payload + 2);
+    }
+
+    fprintf(report, "N %u\n", num_flights);
+
+    for (i = 0; i < num_flights; ++i) {
+        if (!flight_base(base, sizeof(base), config->output_dir, names[i]) ||
+            !output_path(path, sizeof(path), base, "igc") ||
+            !partial_path(tmp, sizeof(tmp), base, "igc")) {
+            fprintf(report, "E path too long: %s/%s\n",
+                    config->output_dir, names[i]);
+            return -1;
+        }
+
+        if (file_exists(path)) {
+            fprintf(report, "S %s\n", base);
+            continue;
+        }
+
+        fprintf(report, "M downloading flight %u\n", i);
+
+        if (flarm_download(flarm, i, tmp) < 0 || rename(tmp, path) < 0) {
+            unlink(tmp);
+            fprintf(report, "E failed to download flight %u\n", i);
+            return -1;
+        }
+
+        fprintf(report, "I %s\n", base);
+    }
+
+    return 0;
+}
+
+
+/*
+ * session process
+ *
+ */
+
+/** detect the logger type and download all new flights */
+static int
+session_run(const struct config *config, const char *path, FILE *report)
+{
+    filser_t filser;
+    zander_t zander;
+    struct zander_serial serial;
+    flarm_t flarm;
+    flarm_result_t result;
+    unsigned baud, original_baud;
+    int ret;
+
+    ret = filser_open(path, &filser);
+    if (ret != 0) {
+        fprintf(report, "E failed to open: %s\n", strerror(errno));
+        return -1;
+    }
+
+    /* in fast mode, a logger configured for a higher speed is found,
+       too */
+    if (config->fast)
+        baud = filser_negotiate_speed(filser, 115200);
+    else
+        baud = filser_sync_ack(filser) > 0 ? 19200 : 0;
+
+    if (baud > 0) {
+        fprintf(report, "T filser\n");
+        fprintf(report, "M %u baud\n", baud);
+
+        ret = filser_sync(config, filser, report);
+        filser_close(&filser);
+        return ret;
+    }
+
+    filser_close(&filser);
+
+    ret = zander_open(path, &zander);
+    if (ret == 0) {
+        /* a Zander answers at once; don't wait long if this is
+           something else */
+        zander_set_timeout(zander, 500);
+
+        if (zander_read_serial(zander, &serial) == 0) {
+            zander_set_timeout(zander, ZANDER_TIMEOUT_MS);
+            fprintf(report, "T zander\n");
+            ret = zander_sync(config, zander, &serial, report);
+            zander_close(&zander);
+            return ret;
+        }
+
+        zander_close(&zander);
+    }
+
+    ret = flarm_open(path, &flarm);
+    if (ret == FLARM_RESULT_SUCCESS) {
+        if (flarm_detect(flarm)) {
+            fprintf(report, "T flarm\n");
+
+            original_baud = serialio_get_baud(flarm_fileno(flarm));
+            if (config->fast) {
+                result = flarm_negotiate_speed(flarm, 57600, &baud);
+                if (result != FLARM_RESULT_SUCCESS) {
+                    fprintf(report, "E lost the flarm while changing speed: %s\n",
+                            flarm_strerror(result));
+                    flarm_close(&flarm);
+                    return -1;
+                }
+
+                fprintf(report, "M %u baud\n", baud);
+            }
+
+            ret = flarm_sync(config, flarm, report);
+
+            if (config->fast)
+                flarm_set_speed(flarm, original_baud);
+            flarm_exit_binary_mode(flarm);
+            flarm_close(&flarm);
+            return ret;
+        }
+
+        flarm_close(&flarm);
+    }
+
+    fprintf(report, "E no logger found\n");
+    return -1;
+}
+
+
+/*
+ * conversion worker process
+ *
+ */
+
+static int
+convert_zan(const char *in_path, FILE *out, FILE *report)
+{
+    FILE *in;
+    enum zander_to_igc_result result;
+
+    in = fopen(in_path, "rb");
+    if (in == NULL) {
+        fprintf(report, "E failed to open %s: %s\n",
+                in_path, strerror(errno));
+        return -1;
+    }
+
+    result = zander_to_igc(in, out);
+    fclose(in);
+
+    switch (result) {
+    case ZANDER_IGC_SUCCESS:
+        return 0;
+
+    case ZANDER_IGC_MALFORMED:
+        fprintf(report, "E %s: malformed input file\n", in_path);
+        break;
+
+    case ZANDER_IGC_ERRNO:
+        fprintf(report, "E %s: %s\n", in_path, strerror(errno));
+        break;
+
+    case ZANDER_IGC_EOF:
+        fprintf(report, "E %s: unexpected end of file\n", in_path);
+        break;
+    }
+
+    return -1;
+}
+
+static int
+worker_run(const struct job *job, FILE *report)
+{
+    char in_path[1024], out_path[1024], tmp_path[1024];
+    FILE *out;
+    int ret;
+
+    if (!output_path(in_path, sizeof(in_path), job->base, job->kind) ||
+        !output_path(out_path, sizeof(out_path), job->base, "igc") ||
+        !partial_path(tmp_path, sizeof(tmp_path), job->base, "igc")) {
+        fprintf(report, "E path too long: %s\n", job->base);
+        return -1;
+    }
+
+    out = fopen(tmp_path, "w");
+    if (out == NULL) {
+        fprintf(report, "E failed to create %s: %s\n",
+                tmp_path, strerror(errno));
+        return -1;
+    }
+
+    ret = convert_zan(in_path, out, report);
+
+    if (fclose(out) != 0 && ret == 0) {
+        fprintf(report, "E failed to write %s: %s\n",
+                tmp_path, strerror(errno));
+        ret = -1;
+    }
+
+    if (ret == 0 && rename(tmp_path, out_path) < 0) {
+        fprintf(report, "E failed to rename %s: %s\n",
+                tmp_path, strerror(errno));
+        ret = -1;
+    }
+
+    if (ret != 0)
+        unlink(tmp_path);
+
+    return ret;
+}
+
+
+/*
+ * child processes
+ *
+ */
+
+/**
+ * Forks a child process with a pipe to report to the parent.  In the
+ * child, it returns 0 and sets *report_r.
+ */
+static pid_t
+child_spawn(struct child *child, FILE **report_r)
+{
+    int fds[2];
+    pid_t pid;
+
+    if (pipe(fds) < 0)
+        return -1;
+
+    fflush(stdout);
+    fflush(stderr);
+
+    pid = fork();
+    if (pid < 0) {
+        int save_errno = errno;
+        close(fds[0]);
+        close(fds[1]);
+        errno = save_errno;
+        return -1;
+    }
+
+    if (pid == 0) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+
+        close(fds[0]);
+
+        *report_r = fdopen(fds[1], "w");
+        if (*report_r == NULL)
+            _exit(2);
+
+        setvbuf(*report_r, NULL, _IOLBF, 0);
+        return 0;
+    }
+
+    close(fds[1]);
+
+    child->pid = pid;
+    child->fd = fds[0];
+    child->length = 0;
+    return pid;
+}
+
+static void __attribute__((noreturn))
+child_exit(FILE *report, int ret)
+{
+    fclose(report);
+    _exit(ret == 0 ? 0 : 1);
+}
+
+typedef void (*line_handler_t)(struct instance *instance, void *ctx,
+                               char *line);
+
+/**
+ * Reads from the pipe of a child process and passes complete lines
+ * to the handler.
+ *
+ * @return true if the child has exited
+ */
+static bool
+child_read(struct instance *instance, struct child *child,
+           line_handler_t handler, void *ctx)
+{
+    ssize_t nbytes;
+    char *line, *newline;
+
+    nbytes = read(child->fd, child->buffer + child->length,
+                  sizeof(child->buffer) - 1 - child->length);
+    if (nbytes < 0 && errno == EINTR)
+        return false;
+
+    if (nbytes > 0) {
+        child->length += (size_t)nbytes;
+        child->buffer[child->length] = 0;
+
+        line = child->buffer;
+        while ((newline = strchr(line, '\n')) != NULL) {
+            *newline = 0;
+            handler(instance, ctx, line);
+            line = newline + 1;
+        }
+
+        child->length -= line - child->buffer;
+        if (child->length == sizeof(child->buffer) - 1) {
+            /* line too long */
+            handler(instance, ctx, child->buffer);
+            child->length = 0;
+        } else
+            memmove(child->buffer, line, child->length);
+
+        return false;
+    }
+
+    /* end of file: the child has exited */
+
+    if (child->length > 0) {
+        child->buffer[child->length] = 0;
+        handler(instance, ctx, child->buffer);
+        child->length = 0;
+    }
+
+    close(child->fd);
+    child->fd = -1;
+
+    if (waitpid(child->pid, &child->status, 0) < 0)
+        child->status = -1;
+    child->pid = 0;
+
+    return true;
+}
+
+
+/*
+ * main process
+ *
+ */
+
+static void
+session_line(struct instance *instance, void *ctx, char *line)
+{
+    struct port *port = ctx;
+    const int verbose = instance->config->verbose;
+    char *arg = line[0] != 0 && line[1] == ' ' ? line + 2 : line + 1;
+    struct job *job;
+    char *base;
+    unsigned i;
+
+    switch (line[0]) {
+    case 'T':
+        for (i = 0; i < sizeof(logger_type_names) / sizeof(logger_type_names[0]); ++i)
+            if (strcmp(arg, logger_type_names[i]) == 0)
+                port->type = (enum logger_type)i;
+
+        if (verbose >= 2)
+            printf("%s: %s logger\n", port->path, arg);
+        break;
+
+    case 'N':
+        port->num_flights = atoi(arg);
+        break;
+
+    case 'S':
+        ++port->num_skipped;
+
+        if (verbose >= 3)
+            printf("%s: %s.igc exists already\n", port->path, arg);
+        break;
+
+    case 'F':
+        base = strchr(arg, ' ');
+        if (base == NULL || base - arg >= (int)sizeof(job->kind))
+            break;
+
+        *base++ = 0;
+
+        job = calloc(1, sizeof(*job));
+        if (job == NULL)
+            abort();
+
+        job->port = port;
+        strcpy(job->kind, arg);
+        job->base = strdup(base);
+        if (job->base == NULL)
+            abort();
+
+        *instance->jobs_tail = job;
+        instance->jobs_tail = &job->next;
+
+        ++port->num_new;
+        ++instance->num_new;
+
+        if (verbose >= 2)
+            printf("%s: downloaded %s.%s\n", port->path, base, arg);
+        break;
+
+    case 'I':
+        ++port->num_new;
+        ++instance->num_new;
+        ++instance->num_converted;
+
+        if (verbose >= 1)
+            printf("%s: downloaded %s.igc\n", port->path, arg);
+        break;
+
+    case 'M':
+        if (verbose >= 3)
+            printf("%s: %s\n", port->path, arg);
+        break;
+
+    case 'E':
+        ++port->num_errors;
+        ++instance->num_errors;
+
+        fprintf(stderr, "%s: %s\n", port->path, arg);
+        break;
+    }
+}
+
+static void
+worker_line(struct instance *instance, void *ctx, char *line)
+{
+    const struct worker *worker = ctx;
+
+    (void)instance;
+
+    if (line[0] == 'E' && line[1] == ' ')
+        fprintf(stderr, "%s: %s\n", worker->job->port->path, line + 2);
+}
+
+static void
+session_start(struct instance *instance, struct port *port)
+{
+    FILE *report;
+    pid_t pid;
+
+    port->type = LOGGER_UNKNOWN;
+    port->num_flights = port->num_new = port->num_skipped = 0;
+    port->num_errors = 0;
+
+    pid = child_spawn(&port->session, &report);
+    if (pid < 0) {
+        fprintf(stderr, "%s: fork() failed: %s\n",
+                port->path, strerror(errno));
+        ++instance->num_errors;
+        return;
+    }
+
+    if (pid == 0)
+        child_exit(report, session_run(instance->config, port->path, report));
+
+    ++instance->num_sessions;
+}
+
+static void
+session_finish(struct instance *instance, struct port *port)
+{
+    --instance->num_sessions;
+
+    if (instance->config->verbose >= 1 && port->type != LOGGER_UNKNOWN)
+        printf("%s: %s logger, %d flights, %u new\n", port->path,
+               logger_type_names[port->type],
+               port->num_flights, port->num_new);
+}
+
+static void
+worker_start(struct instance *instance, struct worker *worker,
+             struct job *job)
+{
+    FILE *report;
+    pid_t pid;
+
+    worker->job = job;
+
+    pid = child_spawn(&worker->child, &report);
+    if (pid < 0) {
+        fprintf(stderr, "%s: fork() failed: %s\n",
+                job->port->path, strerror(errno));
+        ++instance->num_errors;
+        worker->job = NULL;
+        free(job->base);
+        free(job);
+        return;
+    }
+
+    if (pid == 0)
+        child_exit(report, worker_run(job, report));
+
+    ++instance->num_busy;
+}
+
+static bool
+child_success(const struct child *child)
+{
+    return WIFEXITED(child->status) && WEXITSTATUS(child->status) == 0;
+}
+
+static void
+worker_finish(struct instance *instance, struct worker *worker)
+{
+    struct job *job = worker->job;
+
+    --instance->num_busy;
+
+    if (child_success(&worker->child)) {
+        ++instance->num_converted;
+
+        if (instance->config->verbose >= 1)
+            printf("%s: converted %s.igc\n", job->port->path, job->base);
+    } else if (worker->child.status != 0 && job->port->num_errors == 0) {
+        /* the worker has not reported an error */
+        fprintf(stderr, "%s: failed to convert %s\n",
+                job->port->path, job->base);
+        ++instance->num_errors;
+    }
+
+    worker->job = NULL;
+    free(job->base);
+    free(job);
+}
+
+/** assign queued jobs to idle workers */
+static void
+workers_schedule(struct instance *instance)
+{
+    struct job *job;
+    unsigned i;
+
+    for (i = 0; i < instance->config->jobs && instance->jobs != NULL; ++i) {
+        if (instance->workers[i].job != NULL)
+            continue;
+
+        job = instance->jobs;
+        instance->jobs = job->next;
+        if (instance->jobs == NULL)
+            instance->jobs_tail = &instance->jobs;
+        job->next = NULL;
+
+        worker_start(instance, &instance->workers[i], job);
+    }
+}
+
+static struct port *
+port_get(struct instance *instance, const char *path)
+{
+    struct port *port, **tail = &instance->ports;
+
+    for (port = instance->ports; port != NULL; port = port->next) {
+        if (strcmp(port->path, path) == 0)
+            return port;
+        tail = &port->next;
+    }
+
+    port = calloc(1, sizeof(*port));
+    if (port == NULL)
+        abort();
+
+    port->path = strdup(path);
+    if (port->path == NULL)
+        abort();
+
+    port->session.fd = -1;
+
+    *tail = port;
+    return port;
+}
+
+/** look for ports, and start a session on each new logger */
+static void
+ports_scan(struct instance *instance)
+{
+    const struct config *config = instance->config;
+    struct port *port;
+    struct stat st;
+    glob_t g;
+    unsigned i;
+    size_t j;
+
+    for (i = 0; i < config->num_ports; ++i) {
+        if (glob(config->ports[i], 0, NULL, &g) != 0)
+            continue;
+
+        for (j = 0; j < g.gl_pathc; ++j)
+            port_get(instance, g.gl_pathv[j]);
+
+        globfree(&g);
+    }
+
+    for (port = instance->ports; port != NULL; port = port->next) {
+        if (port->session.fd >= 0 || should_exit)
+            continue;
+
+        if (stat(port->path, &st) < 0) {
+            /* unplugged; synchronize again when it comes back */
+            port->synced = false;
+            continue;
+        }
+
+        if (port->synced && port->rdev == st.st_rdev && port->ino == st.st_ino)
+            continue;
+
+        port->synced = true;
+        port->rdev = st.st_rdev;
+        port->ino = st.st_ino;
+
+        session_start(instance, port);
+    }
+}
+
+static void
+kill_children(struct instance *instance)
+{
+    struct port *port;
+    unsigned i;
+
+    for (port = instance->ports; port != NULL; port = port->next)
+        if (port->session.pid > 0)
+            kill(port->session.pid, SIGTERM);
+
+    for (i = 0; i < instance->config->jobs; ++i)
+        if (instance->workers[i].child.pid > 0)
+            kill(instance->workers[i].child.pid, SIGTERM);
+
+    while (wait(NULL) > 0) {}
+}
+
+static void
+run(struct instance *instance)
+{
+    const struct config *config = instance->config;
+    struct pollfd *pfds = NULL;
+    void **owners = NULL;
+    unsigned max_fds = 0, num_fds, num_session_fds, i;
+    struct port *port;
+    uint64_t next_scan = 0;
+    int timeout, ret;
+
+    while (!should_exit) {
+        if (next_scan == 0 ||
+            (config->watch > 0 && serialio_now() >= next_scan)) {
+            ports_scan(instance);
+            next_scan = serialio_deadline(config->watch * 1000);
+        }
+
+        workers_schedule(instance);
+
+        if (config->watch == 0 && instance->num_sessions == 0 &&
+            instance->num_busy == 0 && instance->jobs == NULL)
+            break;
+
+        /* wait for the next report from any child; the sessions come
+           first in the array, then the workers */
+
+        if (instance->num_sessions + instance->num_busy > max_fds) {
+            max_fds = instance->num_sessions + instance->num_busy;
+            pfds = realloc(pfds, max_fds * sizeof(pfds[0]));
+            owners = realloc(owners, max_fds * sizeof(owners[0]));
+            if (pfds == NULL || owners == NULL)
+                abort();
+        }
+
+        num_fds = 0;
+
+        for (port = instance->ports; port != NULL; port = port->next) {
+            if (port->session.fd < 0)
+                continue;
+
+            pfds[num_fds].fd = port->session.fd;
+            pfds[num_fds].events = POLLIN;
+            owners[num_fds++] = port;
+        }
+
+        num_session_fds = num_fds;
+
+        for (i = 0; i < config->jobs; ++i) {
+            if (instance->workers[i].job == NULL)
+                continue;
+
+            pfds[num_fds].fd = instance->workers[i].child.fd;
+            pfds[num_fds].events = POLLIN;
+            owners[num_fds++] = &instance->workers[i];
+        }
+
+        assert(num_fds <= max_fds);
+
+        timeout = -1;
+        if (config->watch > 0) {
+            const uint64_t now = serialio_now();
+            timeout = next_scan > now ? (int)(next_scan - now) : 0;
+        }
+
+        ret = poll(pfds, num_fds, timeout);
+        if (ret < 0) {
+            if (errno == EINTR)
+                continue;
+
+            perror("poll() failed");
+            break;
+        }
+
+        for (i = 0; i < num_fds; ++i) {
+            if (pfds[i].revents == 0)
+                continue;
+
+            if (i < num_session_fds) {
+                port = owners[i];
+
+                if (child_read(instance, &port->session, session_line, port))
+                    session_finish(instance, port);
+            } else {
+                struct worker *worker = owners[i];
+
+                if (child_read(instance, &worker->child, worker_line, worker))
+                    worker_finish(instance, worker);
+            }
+        }
+    }
+
+    if (should_exit)
+        kill_children(instance);
+
+    free(pfds);
+    free(owners);
+}
+
+int main(int argc, char **argv) {
+    struct config config;
+    struct instance instance;
+    struct sigaction sa;
+
+    parse_cmdline(&config, argc, argv);
+
+    if (config.verbose >= 1)
+        fputs("loggertools v" VERSION " (C) 2004-2008 Max Kellermann <max@duempel.org>\n"
+              "http://max.kellermann.name/projects/loggertools/\n\n", stderr);
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = exit_handler;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    memset(&instance, 0, sizeof(instance));
+    instance.config = &config;
+    instance.jobs_tail = &instance.jobs;
+
+    instance.workers = calloc(config.jobs, sizeof(instance.workers[0]));
+    if (instance.workers == NULL)
+        abort();
+
+    run(&instance);
+
+    if (config.verbose >= 1)
+        printf("%u new flights, %u converted, %u errors\n",
+               instance.num_new, instance.num_converted,
+               instance.num_errors);
+
+    free(instance.workers);
+
+    return instance.num_errors > 0 ? 1 : 0;
+}
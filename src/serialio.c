@@ -26,6 +26,9 @@
 #include <termios.h>
 #include <assert.h>
 #include <stdlib.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/time.h>
 
 #include "serialio.h"
 
@@ -33,10 +36,19 @@ struct serialio {
     int fd;
 };
 
-int serialio_open(const char *device,
-                  struct serialio **serialiop) {
+uint64_t serialio_now(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+uint64_t serialio_deadline(unsigned timeout_ms) {
+    return serialio_now() + timeout_ms;
+}
+
+int serialio_open_fd(const char *device, speed_t speed) {
     int fd, ret;
-    struct serialio *serio;
     struct termios attr;
 
     fd = open(device, O_RDWR | O_NOCTTY);
@@ -58,8 +70,8 @@ int serialio_open(const char *device,
     attr.c_cflag |= (CS8 | CLOCAL);
     attr.c_cc[VMIN] = 0;
     attr.c_cc[VTIME] = 1;
-    cfsetospeed(&attr, B57600);
-    cfsetispeed(&attr, B57600);
+    cfsetospeed(&attr, speed);
+    cfsetispeed(&attr, speed);
     ret = tcsetattr(fd, TCSANOW, &attr);
     if (ret < 0) {
         int save_errno = errno;
@@ -68,6 +80,148 @@ int serialio_open(const char *device,
         return -1;
     }
 
+    return fd;
+}
+
+static const struct {
+    unsigned baud;
+    speed_t speed;
+} serialio_speeds[] = {
+    { 4800, B4800 },
+    { 9600, B9600 },
+    { 19200, B19200 },
+    { 38400, B38400 },
+    { 57600, B57600 },
+    { 115200, B115200 },
+};
+
+int serialio_set_baud(int fd, unsigned baud) {
+    struct termios attr;
+    unsigned i;
+
+    for (i = 0; i < sizeof(serialio_speeds) / sizeof(serialio_speeds[0]); ++i)
+        if (serialio_speeds[i].baud == baud)
+            break;
+
+    if (i == sizeof(serialio_speeds) / sizeof(serialio_speeds[0])) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (tcgetattr(fd, &attr) < 0)
+        return -1;
+
+    cfsetospeed(&attr, serialio_speeds[i].speed);
+    cfsetispeed(&attr, serialio_speeds[i].speed);
+
+    /* bytes which arrived at the old speed are garbage now */
+    if (tcsetattr(fd, TCSADRAIN, &attr) < 0)
+        return -1;
+
+    tcflush(fd, TCIFLUSH);
+    return 0;
+}
+
+unsigned serialio_get_baud(int fd) {
+    struct termios attr;
+    speed_t speed;
+    unsigned i;
+
+    if (tcgetattr(fd, &attr) < 0)
+        return 0;
+
+    speed = cfgetospeed(&attr);
+    for (i = 0; i < sizeof(serialio_speeds) / sizeof(serialio_speeds[0]); ++i)
+        if (serialio_speeds[i].speed == speed)
+            return serialio_speeds[i].baud;
+
+    return 0;
+}
+
+int serialio_poll(int fd, int options, uint64_t deadline) {
+    struct pollfd pfd;
+    int timeout = -1, ret;
+
+    assert(fd >= 0);
+
+    if (deadline != SERIALIO_NO_DEADLINE) {
+        const uint64_t now = serialio_now();
+        timeout = deadline > now ? (int)(deadline - now) : 0;
+    }
+
+    pfd.fd = fd;
+    pfd.events = 0;
+    if (options & SERIALIO_SELECT_AVAILABLE)
+        pfd.events |= POLLIN;
+    if (options & SERIALIO_SELECT_READY)
+        pfd.events |= POLLOUT;
+    pfd.revents = 0;
+
+    ret = poll(&pfd, 1, timeout);
+    if (ret <= 0)
+        return ret;
+
+    options = 0;
+
+    /* report errors and hangups as readable, so the following read()
+       returns them */
+    if (pfd.revents & (POLLIN | POLLERR | POLLHUP))
+        options |= SERIALIO_SELECT_AVAILABLE;
+    if (pfd.revents & POLLOUT)
+        options |= SERIALIO_SELECT_READY;
+
+    return options;
+}
+
+int serialio_read_full(int fd, void *p0, size_t length, unsigned timeout_ms) {
+    unsigned char *p = p0;
+    uint64_t deadline = timeout_ms > 0
+        ? serialio_deadline(timeout_ms)
+        : SERIALIO_NO_DEADLINE;
+    ssize_t nbytes;
+    int ret;
+
+    while (length > 0) {
+        ret = serialio_poll(fd, SERIALIO_SELECT_AVAILABLE, deadline);
+        if (ret <= 0)
+            return ret;
+
+        nbytes = read(fd, p, length);
+        if (nbytes < 0) {
+            if (errno == EAGAIN)
+                continue;
+            return -1;
+        }
+
+        if (nbytes == 0) {
+            /* end of file: no more data will arrive */
+            if (deadline == SERIALIO_NO_DEADLINE) {
+                errno = ECONNRESET;
+                return -1;
+            }
+
+            return 0;
+        }
+
+        p += nbytes;
+        length -= (size_t)nbytes;
+
+        if (timeout_ms > 0)
+            deadline = serialio_deadline(timeout_ms);
+    }
+
+    return 1;
+}
+
+int serialio_open(const char *device,
+                  struct serialio **serialiop) {
+    int fd;
+    struct serialio *serio;
+
+    fd = serialio_open_fd(device, B57600);
+    if (fd < 0)
+        return -1;
+
     tcflush(fd, TCOFLUSH);
 
     serio = calloc(1, sizeof(*serio));
@@ -110,8 +264,7 @@ void serialio_flush(struct serialio *serio, unsigned options) {
 }
 
 int serialio_select(struct serialio *serio, int options,
-                    struct timeval *timeout) {
-    fd_set rfds, wfds;
+                    uint64_t deadline) {
     int ret;
 
     assert(serio != NULL);
@@ -119,29 +272,12 @@ int serialio_select(struct serialio *serio, int options,
     if (serio->fd < 0)
         return -1;
 
-    FD_ZERO(&rfds);
-    if (options & SERIALIO_SELECT_AVAILABLE)
-        FD_SET(serio->fd, &rfds);
-
-    FD_ZERO(&wfds);
-    if (options & SERIALIO_SELECT_READY)
-        FD_SET(serio->fd, &wfds);
-
-    ret = select(serio->fd + 1, &rfds, &wfds, NULL, timeout);
+    ret = serialio_poll(serio->fd, options, deadline);
     if (ret < 0)
         return errno == EINTR
             ? 0 : -1;
-    if (ret == 0)
-        return 0;
-
-    options = 0;
 
-    if (FD_ISSET(serio->fd, &rfds))
-        options |= SERIALIO_SELECT_AVAILABLE;
-    if (FD_ISSET(serio->fd, &wfds))
-        options |= SERIALIO_SELECT_READY;
-
-    return options;
+    return ret;
 }
 
 int serialio_read(struct serialio *serio, void *data, size_t *nbytes) {
@@ -26,6 +26,70 @@
 #define SERIALIO_SELECT_AVAILABLE 0x1
 #define SERIALIO_SELECT_READY 0x2
 
+/** a deadline which never expires */
+#define SERIALIO_NO_DEADLINE 0
+
+#include <stddef.h>
+#include <stdint.h>
+#include <termios.h>
+
+/* low level functions on a file descriptor, shared by the device
+   libraries */
+
+/**
+ * Returns the time of the monotonic clock in milliseconds.  Deadlines
+ * are points in this clock, so they are not affected by changes of
+ * the system time.
+ */
+uint64_t serialio_now(void);
+
+/**
+ * Returns the deadline timeout_ms milliseconds from now.
+ */
+uint64_t serialio_deadline(unsigned timeout_ms);
+
+/**
+ * Opens a serial port in raw mode with the specified speed.
+ *
+ * @return the file descriptor, or -1 on error (errno set)
+ */
+int serialio_open_fd(const char *device, speed_t speed);
+
+/**
+ * Changes the speed of an open serial port, after all pending output
+ * has been sent.  The speed is in baud (e.g. 57600).
+ *
+ * @return 0 on success, -1 on error (errno set; EINVAL if the speed
+ * is not supported)
+ */
+int serialio_set_baud(int fd, unsigned baud);
+
+/**
+ * Returns the current output speed of the serial port in baud, or 0
+ * if it cannot be determined.
+ */
+unsigned serialio_get_baud(int fd);
+
+/**
+ * Waits until the file descriptor is readable
+ * (SERIALIO_SELECT_AVAILABLE) or writable (SERIALIO_SELECT_READY),
+ * or until the deadline has passed.
+ *
+ * @return the flags which are ready, 0 on timeout, -1 on error (errno
+ * set; EINTR if a signal was caught)
+ */
+int serialio_poll(int fd, int options, uint64_t deadline);
+
+/**
+ * Reads exactly length bytes.  timeout_ms is the maximum time without
+ * any data; 0 means wait forever.
+ *
+ * @return 1 on success, 0 on timeout, -1 on error (errno set)
+ */
+int serialio_read_full(int fd, void *p, size_t length, unsigned timeout_ms);
+
+/* the serial port object */
+
 struct serialio;
 
 int serialio_open(const char *device,
@@ -35,8 +99,13 @@ void serialio_close(struct serialio *serio);
 
 void serialio_flush(struct serialio *serio, unsigned options);
 
+/**
+ * Waits until the port is readable or writable, or until the
+ * deadline (see serialio_deadline()) has passed.  Returns 0 on
+ * timeout and when interrupted by a signal.
+ */
 int serialio_select(struct serialio *serio, int options,
-                    struct timeval *timeout);
+                    uint64_t deadline);
 
 int serialio_read(struct serialio *serio, void *data, size_t *nbytes);
 
@@ -0,0 +1,113 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef __LOGGERTOOLS_THREAD_POOL_HH
+#define __LOGGERTOOLS_THREAD_POOL_HH
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * A fixed number of worker threads which run jobs from a queue.  Jobs
+ * must not throw; they have to store errors for the caller.
+ */
+class ThreadPool {
+public:
+    typedef std::function<void()> Job;
+
+private:
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable job_cond, idle_cond;
+    std::deque<Job> queue;
+    unsigned busy;
+    bool quit;
+
+public:
+    explicit ThreadPool(unsigned num_threads)
+        :busy(0), quit(false) {
+        for (unsigned i = 0; i < num_threads; ++i)
+            threads.push_back(std::thread(&ThreadPool::run, this));
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            quit = true;
+        }
+
+        job_cond.notify_all();
+
+        for (std::vector<std::thread>::iterator it = threads.begin();
+             it != threads.end(); ++it)
+            it->join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator =(const ThreadPool &) = delete;
+
+public:
+    void push(const Job &job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.push_back(job);
+        }
+
+        job_cond.notify_one();
+    }
+
+    /** wait until all jobs have finished */
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!queue.empty() || busy > 0)
+            idle_cond.wait(lock);
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        while (true) {
+            while (queue.empty() && !quit)
+                job_cond.wait(lock);
+
+            if (queue.empty())
+                break;
+
+            Job job = queue.front();
+            queue.pop_front();
+            ++busy;
+
+            lock.unlock();
+            job();
+            lock.lock();
+
+            --busy;
+            if (queue.empty() && busy == 0)
+                idle_cond.notify_all();
+        }
+    }
+};
+
+#endif
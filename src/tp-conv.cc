@@ -183,7 +183,7 @@ int main(int argc, char **argv) {
                 ? std::string(s, 0, colon)
                 : s;
             const char *args = colon >= 0
-                ? std::string(s, colon + 1).c_str()
+                ? *it + colon + 1
                 : NULL;
             const TurnPointFilter *filter
                 = getTurnPointFilter(filter_name.c_str());
@@ -0,0 +1,344 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "exception.hh"
+#include "tp.hh"
+#include "tp-io.hh"
+#include "tp-find.hh"
+#include "earth-parser.hh"
+
+#include <vector>
+#include <list>
+#include <string>
+#include <algorithm>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** the mean earth radius, the same as in earth.cc */
+static const double EARTH_RADIUS = 6372795.;
+
+/** a point on the unit sphere */
+struct SphereVector {
+    double x, y, z;
+
+    SphereVector():x(0), y(0), z(0) {}
+    SphereVector(double _x, double _y, double _z):x(_x), y(_y), z(_z) {}
+
+    SphereVector(const SurfacePosition &position) {
+        const double latitude = position.getLatitude();
+        const double longitude = position.getLongitude();
+        const double cos_lat = cos(latitude);
+        x = cos_lat * cos(longitude);
+        y = cos_lat * sin(longitude);
+        z = sin(latitude);
+    }
+
+    double dot(const SphereVector &b) const {
+        return x * b.x + y * b.y + z * b.z;
+    }
+
+    const SphereVector cross(const SphereVector &b) const {
+        return SphereVector(y * b.z - z * b.y,
+                            z * b.x - x * b.z,
+                            x * b.y - y * b.x);
+    }
+
+    double length() const {
+        return sqrt(dot(*this));
+    }
+
+    const SphereVector scale(double factor) const {
+        return SphereVector(x * factor, y * factor, z * factor);
+    }
+};
+
+/**
+ * One leg of the route: a great circle arc with a bounding box which
+ * already includes the corridor.  All tests are dot products against
+ * precomputed vectors, the only trigonometry per turn point is the
+ * conversion to a vector, and that is skipped for turn points outside
+ * of the box.
+ */
+class CorridorLeg {
+    SphereVector a, b;
+
+    /** the normal of the great circle plane, zero if a and b are
+        (almost) equal */
+    SphereVector normal;
+
+    /** sin and cos of the corridor half width as an angle */
+    double sin_distance, cos_distance;
+
+    int latitude_min, latitude_max, longitude_min, longitude_max;
+
+public:
+    CorridorLeg(const SurfacePosition &_a, const SurfacePosition &_b,
+                double distance);
+
+public:
+    bool inBox(const SurfacePosition &position) const {
+        const int latitude = position.getLatitude().getValue();
+        const int longitude = position.getLongitude().getValue();
+        return latitude >= latitude_min && latitude <= latitude_max &&
+            longitude >= longitude_min && longitude <= longitude_max;
+    }
+
+    bool matches(const SphereVector &p) const;
+
+private:
+    /** is the point (projected to the great circle) between a and
+        b? */
+    bool onArc(const SphereVector &p) const {
+        return a.cross(p).dot(normal) >= 0 && p.cross(b).dot(normal) >= 0;
+    }
+
+    void extendLatitude(const SphereVector &p) {
+        const int latitude = (int)(asin(p.z) * 180. * 60. * 1000. / M_PI);
+        if (latitude < latitude_min)
+            latitude_min = latitude;
+        if (latitude > latitude_max)
+            latitude_max = latitude;
+    }
+};
+
+CorridorLeg::CorridorLeg(const SurfacePosition &_a, const SurfacePosition &_b,
+                         double distance)
+    :a(_a), b(_b)
+{
+    const double angle = distance / EARTH_RADIUS;
+    sin_distance = sin(angle);
+    cos_distance = cos(angle);
+
+    normal = a.cross(b);
+    const double length = normal.length();
+    if (length > 1e-12)
+        normal = normal.scale(1. / length);
+    else
+        normal = SphereVector();
+
+    latitude_min = std::min(_a.getLatitude().getValue(),
+                            _b.getLatitude().getValue());
+    latitude_max = std::max(_a.getLatitude().getValue(),
+                            _b.getLatitude().getValue());
+
+    /* a great circle arc bulges towards the pole; include its
+       northern- and southernmost point if it lies on the arc */
+    if (length > 1e-12) {
+        const SphereVector vertex =
+            SphereVector(0, 0, 1).cross(normal).cross(normal).scale(-1);
+        const double vertex_length = vertex.length();
+        if (vertex_length > 1e-12) {
+            const SphereVector north = vertex.scale(1. / vertex_length);
+            const SphereVector south = north.scale(-1);
+            if (onArc(north))
+                extendLatitude(north);
+            if (onArc(south))
+                extendLatitude(south);
+        }
+    }
+
+    const int d_latitude =
+        (int)ceil(angle * 180. * 60. * 1000. / M_PI);
+    latitude_min -= d_latitude;
+    latitude_max += d_latitude;
+
+    const int max_latitude = std::max(abs(latitude_min), abs(latitude_max));
+    double cos_lat = cos(max_latitude * M_PI / (180. * 60. * 1000.));
+    const int a_longitude = _a.getLongitude().getValue();
+    const int b_longitude = _b.getLongitude().getValue();
+
+    if (max_latitude >= 90 * 60 * 1000 || cos_lat < 0.01 ||
+        abs(a_longitude - b_longitude) > 180 * 60 * 1000) {
+        /* near a pole or across the date line: no longitude
+           prefilter */
+        longitude_min = -180 * 60 * 1000;
+        longitude_max = 180 * 60 * 1000;
+    } else {
+        const int d_longitude = (int)ceil(d_latitude / cos_lat);
+        longitude_min = std::min(a_longitude, b_longitude) - d_longitude;
+        longitude_max = std::max(a_longitude, b_longitude) + d_longitude;
+    }
+}
+
+bool
+CorridorLeg::matches(const SphereVector &p) const
+{
+    /* close to one of the end points? */
+    if (p.dot(a) >= cos_distance || p.dot(b) >= cos_distance)
+        return true;
+
+    if (normal.dot(normal) <= 0)
+        return false;
+
+    /* the sine of the cross track distance is the distance from the
+       great circle plane */
+    return fabs(p.dot(normal)) <= sin_distance && onArc(p);
+}
+
+/**
+ * A reader which passes only turn points near the route.  The route
+ * turn points are looked up in the input itself, so the turn points
+ * before the last of them are buffered; all others are filtered as
+ * they are read.
+ */
+class CorridorTurnPointReader : public TurnPointReader {
+    TurnPointReader *reader;
+
+    std::vector<std::string> names;
+    double distance;
+
+    std::vector<SurfacePosition> positions;
+    unsigned num_found;
+
+    std::list<TurnPoint> buffer;
+    std::vector<CorridorLeg> legs;
+
+public:
+    CorridorTurnPointReader(TurnPointReader *_reader,
+                            const std::vector<std::string> &_names,
+                            double _distance)
+        :reader(_reader), names(_names), distance(_distance),
+         positions(_names.size()), num_found(0) {}
+
+    virtual ~CorridorTurnPointReader() {
+        delete reader;
+    }
+
+public:
+    virtual const TurnPoint *read();
+
+private:
+    void findRoute();
+    bool matches(const TurnPoint &tp) const;
+};
+
+void
+CorridorTurnPointReader::findRoute()
+{
+    std::vector<bool> found(names.size(), false);
+
+    while (num_found < names.size()) {
+        const TurnPoint *tp = reader->read();
+        if (tp == NULL) {
+            unsigned i = 0;
+            while (found[i])
+                ++i;
+            throw malformed_input("route turn point not found: " + names[i]);
+        }
+
+        /* a name may appear more than once in the route */
+        for (unsigned i = 0; i < names.size(); ++i) {
+            if (!found[i] && tp->getPosition().defined() &&
+                TurnPointFindByName(names[i])(*tp)) {
+                positions[i] = tp->getPosition();
+                found[i] = true;
+                ++num_found;
+            }
+        }
+
+        buffer.push_back(*tp);
+        delete tp;
+    }
+
+    for (unsigned i = 0; i + 1 < positions.size(); ++i)
+        legs.push_back(CorridorLeg(positions[i], positions[i + 1],
+                                   distance));
+}
+
+bool
+CorridorTurnPointReader::matches(const TurnPoint &tp) const
+{
+    const Position &position = tp.getPosition();
+    if (!position.defined())
+        return false;
+
+    bool converted = false;
+    SphereVector p;
+
+    for (std::vector<CorridorLeg>::const_iterator it = legs.begin();
+         it != legs.end(); ++it) {
+        if (!it->inBox(position))
+            continue;
+
+        if (!converted) {
+            p = SphereVector(position);
+            converted = true;
+        }
+
+        if (it->matches(p))
+            return true;
+    }
+
+    return false;
+}
+
+const TurnPoint *
+CorridorTurnPointReader::read()
+{
+    if (legs.empty())
+        findRoute();
+
+    while (!buffer.empty()) {
+        const TurnPoint tp = buffer.front();
+        buffer.pop_front();
+        if (matches(tp))
+            return new TurnPoint(tp);
+    }
+
+    while (true) {
+        const TurnPoint *tp = reader->read();
+        if (tp == NULL || matches(*tp))
+            return tp;
+
+        /* this object didn't pass the filter: delete it */
+        delete tp;
+    }
+}
+
+TurnPointReader *
+CorridorTurnPointFilter::createFilter(TurnPointReader *reader,
+                                      const char *args) const {
+    if (args == NULL || *args == 0)
+        throw malformed_input("No route provided");
+
+    const char *colon = strrchr(args, ':');
+    if (colon == NULL)
+        throw malformed_input("Distance is missing");
+
+    std::vector<std::string> names;
+    const char *p = args;
+    while (p < colon) {
+        const char *comma = (const char *)memchr(p, ',', colon - p);
+        const char *end = comma != NULL ? comma : colon;
+        if (end == p)
+            throw malformed_input("Empty route turn point name");
+
+        names.push_back(std::string(p, end - p));
+        p = comma != NULL ? comma + 1 : colon;
+    }
+
+    if (names.size() < 2)
+        throw malformed_input("The route needs at least two turn points");
+
+    const Distance distance = parseDistance(colon + 1);
+
+    return new CorridorTurnPointReader(reader, names, distance.getMeters());
+}
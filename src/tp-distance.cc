@@ -20,26 +20,13 @@
 #include "exception.hh"
 #include "tp.hh"
 #include "tp-io.hh"
+#include "tp-find.hh"
 #include "io-compare.hh"
 #include "io-match.hh"
 #include "earth-parser.hh"
 
 #include <string.h>
 
-class TurnPointFindByName {
-    std::string name;
-
-public:
-    TurnPointFindByName(const std::string &_name)
-        :name(_name) {}
-
-public:
-    bool operator ()(const TurnPoint &tp) {
-        return tp.getCode() == name || tp.getShortName() == name ||
-            tp.getFullName() == name;
-    }
-};
-
 class TurnPointCompareDistance {
     Distance distance;
 
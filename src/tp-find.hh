@@ -0,0 +1,42 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#ifndef __LOGGERTOOLS_TP_FIND_HH
+#define __LOGGERTOOLS_TP_FIND_HH
+
+#include "tp.hh"
+
+#include <string>
+
+/** finds a turn point by its code, short name or full name */
+class TurnPointFindByName {
+    std::string name;
+
+public:
+    TurnPointFindByName(const std::string &_name)
+        :name(_name) {}
+
+public:
+    bool operator ()(const TurnPoint &tp) {
+        return tp.getCode() == name || tp.getShortName() == name ||
+            tp.getFullName() == name;
+    }
+};
+
+#endif
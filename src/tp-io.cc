@@ -56,6 +56,7 @@ const TurnPointFormat *getTurnPointFormat(const char *ext) {
 static const DistanceTurnPointFilter distanceFilter;
 static const AirfieldTurnPointFilter airfieldFilter;
 static const NameTurnPointFilter nameFilter;
+static const CorridorTurnPointFilter corridorFilter;
 
 const TurnPointFilter *getTurnPointFilter(const char *name) {
     if (strcmp(name, "distance") == 0)
@@ -64,6 +65,8 @@ const TurnPointFilter *getTurnPointFilter(const char *name) {
         return &airfieldFilter;
     else if (strcmp(name, "name") == 0)
         return &nameFilter;
+    else if (strcmp(name, "corridor") == 0)
+        return &corridorFilter;
     else
         return NULL;
 }
@@ -96,6 +96,12 @@ public:
                                           const char *args) const;
 };
 
+class CorridorTurnPointFilter : public TurnPointFilter {
+public:
+    virtual TurnPointReader *createFilter(TurnPointReader *reader,
+                                          const char *args) const;
+};
+
 const TurnPointFilter *getTurnPointFilter(const char *name);
 
 #endif
@@ -0,0 +1,47 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+#include "zander.h"
+
+#include <assert.h>
+#include <ctype.h>
+
+static const char c36[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+void
+zander_flight_filename(char *filename, const struct zander_serial *serial,
+                       const struct zander_flight *flight)
+{
+    unsigned i;
+
+    assert(serial != NULL);
+    assert(flight != NULL);
+
+    filename[0] = c36[flight->date.year % 10];
+    filename[1] = c36[flight->date.month % 36];
+    filename[2] = c36[flight->date.day % 36];
+    filename[3] = 'z'; /* 'z' for "Zander" */
+
+    for (i = 0; i < 3; ++i) {
+        int ch = tolower((unsigned char)serial->serial[i]);
+        filename[4 + i] = isalnum(ch) ? (char)ch : '0';
+    }
+
+    filename[7] = c36[ntohs(flight->no) % 36];
+}
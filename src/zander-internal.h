@@ -24,6 +24,9 @@
 
 struct zander {
     int fd;
+
+    /** see zander_set_timeout() */
+    unsigned timeout_ms;
 };
 
 enum zander_cmd {
@@ -18,12 +18,12 @@
  */
 
 #include "zander-internal.h"
+#include "serialio.h"
 
 #include <assert.h>
 #include <sys/types.h>
 #include <unistd.h>
 #include <errno.h>
-#include <time.h>
 
 int zander_write(zander_t zander, const void *data, size_t length) {
     ssize_t nbytes;
@@ -40,29 +40,18 @@ int zander_write(zander_t zander, const void *data, size_t length) {
     return 0;
 }
 
-int zander_read(zander_t zander, void *p0, size_t length) {
-    static const time_t timeout = 2;
-    unsigned char *p = p0;
-    ssize_t nbytes;
-    size_t pos = 0;
-    time_t end_time = 0;
-
-    if (timeout > 0)
-        end_time = time(NULL) + timeout;
+int zander_read(zander_t zander, void *p, size_t length) {
+    int ret;
 
-    for (;;) {
-        nbytes = read(zander->fd, p + pos, length - pos);
-        if (nbytes < 0)
-            return errno;
+    assert(zander != NULL);
+    assert(zander->fd >= 0);
 
-        if (nbytes > 0)
-            end_time = time(NULL) + timeout;
+    ret = serialio_read_full(zander->fd, p, length, zander->timeout_ms);
+    if (ret < 0)
+        return errno;
 
-        pos += (size_t)nbytes;
-        if (pos >= length)
-            return 0;
+    if (ret == 0)
+        return ETIMEDOUT;
 
-        if (timeout > 0 && time(NULL) > end_time)
-            return EINTR;
-    }
+    return 0;
 }
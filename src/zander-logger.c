@@ -26,7 +26,6 @@
 #include <string.h>
 #include <errno.h>
 #include <termios.h>
-#include <signal.h>
 #include <time.h>
 #include <stdlib.h>
 #include <ctype.h>
@@ -38,10 +37,12 @@
 #include "version.h"
 #include "zander.h"
 #include "datadir.h"
+#include "flight-index.h"
 
 struct config {
     int verbose;
     const char *tty;
+    const char *sync_dir;
 };
 
 static void usage(void) {
@@ -67,6 +68,10 @@ static void usage(void) {
          " --tty DEVICE\n"
 #endif
          " -t DEVICE      open this tty device (default /dev/ttyS0)\n"
+#ifdef __GLIBC__
+         " --sync DIR\n"
+#endif
+         " -s DIR         download all new flights to DIR, print a summary\n"
          );
 }
 
@@ -81,6 +86,7 @@ static void parse_cmdline(struct config *config,
         {"verbose", 0, 0, 'v'},
         {"quiet", 1, 0, 'q'},
         {"tty", 1, 0, 't'},
+        {"sync", 1, 0, 's'},
         {0,0,0,0}
     };
 #endif
@@ -92,10 +98,10 @@ static void parse_cmdline(struct config *config,
 #ifdef __GLIBC__
         int option_index = 0;
 
-        ret = getopt_long(argc, argv, "hVvqt:",
+        ret = getopt_long(argc, argv, "hVvqt:s:",
                           long_options, &option_index);
 #else
-        ret = getopt(argc, argv, "hVvqt:");
+        ret = getopt(argc, argv, "hVvqt:s:");
 #endif
         if (ret == -1)
             break;
@@ -122,6 +128,10 @@ static void parse_cmdline(struct config *config,
             config->tty = optarg;
             break;
 
+        case 's':
+            config->sync_dir = optarg;
+            break;
+
         default:
             exit(1);
         }
@@ -135,10 +145,6 @@ static void arg_error(const char *msg) {
     _exit(1);
 }
 
-static void alarm_handler(int dummy) {
-    (void)dummy;
-}
-
 static int
 download_flight(const struct config *config,
                 zander_t device, const struct zander_flight *flight,
@@ -202,6 +208,117 @@ zan_to_igc(const char *in_path, const char *out_path)
     return 0;
 }
 
+/** fill in the flight index key of a flight */
+static void
+index_key(struct flight_index_entry *key, const struct zander_serial *serial,
+          const struct zander_flight *flight)
+{
+    unsigned i;
+
+    memset(key, 0, sizeof(*key));
+
+    strcpy(key->logger, "zander-");
+    for (i = 0; i < sizeof(serial->serial) && serial->serial[i] != 0; ++i)
+        key->logger[7 + i] = isalnum((unsigned char)serial->serial[i])
+            ? serial->serial[i] : '_';
+
+    key->flight_no = ntohs(flight->no);
+    snprintf(key->date, sizeof(key->date), "%02u.%02u.%02u",
+             flight->date.day, flight->date.month, flight->date.year);
+    key->start = zander_address_to_host(&flight->memory_start);
+    key->end = zander_address_to_host(&flight->memory_end);
+}
+
+/**
+ * Downloads all flights which are not in the flight index of the
+ * sync directory, or whose file was modified or deleted.  Prints one
+ * summary line per flight to stdout.
+ */
+static int
+sync_flights(const struct config *config, zander_t zander,
+             const struct zander_serial *serial,
+             const struct zander_flight *flights)
+{
+    struct flight_index index;
+    struct flight_index_entry key;
+    const struct flight_index_entry *entry;
+    unsigned i, num_flights = 0, num_new = 0, num_present = 0,
+        num_repaired = 0, num_failed = 0;
+    char name[16], path[1024];
+    const char *status;
+    int ret;
+
+    ret = flight_index_open(&index, config->sync_dir);
+    if (ret != 0) {
+        fprintf(stderr, "failed to read the flight index in %s: %s\n",
+                config->sync_dir, strerror(ret));
+        exit(2);
+    }
+
+    for (i = 0; i < ZANDER_MAX_FLIGHTS; ++i) {
+        const struct zander_flight *flight = &flights[i];
+
+        if (!zander_address_defined(&flight->memory_start) ||
+            !zander_address_defined(&flight->memory_end))
+            continue;
+
+        ++num_flights;
+        index_key(&key, serial, flight);
+
+        entry = flight_index_find(&index, &key);
+        if (entry != NULL && flight_index_verify(&index, entry)) {
+            flight_index_report(stdout, "present", entry);
+            ++num_present;
+            continue;
+        }
+
+        /* a flight in the index whose file was lost or modified */
+        status = entry != NULL ? "repaired" : "new";
+
+        zander_flight_filename(name, serial, flight);
+        name[8] = 0;
+        snprintf(key.filename, sizeof(key.filename), "%s.zan", name);
+        snprintf(path, sizeof(path), "%s/%s", config->sync_dir, key.filename);
+
+        if (config->verbose >= 1)
+            fprintf(stderr, "Downloading flight %u to %s\n",
+                    key.flight_no, path);
+
+        ret = download_flight(config, zander, flight, path);
+        if (ret == 0)
+            ret = flight_index_hash_file(path, &key.hash);
+        if (ret != 0) {
+            /* not added to the index; the next sync tries again */
+            flight_index_report(stdout, "failed", &key);
+            ++num_failed;
+            continue;
+        }
+
+        /* save after each flight, so an interrupted sync doesn't
+           lose the flights it has completed */
+        flight_index_update(&index, &key);
+        ret = flight_index_save(&index);
+        if (ret != 0) {
+            fprintf(stderr, "failed to write the flight index in %s: %s\n",
+                    config->sync_dir, strerror(ret));
+            exit(2);
+        }
+
+        flight_index_report(stdout, status, &key);
+        if (status[0] == 'r')
+            ++num_repaired;
+        else
+            ++num_new;
+    }
+
+    printf("summary flights=%u new=%u present=%u repaired=%u failed=%u\n",
+           num_flights, num_new, num_present, num_repaired, num_failed);
+
+    flight_index_close(&index);
+
+    return num_failed > 0 ? -1 : 0;
+}
+
 int main(int argc, char **argv) {
     struct config config;
     int ret;
@@ -211,8 +328,6 @@ int main(int argc, char **argv) {
     unsigned i;
     char line[256];
 
-    signal(SIGALRM, alarm_handler);
-
     parse_cmdline(&config, argc, argv);
 
     if (optind < argc)
@@ -239,6 +354,12 @@ int main(int argc, char **argv) {
         exit(2);
     }
 
+    if (config.sync_dir != NULL) {
+        ret = sync_flights(&config, zander, &serial, flights);
+        zander_close(&zander);
+        return ret == 0 ? 0 : 1;
+    }
+
     for (i = 0; i < ZANDER_MAX_FLIGHTS; ++i) {
         const struct zander_flight *f = &flights[i];
         struct zander_time record_end = f->record_start,
@@ -296,8 +417,7 @@ int main(int argc, char **argv) {
 
             flight = &flights[i];
 
-            /*XXX zander_flight_filename(zan_filename, flight);*/
-            strcpy(zan_filename, "foobarab");
+            zander_flight_filename(zan_filename, &serial, flight);
 
             memcpy(igc_filename, zan_filename, 8);
             strcpy(zan_filename + 8, ".zan");
@@ -28,6 +28,7 @@
 
 #include "zander.h"
 #include "zander-internal.h"
+#include "serialio.h"
 
 int zander_fdopen(int fd, zander_t *zander_r) {
     zander_t zander;
@@ -40,6 +41,7 @@ int zander_fdopen(int fd, zander_t *zander_r) {
         return -1;
 
     zander->fd = fd;
+    zander->timeout_ms = ZANDER_TIMEOUT_MS;
 
     *zander_r = zander;
     return 0;
@@ -47,36 +49,11 @@ int zander_fdopen(int fd, zander_t *zander_r) {
 
 int zander_open(const char *device_path, zander_t *zander_r) {
     int fd, ret;
-    struct termios attr;
 
-    fd = open(device_path, O_RDWR | O_NOCTTY);
+    fd = serialio_open_fd(device_path, B9600);
     if (fd < 0)
         return errno;
 
-    ret = tcgetattr(fd, &attr);
-    if (ret < 0) {
-        int save_errno = errno;
-        close(fd);
-        return save_errno;
-    }
-
-    attr.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR | ICRNL | IXON);
-    attr.c_oflag &= ~OPOST;
-    attr.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
-    attr.c_cflag &= ~(CSIZE | PARENB | CRTSCTS | IXON | IXOFF);
-    attr.c_cflag |= (CS8 | CLOCAL);
-    attr.c_cc[VMIN] = 0;
-    attr.c_cc[VTIME] = 1;
-    cfsetospeed(&attr, B9600);
-    cfsetispeed(&attr, B9600);
-
-    ret = tcsetattr(fd, TCSANOW, &attr);
-    if (ret < 0) {
-        int save_errno = errno;
-        close(fd);
-        return save_errno;
-    }
-
     ret = zander_fdopen(fd, zander_r);
     if (ret != 0)
         close(fd);
@@ -91,6 +68,13 @@ int zander_fileno(zander_t zander) {
     return zander->fd;
 }
 
+void zander_set_timeout(zander_t zander, unsigned timeout_ms) {
+    assert(zander != NULL);
+    assert(timeout_ms > 0);
+
+    zander->timeout_ms = timeout_ms;
+}
+
 void zander_close(zander_t *zander_r) {
     zander_t zander;
 
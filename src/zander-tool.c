@@ -26,7 +26,6 @@
 #include <string.h>
 #include <errno.h>
 #include <termios.h>
-#include <signal.h>
 #include <time.h>
 #include <stdlib.h>
 #include <arpa/inet.h>
@@ -137,10 +136,6 @@ static void arg_error(const char *msg) {
     _exit(1);
 }
 
-static void alarm_handler(int dummy) {
-    (void)dummy;
-}
-
 static int
 cmd_info(struct config *config, int argc, char **argv)
 {
@@ -421,8 +416,6 @@ int main(int argc, char **argv) {
     struct config config;
     const char *cmd;
 
-    signal(SIGALRM, alarm_handler);
-
     parse_cmdline(&config, argc, argv);
 
     if (optind >= argc)
@@ -166,6 +166,15 @@ int zander_open(const char *device_path, zander_t *zander_r);
 
 int zander_fileno(zander_t zander);
 
+/** the default of zander_set_timeout() */
+#define ZANDER_TIMEOUT_MS 2000
+
+/**
+ * Sets how long (in milliseconds) a read may wait for the next byte
+ * before it fails with ETIMEDOUT.
+ */
+void zander_set_timeout(zander_t zander, unsigned timeout_ms);
+
 void zander_close(zander_t *zander_r);
 
 /* zander-protocol.c */
@@ -201,6 +210,16 @@ int
 zander_flight_list(zander_t zander,
                    struct zander_flight flights[ZANDER_MAX_FLIGHTS]);
 
+/* zander-filename.c */
+
+/**
+ * Writes the 8 character IGC short file name of the flight (without
+ * a null terminator), like filser_flight_filename().
+ */
+void
+zander_flight_filename(char *filename, const struct zander_serial *serial,
+                       const struct zander_flight *flight);
+
 /* zander-error.c */
 
 const char *
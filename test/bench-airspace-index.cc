@@ -0,0 +1,210 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Compares AirspaceIndex queries with a linear scan over synthetic
+ * airspaces spread over 8x10 degrees.  Usage:
+ *
+ *  bench-airspace-index [AIRSPACES [QUERIES]]
+ */
+
+#include "airspace.hh"
+#include "airspace-index.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include <stdlib.h>
+
+using std::cout;
+using std::cerr;
+
+/** one arc minute in Angle units */
+static const int MINUTE = 1000;
+
+static const int DEGREE = 60 * MINUTE;
+
+static const int AREA_SOUTH = 46 * DEGREE, AREA_HEIGHT = 8 * DEGREE;
+static const int AREA_WEST = 5 * DEGREE, AREA_WIDTH = 10 * DEGREE;
+
+typedef std::chrono::steady_clock Clock;
+
+static double
+milliseconds(Clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+static const Altitude
+random_bottom(std::mt19937 &rng)
+{
+    switch (rng() % 3) {
+    case 0:
+        return Altitude(0, Altitude::UNIT_FEET, Altitude::REF_GND);
+
+    case 1:
+        return Altitude(500 * (long)(rng() % 20),
+                        Altitude::UNIT_FEET, Altitude::REF_MSL);
+
+    default:
+        return Altitude(100 * (50 + (long)(rng() % 150)),
+                        Altitude::UNIT_FEET, Altitude::REF_1013);
+    }
+}
+
+/**
+ * Creates a box or a circle with a radius between 2 and 20 arc
+ * minutes.
+ */
+static const Airspace
+random_airspace(std::mt19937 &rng)
+{
+    const int latitude = AREA_SOUTH + (int)(rng() % AREA_HEIGHT);
+    const int longitude = AREA_WEST + (int)(rng() % AREA_WIDTH);
+    const int radius = 2 * MINUTE + (int)(rng() % (18 * MINUTE));
+
+    Airspace::EdgeList edges;
+    if (rng() % 4 == 0) {
+        edges.push_back(Edge(SurfacePosition(Latitude(latitude),
+                                             Longitude(longitude)),
+                             Distance(Distance::UNIT_NAUTICAL_MILES,
+                                      radius / (double)MINUTE)));
+    } else {
+        edges.push_back(Edge(SurfacePosition(Latitude(latitude - radius),
+                                             Longitude(longitude - radius))));
+        edges.push_back(Edge(SurfacePosition(Latitude(latitude - radius),
+                                             Longitude(longitude + radius))));
+        edges.push_back(Edge(SurfacePosition(Latitude(latitude + radius),
+                                             Longitude(longitude + radius))));
+        edges.push_back(Edge(SurfacePosition(Latitude(latitude + radius),
+                                             Longitude(longitude - radius))));
+    }
+
+    const Altitude bottom = random_bottom(rng);
+    const Altitude top(bottom.toUnit(Altitude::UNIT_FEET).getValue() +
+                       1000 + 500 * (long)(rng() % 20),
+                       Altitude::UNIT_FEET,
+                       bottom.getRef() == Altitude::REF_GND
+                       ? Altitude::REF_MSL : bottom.getRef());
+
+    return Airspace("bench", Airspace::TYPE_DELTA, bottom, top, edges);
+}
+
+struct Query {
+    GeoBounds area;
+    AltitudeBand band;
+};
+
+struct Scenario {
+    const char *name;
+
+    /** edge length of the area in arc minutes, 0 for no area */
+    int size;
+
+    long bottom, top;
+};
+
+static const Scenario scenarios[] = {
+    { "1'x1' box, 8000-9000ft", 1, 8000, 9000 },
+    { "10'x10' box, 8000-9000ft", 10, 8000, 9000 },
+    { "60'x60' box, 8000-9000ft", 60, 8000, 9000 },
+    { "11500-13000ft, no area", 0, 11500, 13000 },
+    { "below 2000ft, no area", 0, LONG_MIN, 2000 },
+};
+
+static void
+scan(const AirspaceIndex &index, const Query &query,
+     AirspaceIndex::IdList &result)
+{
+    for (AirspaceIndex::id_t id = 0; id < index.size(); ++id)
+        if (index.getBand(id).overlaps(query.band) &&
+            (!query.area.defined() ||
+             query.area.overlaps(index.getBounds(id))))
+            result.push_back(id);
+}
+
+int main(int argc, char **argv) {
+    const unsigned num_airspaces = argc > 1 ? atoi(argv[1]) : 50000;
+    const unsigned num_queries = argc > 2 ? atoi(argv[2]) : 2000;
+    std::mt19937 rng(1);
+
+    AirspaceIndex index;
+    for (unsigned i = 0; i < num_airspaces; ++i)
+        index.insert(random_airspace(rng));
+
+    /* the first query builds the band index */
+    const Clock::time_point build_start = Clock::now();
+    AirspaceIndex::IdList result;
+    index.query(GeoBounds(), AltitudeBand(0, 1), result);
+    cout << num_airspaces << " airspaces, band index built in "
+         << milliseconds(Clock::now() - build_start) << " ms\n"
+         << num_queries << " queries per scenario\n\n";
+
+    bool success = true;
+
+    for (unsigned s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); ++s) {
+        const Scenario &scenario = scenarios[s];
+
+        std::vector<Query> queries(num_queries);
+        for (unsigned i = 0; i < num_queries; ++i) {
+            Query &query = queries[i];
+            query.band = AltitudeBand(scenario.bottom, scenario.top);
+
+            if (scenario.size > 0) {
+                const int latitude = AREA_SOUTH + (int)(rng() % AREA_HEIGHT);
+                const int longitude = AREA_WEST + (int)(rng() % AREA_WIDTH);
+                query.area.extend(latitude, longitude);
+                query.area.extend(latitude + scenario.size * MINUTE,
+                                  longitude + scenario.size * MINUTE);
+            }
+        }
+
+        std::vector<AirspaceIndex::IdList> expected(num_queries);
+        const Clock::time_point scan_start = Clock::now();
+        for (unsigned i = 0; i < num_queries; ++i)
+            scan(index, queries[i], expected[i]);
+        const Clock::duration scan_time = Clock::now() - scan_start;
+
+        std::vector<AirspaceIndex::IdList> actual(num_queries);
+        const Clock::time_point index_start = Clock::now();
+        for (unsigned i = 0; i < num_queries; ++i)
+            index.query(queries[i].area, queries[i].band, actual[i]);
+        const Clock::duration index_time = Clock::now() - index_start;
+
+        unsigned long matches = 0;
+        for (unsigned i = 0; i < num_queries; ++i) {
+            std::sort(actual[i].begin(), actual[i].end());
+            if (actual[i] != expected[i]) {
+                cerr << scenario.name << ": query " << i
+                     << " differs from the linear scan\n";
+                success = false;
+            }
+
+            matches += expected[i].size();
+        }
+
+        cout << scenario.name << ": " << matches << " matches, scan "
+             << milliseconds(scan_time) << " ms, index "
+             << milliseconds(index_time) << " ms\n";
+    }
+
+    return success ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2007 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Measures the throughput of filser_calc_crc() and of the bitwise
+ * reference, for a short packet and for memory section sizes.
+ */
+
+#include "filser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef unsigned char (*crc_function_t)(const void *p, size_t length);
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** returns the throughput in MB/s */
+static double
+measure(crc_function_t f, const unsigned char *buffer, size_t length)
+{
+    /* about 64 MB per measurement */
+    const unsigned rounds = (unsigned)(64 * 1024 * 1024 / length);
+    volatile unsigned char sink = 0;
+    unsigned i;
+    double start;
+
+    start = now();
+    for (i = 0; i < rounds; ++i)
+        sink ^= f(buffer, length);
+
+    (void)sink;
+    return rounds * (double)length / (now() - start) / 1e6;
+}
+
+int main(void) {
+    static const size_t lengths[] = { 16, 20 * 1024, 64 * 1024 };
+    static unsigned char buffer[64 * 1024];
+    unsigned i;
+
+    srand(42);
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (unsigned char)(rand() >> 4);
+
+    printf("%12s %10s %10s\n", "length", "bitwise", "table");
+
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+        printf("%12lu %7.0f MB/s %7.0f MB/s\n", (unsigned long)lengths[i],
+               measure(filser_calc_crc_bitwise, buffer, lengths[i]),
+               measure(filser_calc_crc, buffer, lengths[i]));
+
+    return 0;
+}
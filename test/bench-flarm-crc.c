@@ -0,0 +1,89 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Measures the throughput of flarm_crc_update_block() and of the
+ * bitwise sample code, for a short frame, a typical flight download
+ * frame and a large buffer.
+ */
+
+#include "flarm-internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static uint16_t
+bitwise_block(uint16_t crc, const void *src0, size_t length)
+{
+    const uint8_t *src = (const uint8_t*)src0;
+
+    for (; length > 0; ++src, --length)
+        crc = flarm_crc_update_bitwise(crc, *src);
+    return crc;
+}
+
+typedef uint16_t (*crc_function_t)(uint16_t crc, const void *src,
+                                   size_t length);
+
+static double
+now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** returns the throughput in MB/s */
+static double
+measure(crc_function_t f, const uint8_t *buffer, size_t length)
+{
+    /* about 64 MB per measurement */
+    const unsigned rounds = (unsigned)(64 * 1024 * 1024 / length);
+    volatile uint16_t sink = 0;
+    unsigned i;
+    double start;
+
+    start = now();
+    for (i = 0; i < rounds; ++i)
+        sink ^= f(0, buffer, length);
+
+    (void)sink;
+    return rounds * (double)length / (now() - start) / 1e6;
+}
+
+int main(void) {
+    static const size_t lengths[] = { 16, 256, 32 * 1024 };
+    static uint8_t buffer[32 * 1024];
+    unsigned i;
+
+    srand(42);
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (uint8_t)(rand() >> 4);
+
+    printf("%12s %10s %10s\n", "length", "bitwise", "table");
+
+    for (i = 0; i < sizeof(lengths) / sizeof(lengths[0]); ++i)
+        printf("%12lu %7.0f MB/s %7.0f MB/s\n", (unsigned long)lengths[i],
+               measure(bitwise_block, buffer, lengths[i]),
+               measure(flarm_crc_update_block, buffer, lengths[i]));
+
+    return 0;
+}
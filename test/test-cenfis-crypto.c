@@ -0,0 +1,184 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2007 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Checks that the scalar, SSE2 and AVX2 implementations of the Cenfis
+ * cipher produce the same output as the original byte-wise code.
+ */
+
+#include "cenfis-crypto.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern unsigned char cenfis_key_1[];
+
+extern unsigned char cenfis_key_2[];
+
+extern unsigned char cenfis_key_3[];
+
+/** the bytes 0..239 encrypted; this wraps around the 200 byte key */
+static const unsigned char counting_encrypted[240] = {
+    0x6a, 0x38, 0x6a, 0x01, 0x72, 0x56, 0x1c, 0x17, 0x0b, 0x2f, 0x27, 0x34,
+    0x2d, 0x25, 0x28, 0x79, 0x31, 0x14, 0x31, 0x0b, 0xc3, 0x1c, 0x0c, 0x1d,
+    0x2d, 0x26, 0xc7, 0x6b, 0x10, 0x0e, 0xcc, 0x0b, 0x79, 0xc0, 0xd2, 0xd3,
+    0x64, 0xc8, 0x22, 0x04, 0xc3, 0x10, 0xcb, 0x37, 0xd0, 0x22, 0x11, 0x20,
+    0xd0, 0x2c, 0x65, 0x22, 0xc0, 0x38, 0xd1, 0x2f, 0x33, 0xc7, 0x31, 0x72,
+    0x3e, 0x2d, 0x39, 0x33, 0xe4, 0xe6, 0xf6, 0xe2, 0xf5, 0xc1, 0xf0, 0xf8,
+    0xe2, 0xfc, 0xaa, 0xab, 0xbc, 0xd6, 0xf7, 0xe2, 0xbf, 0xc9, 0xb7, 0xab,
+    0x52, 0xca, 0xd2, 0xda, 0xc3, 0xc1, 0xd8, 0xe0, 0xde, 0xcc, 0xf3, 0xdc,
+    0x99, 0xf6, 0x8c, 0x98, 0x9a, 0xc9, 0x89, 0xbf, 0x8e, 0x9c, 0xea, 0x88,
+    0x9d, 0xf7, 0xa6, 0x88, 0x95, 0x43, 0xbe, 0xae, 0xeb, 0x81, 0xf4, 0x98,
+    0xfc, 0xa9, 0x9f, 0x91, 0xe4, 0xef, 0x80, 0x90, 0xa8, 0x99, 0xbd, 0xb0,
+    0x96, 0xbf, 0xee, 0xbd, 0xbd, 0xa4, 0xbb, 0x88, 0x86, 0xb9, 0xd9, 0xb7,
+    0xbe, 0x9d, 0xb9, 0x83, 0x9d, 0x8c, 0xaf, 0x8e, 0x8d, 0x95, 0x58, 0xba,
+    0x55, 0x9e, 0x9d, 0x8e, 0xb4, 0x52, 0xbe, 0x8f, 0xae, 0x45, 0x5e, 0xa6,
+    0x4e, 0x54, 0x48, 0xb8, 0xa9, 0xb9, 0x88, 0x53, 0x4d, 0xa3, 0xfe, 0x48,
+    0xb3, 0x50, 0xbc, 0x43, 0x59, 0xa2, 0x84, 0xf2, 0xe6, 0xb3, 0xbc, 0xad,
+    0x4e, 0x69, 0x46, 0x62, 0x70, 0x4e, 0x64, 0x49, 0xd2, 0x40, 0x22, 0x49,
+    0xca, 0x1e, 0x54, 0x6f, 0x73, 0x47, 0x7f, 0x4c, 0x55, 0x4d, 0x40, 0x31,
+    0x49, 0x4c, 0x09, 0x43, 0x0b, 0x54, 0x54, 0x45, 0x75, 0x6e, 0x4f, 0x23,
+    0x18, 0x16, 0x54, 0x13, 0x01, 0x08, 0x6a, 0x6b, 0x3c, 0x00, 0x7a, 0x4c,
+};
+
+/** 33 zero bytes encrypted: one AVX2 block and a scalar tail */
+static const unsigned char zero_encrypted[33] = {
+    0x6a, 0x39, 0x64, 0x02, 0x76, 0x59, 0x16, 0x2a, 0x03, 0x16, 0x11, 0x39,
+    0x29, 0x3a, 0x12, 0x78, 0x21, 0x25, 0x23, 0x38, 0x2f, 0x29, 0x36, 0x28,
+    0x15, 0x0d, 0x2d, 0x40, 0x64, 0x3d, 0x36, 0x36, 0x19,
+};
+
+static const char *const impl_names[] = {
+    "scalar", "SSE2", "AVX2",
+};
+
+static unsigned failures;
+
+/** the original byte-wise implementation */
+static void
+reference_encrypt(unsigned char *p, size_t length)
+{
+    size_t k = 0;
+
+    while (length > 0) {
+        *p = (unsigned char)(((*p ^ (cenfis_key_1[k] + 60))
+                              + cenfis_key_2[k] - 60)
+                             ^ (cenfis_key_3[k] + 100));
+        ++k;
+        if (k == 200)
+            k = 0;
+        ++p;
+        --length;
+    }
+}
+
+static void
+check_equal(const char *impl, const char *what, size_t length,
+            const unsigned char *actual, const unsigned char *expected)
+{
+    if (memcmp(actual, expected, length) != 0) {
+        fprintf(stderr, "%s: %s differs (length %lu)\n",
+                impl, what, (unsigned long)length);
+        ++failures;
+    }
+}
+
+static void
+check_vector(const char *impl, const char *name,
+             const unsigned char *plain, const unsigned char *expected,
+             size_t length)
+{
+    unsigned char buffer[256];
+
+    memcpy(buffer, plain, length);
+    cenfis_encrypt(buffer, length);
+    check_equal(impl, name, length, buffer, expected);
+
+    cenfis_decrypt(buffer, length);
+    check_equal(impl, name, length, buffer, plain);
+}
+
+static void
+test_vectors(const char *impl)
+{
+    unsigned char plain[240];
+    unsigned i;
+
+    for (i = 0; i < sizeof(plain); ++i)
+        plain[i] = (unsigned char)i;
+    check_vector(impl, "counting vector", plain,
+                 counting_encrypted, sizeof(counting_encrypted));
+
+    memset(plain, 0, sizeof(zero_encrypted));
+    check_vector(impl, "zero vector", plain,
+                 zero_encrypted, sizeof(zero_encrypted));
+}
+
+/**
+ * Compares with the reference implementation for all lengths up to
+ * more than two key periods, at unaligned addresses.
+ */
+static void
+test_reference(const char *impl)
+{
+    unsigned char plain[512 + 1], expected[512 + 1], buffer[512 + 1];
+    size_t length, i;
+
+    srand(42);
+
+    for (length = 0; length < 512; ++length) {
+        for (i = 0; i < length; ++i)
+            plain[i] = (unsigned char)(rand() >> 4);
+
+        memcpy(expected, plain, length);
+        reference_encrypt(expected, length);
+
+        memcpy(buffer + 1, plain, length);
+        cenfis_encrypt(buffer + 1, length);
+        check_equal(impl, "encryption", length, buffer + 1, expected);
+
+        cenfis_decrypt(buffer + 1, length);
+        check_equal(impl, "round trip", length, buffer + 1, plain);
+    }
+}
+
+int main(void) {
+    enum cenfis_crypto_impl limit, impl;
+
+    for (limit = CENFIS_CRYPTO_SCALAR; limit <= CENFIS_CRYPTO_AVX2;
+         ++limit) {
+        impl = cenfis_crypto_select(limit);
+        if (impl != limit) {
+            printf("test-cenfis-crypto: %s not available, skipping\n",
+                   impl_names[limit]);
+            continue;
+        }
+
+        test_vectors(impl_names[impl]);
+        test_reference(impl_names[impl]);
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "test-cenfis-crypto: %u failures\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
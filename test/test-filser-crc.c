@@ -0,0 +1,129 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2007 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Checks the table driven filser_calc_crc() against the bitwise
+ * reference implementation.
+ */
+
+#include "filser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned failures;
+
+static void
+check(const unsigned char *p, size_t length, const char *what)
+{
+    const unsigned char expected = filser_calc_crc_bitwise(p, length);
+    const unsigned char actual = filser_calc_crc(p, length);
+
+    if (actual != expected) {
+        if (failures < 10)
+            fprintf(stderr, "%s: length %lu: crc 0x%02x, expected 0x%02x\n",
+                    what, (unsigned long)length, actual, expected);
+        ++failures;
+    }
+}
+
+/**
+ * All 2 and 3 byte inputs.  The first byte brings the register into
+ * every possible state, so this covers every (register, byte) step of
+ * the single byte table.
+ */
+static void
+test_short(void)
+{
+    unsigned char buffer[3];
+    unsigned a, b, c;
+
+    for (a = 0; a < 256; ++a) {
+        buffer[0] = (unsigned char)a;
+
+        for (b = 0; b < 256; ++b) {
+            buffer[1] = (unsigned char)b;
+            check(buffer, 2, "2 bytes");
+
+            for (c = 0; c < 256; ++c) {
+                buffer[2] = (unsigned char)c;
+                check(buffer, 3, "3 bytes");
+            }
+        }
+    }
+}
+
+/**
+ * One byte into every register state, followed by a group of 8 with
+ * a single non-zero byte.  The CRC is linear, so this covers every
+ * entry of each slicing-by-8 table.
+ */
+static void
+test_slices(void)
+{
+    unsigned char buffer[9];
+    unsigned a, position, value;
+
+    for (a = 0; a < 256; ++a) {
+        for (position = 0; position < 8; ++position) {
+            for (value = 0; value < 256; ++value) {
+                memset(buffer, 0, sizeof(buffer));
+                buffer[0] = (unsigned char)a;
+                buffer[1 + position] = (unsigned char)value;
+                check(buffer, sizeof(buffer), "slices");
+            }
+        }
+    }
+}
+
+/** all lengths up to 300 at 16 alignments, and some large buffers */
+static void
+test_random(void)
+{
+    static unsigned char buffer[65536 + 16];
+    size_t i, length, offset;
+
+    srand(42);
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (unsigned char)(rand() >> 4);
+
+    for (length = 0; length <= 300; ++length)
+        for (offset = 0; offset < 16; ++offset)
+            check(buffer + offset, length, "random");
+
+    for (i = 0; i < 50; ++i) {
+        length = (size_t)(rand() % 65536);
+        offset = (size_t)(rand() % 16);
+        check(buffer + offset, length, "large");
+    }
+}
+
+int main(void) {
+    test_short();
+    test_slices();
+    test_random();
+
+    if (failures > 0) {
+        fprintf(stderr, "test-filser-crc: %u failures\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
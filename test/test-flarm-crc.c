@@ -0,0 +1,135 @@
+/*
+ * loggertools
+ * Copyright (C) 2004-2008 Max Kellermann <max@duempel.org>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; version 2 of the License
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+
+/*
+ * Checks the table driven Flarm CRC functions against the bitwise
+ * sample code from the specification.
+ */
+
+#include "flarm-internal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static unsigned failures;
+
+static uint16_t
+reference_block(uint16_t crc, const uint8_t *p, size_t length)
+{
+    for (; length > 0; ++p, --length)
+        crc = flarm_crc_update_bitwise(crc, *p);
+    return crc;
+}
+
+static void
+check(uint16_t crc, const uint8_t *p, size_t length, const char *what)
+{
+    const uint16_t expected = reference_block(crc, p, length);
+    const uint16_t actual = flarm_crc_update_block(crc, p, length);
+
+    if (actual != expected) {
+        if (failures < 10)
+            fprintf(stderr, "%s: start 0x%04x, length %lu: "
+                    "crc 0x%04x, expected 0x%04x\n",
+                    what, crc, (unsigned long)length, actual, expected);
+        ++failures;
+    }
+}
+
+/** flarm_crc_update() for every (register, byte) pair */
+static void
+test_update(void)
+{
+    unsigned crc, data;
+
+    for (crc = 0; crc < 0x10000; ++crc) {
+        for (data = 0; data < 256; ++data) {
+            if (flarm_crc_update((uint16_t)crc, (uint8_t)data) !=
+                flarm_crc_update_bitwise((uint16_t)crc, (uint8_t)data)) {
+                if (failures < 10)
+                    fprintf(stderr, "update: crc 0x%04x, byte 0x%02x\n",
+                            crc, data);
+                ++failures;
+            }
+        }
+    }
+}
+
+/**
+ * Every start value with a group of 8 zero bytes covers the two
+ * tables which combine the register, and a single non-zero byte in a
+ * group covers every entry of each table.
+ */
+static void
+test_slices(void)
+{
+    uint8_t buffer[8];
+    unsigned crc, position, value;
+
+    memset(buffer, 0, sizeof(buffer));
+    for (crc = 0; crc < 0x10000; ++crc)
+        check((uint16_t)crc, buffer, sizeof(buffer), "register");
+
+    for (position = 0; position < 8; ++position) {
+        for (value = 0; value < 256; ++value) {
+            memset(buffer, 0, sizeof(buffer));
+            buffer[position] = (uint8_t)value;
+            check(0, buffer, sizeof(buffer), "slices");
+        }
+    }
+}
+
+/**
+ * All lengths up to 300 at 16 alignments, and some large buffers,
+ * with random start values.
+ */
+static void
+test_random(void)
+{
+    static uint8_t buffer[32768 + 16];
+    size_t i, length, offset;
+
+    srand(42);
+    for (i = 0; i < sizeof(buffer); ++i)
+        buffer[i] = (uint8_t)(rand() >> 4);
+
+    for (length = 0; length <= 300; ++length)
+        for (offset = 0; offset < 16; ++offset)
+            check((uint16_t)(rand() >> 4), buffer + offset, length, "random");
+
+    for (i = 0; i < 50; ++i) {
+        length = (size_t)(rand() % 32768);
+        offset = (size_t)(rand() % 16);
+        check((uint16_t)(rand() >> 4), buffer + offset, length, "large");
+    }
+}
+
+int main(void) {
+    test_update();
+    test_slices();
+    test_random();
+
+    if (failures > 0) {
+        fprintf(stderr, "test-flarm-crc: %u failures\n", failures);
+        return 1;
+    }
+
+    return 0;
+}